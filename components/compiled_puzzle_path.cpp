@@ -0,0 +1,231 @@
+#include "compiled_puzzle_path.h"
+#include <QLineF>
+
+CompiledPuzzlePath::CompiledPuzzlePath()
+    : m_lengthStartToEnd(0.0)
+{
+
+}
+
+CompiledPuzzlePath::CompiledPuzzlePath(const QVector<CustomPuzzlePath::PathPoint> &pathPoints)
+    : m_lengthStartToEnd(0.0)
+{
+    m_positions.resize(pathPoints.size() * 2);
+    for (int i = 0; i < pathPoints.size(); ++i) {
+        m_positions[pathPointSlot(i)] = pathPoints[i].position;
+        m_positions[controlPointSlot(i)] = pathPoints[i].positionControlPoint;
+    }
+    if (pathPoints.size() >= 2) m_lengthStartToEnd = QLineF(pathPoints.first().position, pathPoints.last().position).length();
+
+    // 第一遍：圆形随机偏移
+    for (int i = 0; i < pathPoints.size(); ++i) {
+        if (pathPoints[i].randomOffset.type == CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR) {
+            m_instructions.push_back({Operation::OFFSETCIRCULAR, pathPointSlot(i), -1, -1, -1, -1, pathPoints[i].randomOffset.value});
+        }
+        if (i == 0) continue;
+        if (pathPoints[i].randomOffsetControlPoint.type == CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR) {
+            m_instructions.push_back({Operation::OFFSETCIRCULAR, controlPointSlot(i), -1, -1, -1, -1, pathPoints[i].randomOffsetControlPoint.value});
+        }
+    }
+
+    // 第二遍：直线随机偏移和限制，按点的顺序
+    for (int i = 0; i < pathPoints.size(); ++i) {
+        for (int j = 0; j < 2; ++j) {
+            if (i == 0 && j == 1) continue;
+            int slot = j == 0 ? pathPointSlot(i) : controlPointSlot(i);
+            const CustomPuzzlePath::RandomOffset &offset = j == 0 ? pathPoints[i].randomOffset : pathPoints[i].randomOffsetControlPoint;
+            const CustomPuzzlePath::Restriction &restriction = j == 0 ? pathPoints[i].restriction : pathPoints[i].restrictionControlPoint;
+
+            if (offset.type == CustomPuzzlePath::TypeOfRandomOffset::LINE) {
+                int lineP1 = slotOf(pathPoints, offset.lineP1);
+                int lineP2 = slotOf(pathPoints, offset.lineP2);
+                if (lineP1 >= 0 && lineP2 >= 0) m_instructions.push_back({Operation::OFFSETLINE, slot, lineP1, lineP2, -1, -1, offset.value});
+            }
+            addRestriction(pathPoints, slot, restriction);
+        }
+    }
+
+    for (int i = 1; i < pathPoints.size(); ++i) {
+        m_segments.push_back({pathPoints[i].typeOfLine, pathPointSlot(i), controlPointSlot(i)});
+    }
+}
+
+const QVector<QPointF> &CompiledPuzzlePath::positions() const
+{
+    return m_positions;
+}
+
+QVector<QPointF> CompiledPuzzlePath::evaluate() const
+{
+    QVector<QPointF> positions = m_positions;
+
+    for (const auto &instruction : m_instructions) {
+        QPointF &position = positions[instruction.slot];
+
+        switch (instruction.operation) {
+        case Operation::OFFSETCIRCULAR: {
+            QLineF lineToRandomOffset;
+            lineToRandomOffset.setP1(position);
+            lineToRandomOffset.setAngle(Jigsaw::randomNumber(0, 359));
+            lineToRandomOffset.setLength(Jigsaw::randomNumber(0, instruction.value) * m_lengthStartToEnd / 100);
+            position = lineToRandomOffset.p2();
+            break;
+        }
+        case Operation::OFFSETLINE: {
+            QLineF lineToRandomOffset;
+            lineToRandomOffset.setP1(position);
+            lineToRandomOffset.setAngle(QLineF(positions[instruction.line1P1], positions[instruction.line1P2]).angle());
+            lineToRandomOffset.setAngle(Jigsaw::randomNumber(0, 1) == 0 ? lineToRandomOffset.angle() : lineToRandomOffset.angle() - 180);
+            lineToRandomOffset.setLength(Jigsaw::randomNumber(0, instruction.value) * m_lengthStartToEnd / 100);
+            position = lineToRandomOffset.p2();
+            break;
+        }
+        case Operation::RESTRICTLINE: {
+            CustomPuzzlePath::changeDistanceFromLine(position, QLineF(positions[instruction.line1P1], positions[instruction.line1P2]), instruction.value);
+            break;
+        }
+        case Operation::RESTRICTINTERSECTION: {
+            QPointF intersectionPoint(0.0, 0.0);
+            QLineF::IntersectionType intersectionType = QLineF(positions[instruction.line1P1], positions[instruction.line1P2]).intersects(
+                                                        QLineF(positions[instruction.line2P1], positions[instruction.line2P2]), &intersectionPoint);
+            if (intersectionType != QLineF::NoIntersection) position = intersectionPoint;
+            break;
+        }
+        }
+    }
+    return positions;
+}
+
+const QVector<CompiledPuzzlePath::Segment> &CompiledPuzzlePath::segments() const
+{
+    return m_segments;
+}
+
+const QVector<CompiledPuzzlePath::Instruction> &CompiledPuzzlePath::instructions() const
+{
+    return m_instructions;
+}
+
+void CompiledPuzzlePath::write(QDataStream &stream) const
+{
+    stream << m_lengthStartToEnd;
+    stream << quint16(m_instructions.size());
+    for (const auto &instruction : m_instructions) {
+        stream << quint8(instruction.operation) << qint16(instruction.slot)
+               << qint16(instruction.line1P1) << qint16(instruction.line1P2) << qint16(instruction.line2P1) << qint16(instruction.line2P2)
+               << instruction.value;
+    }
+    stream << quint16(m_segments.size());
+    for (const auto &segment : m_segments) {
+        stream << quint8(segment.typeOfLine) << qint16(segment.pathPoint) << qint16(segment.controlPoint);
+    }
+}
+
+bool CompiledPuzzlePath::read(QDataStream &stream, const QVector<CustomPuzzlePath::PathPoint> &pathPoints)
+{
+    m_positions.resize(pathPoints.size() * 2);
+    for (int i = 0; i < pathPoints.size(); ++i) {
+        m_positions[pathPointSlot(i)] = pathPoints[i].position;
+        m_positions[controlPointSlot(i)] = pathPoints[i].positionControlPoint;
+    }
+
+    quint16 numberOfInstructions = 0;
+    stream >> m_lengthStartToEnd >> numberOfInstructions;
+    m_instructions.clear();
+    for (int i = 0; i < numberOfInstructions; ++i) {
+        quint8 operation;
+        qint16 slot, line1P1, line1P2, line2P1, line2P2;
+        double value;
+        stream >> operation >> slot >> line1P1 >> line1P2 >> line2P1 >> line2P2 >> value;
+        if (stream.status() != QDataStream::Ok || operation > quint8(Operation::RESTRICTINTERSECTION) || !isSlot(slot)) return false;
+
+        Operation typeOfOperation = static_cast<Operation>(operation);
+        bool usesLine1 = typeOfOperation != Operation::OFFSETCIRCULAR;
+        bool usesLine2 = typeOfOperation == Operation::RESTRICTINTERSECTION;
+        if ((usesLine1 && (!isSlot(line1P1) || !isSlot(line1P2))) || (usesLine2 && (!isSlot(line2P1) || !isSlot(line2P2)))) return false;
+        m_instructions.push_back({typeOfOperation, slot, line1P1, line1P2, line2P1, line2P2, value});
+    }
+
+    quint16 numberOfSegments = 0;
+    stream >> numberOfSegments;
+    m_segments.clear();
+    for (int i = 0; i < numberOfSegments; ++i) {
+        quint8 typeOfLine;
+        qint16 pathPoint, controlPoint;
+        stream >> typeOfLine >> pathPoint >> controlPoint;
+        if (stream.status() != QDataStream::Ok || typeOfLine > quint8(CustomPuzzlePath::TypeOfLine::CURVE) || !isSlot(pathPoint) || !isSlot(controlPoint)) return false;
+        m_segments.push_back({static_cast<CustomPuzzlePath::TypeOfLine>(typeOfLine), pathPoint, controlPoint});
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool CompiledPuzzlePath::isEquivalentTo(const CompiledPuzzlePath &other) const
+{
+    return m_positions == other.m_positions && m_instructions == other.m_instructions && m_segments == other.m_segments &&
+           m_lengthStartToEnd == other.m_lengthStartToEnd;
+}
+
+int CompiledPuzzlePath::pathPointSlot(int index)
+{
+    return 2 * index;
+}
+
+int CompiledPuzzlePath::controlPointSlot(int index)
+{
+    return 2 * index + 1;
+}
+
+int CompiledPuzzlePath::slotOf(const QVector<CustomPuzzlePath::PathPoint> &pathPoints, const QPointF *point)
+{
+    if (point == nullptr) return -1;
+
+    // 只比较地址，不访问指针指向的内容，所以失效的指针也是安全的
+    for (int i = 0; i < pathPoints.size(); ++i) {
+        if (point == &pathPoints[i].position) return pathPointSlot(i);
+        if (i != 0 && point == &pathPoints[i].positionControlPoint) return controlPointSlot(i);
+    }
+    return -1;
+}
+
+bool CompiledPuzzlePath::isSlot(int slot) const
+{
+    return slot >= 0 && slot < m_positions.size();
+}
+
+void CompiledPuzzlePath::addRestriction(const QVector<CustomPuzzlePath::PathPoint> &pathPoints, int slot, const CustomPuzzlePath::Restriction &restriction)
+{
+    switch (restriction.type) {
+    case CustomPuzzlePath::TypeOfRestriction::NONE:
+    case CustomPuzzlePath::TypeOfRestriction::FIXEDPOSITION:
+        break;
+    case CustomPuzzlePath::TypeOfRestriction::LINE: {
+        int line1P1 = slotOf(pathPoints, restriction.line1P1);
+        int line1P2 = slotOf(pathPoints, restriction.line1P2);
+        if (line1P1 < 0 || line1P2 < 0) break;
+        // 和编辑器一样，距离是起点到终点距离的百分比
+        double distance = m_lengthStartToEnd * restriction.distanceFromLine / 100;
+        m_instructions.push_back({Operation::RESTRICTLINE, slot, line1P1, line1P2, -1, -1, distance});
+        break;
+    }
+    case CustomPuzzlePath::TypeOfRestriction::INTERSECTIONPOINT: {
+        int line1P1 = slotOf(pathPoints, restriction.line1P1);
+        int line1P2 = slotOf(pathPoints, restriction.line1P2);
+        int line2P1 = slotOf(pathPoints, restriction.line2P1);
+        int line2P2 = slotOf(pathPoints, restriction.line2P2);
+        if (line1P1 < 0 || line1P2 < 0 || line2P1 < 0 || line2P2 < 0) break;
+        m_instructions.push_back({Operation::RESTRICTINTERSECTION, slot, line1P1, line1P2, line2P1, line2P2, 0.0});
+        break;
+    }
+    }
+}
+
+bool CompiledPuzzlePath::Instruction::operator==(const Instruction &other) const
+{
+    return operation == other.operation && slot == other.slot && line1P1 == other.line1P1 && line1P2 == other.line1P2 &&
+           line2P1 == other.line2P1 && line2P2 == other.line2P2 && value == other.value;
+}
+
+bool CompiledPuzzlePath::Segment::operator==(const Segment &other) const
+{
+    return typeOfLine == other.typeOfLine && pathPoint == other.pathPoint && controlPoint == other.controlPoint;
+}
@@ -0,0 +1,81 @@
+#ifndef COMPILED_PUZZLE_PATH_H
+#define COMPILED_PUZZLE_PATH_H
+
+#include "custom_puzzle_path.h"
+#include <QPointF>
+#include <QVector>
+
+/*
+ * The CompiledPuzzlePath is the form of a CustomPuzzlePath that is used to generate paths. It is created by the
+ * CustomPuzzlePath whenever the path is changed and never changes afterwards, so it can be shared between threads.
+ *
+ * All points are stored in one flat array of slots. The position of path point i is slot 2 * i, its control point is
+ * slot 2 * i + 1. The QPointF pointers of the random offsets and restrictions are resolved to slots when the path is
+ * compiled, pointers that don't point into the path are ignored. The instructions are sorted, so evaluate() needs a
+ * single pass over them:
+ *
+ * 1. The circular offsets of all points.
+ * 2. For every point in order its line offset, followed by its restriction. Restrictions use the current value of the
+ *    slots they depend on, so points restricted to a line or an intersection follow randomized points before them.
+ *
+ * The segments describe the path itself, a line or a quadratic curve from the previous path point to path point i.
+ *
+ * write() stores the instructions and segments, read() takes the positions from the path points the compiled path
+ * belongs to. read() checks every slot, so a damaged file can't make evaluate() read outside of the positions.
+ * isEquivalentTo() compares two compiled paths, e.g. one that was read with one compiled from the same points.
+ */
+
+class CompiledPuzzlePath
+{
+public:
+    enum class Operation {
+        OFFSETCIRCULAR,
+        OFFSETLINE,
+        RESTRICTLINE,
+        RESTRICTINTERSECTION
+    };
+
+    struct Instruction {
+        Operation operation;
+        int slot;
+        int line1P1, line1P2, line2P1, line2P2;
+        double value;
+
+        bool operator==(const Instruction &other) const;
+    };
+
+    struct Segment {
+        CustomPuzzlePath::TypeOfLine typeOfLine;
+        int pathPoint;
+        int controlPoint;
+
+        bool operator==(const Segment &other) const;
+    };
+
+    CompiledPuzzlePath();
+    explicit CompiledPuzzlePath(const QVector<CustomPuzzlePath::PathPoint> &pathPoints);
+
+    const QVector<QPointF> &positions() const;
+    QVector<QPointF> evaluate() const;
+    const QVector<Segment> &segments() const;
+    const QVector<Instruction> &instructions() const;
+
+    void write(QDataStream &stream) const;
+    bool read(QDataStream &stream, const QVector<CustomPuzzlePath::PathPoint> &pathPoints);
+    bool isEquivalentTo(const CompiledPuzzlePath &other) const;
+
+    static int pathPointSlot(int index);
+    static int controlPointSlot(int index);
+    static int slotOf(const QVector<CustomPuzzlePath::PathPoint> &pathPoints, const QPointF *point);
+
+private:
+    QVector<QPointF> m_positions;
+    QVector<Instruction> m_instructions;
+    QVector<Segment> m_segments;
+    double m_lengthStartToEnd;
+
+    bool isSlot(int slot) const;
+    void addRestriction(const QVector<CustomPuzzlePath::PathPoint> &pathPoints, int slot, const CustomPuzzlePath::Restriction &restriction);
+};
+
+#endif // COMPILED_PUZZLE_PATH_H
@@ -1,17 +1,41 @@
 #include "custom_puzzle_path.h"
+#include "compiled_puzzle_path.h"
 #include "qdebug.h"
 #include <random>
+#include <utility>
 
 CustomPuzzlePath::CustomPuzzlePath()
     : m_pathPoints(QVector<CustomPuzzlePath::PathPoint>(0))
+    , m_recommendedInnerBoundsPercentage(0.0)
 {
     m_pathPoints.push_back(CustomPuzzlePath::PathPoint(QPointF(0.0, 0.0), RandomOffset(TypeOfRandomOffset::NONE, 0.0), Restriction(TypeOfRestriction::FIXEDPOSITION)));
     m_pathPoints.push_back(CustomPuzzlePath::PathPoint(QPoint(0.0, 100.0), RandomOffset(TypeOfRandomOffset::NONE, 0.0), Restriction(TypeOfRestriction::FIXEDPOSITION)));
+    compile();
 }
 
 CustomPuzzlePath::CustomPuzzlePath(const QVector<PathPoint> &pathPoints)
     : m_pathPoints(pathPoints)
+    , m_recommendedInnerBoundsPercentage(0.0)
 {
+    detach();
+    compile();
+}
+
+CustomPuzzlePath::CustomPuzzlePath(const CustomPuzzlePath &other)
+    : m_pathPoints(other.m_pathPoints)
+    , m_compiled(other.m_compiled)
+    , m_recommendedInnerBoundsPercentage(other.m_recommendedInnerBoundsPercentage)
+{
+    detach();
+}
+
+CustomPuzzlePath &CustomPuzzlePath::operator=(const CustomPuzzlePath &other)
+{
+    m_pathPoints = other.m_pathPoints;
+    m_compiled = other.m_compiled;
+    m_recommendedInnerBoundsPercentage = other.m_recommendedInnerBoundsPercentage;
+    detach();
+    return *this;
 }
 
 CustomPuzzlePath::~CustomPuzzlePath()
@@ -23,6 +47,7 @@ void CustomPuzzlePath::insertNewPoint(const PathPoint &pathPoint, int index)
 {
     if (index < 0 || index >= numberOfPoints()) m_pathPoints.push_back(pathPoint);
     else m_pathPoints.insert(index, pathPoint);
+    compile();
 }
 
 void CustomPuzzlePath::removePoint(int index)
@@ -36,6 +61,7 @@ void CustomPuzzlePath::removePoint(int index)
     else {
         m_pathPoints.removeAt(index);
     }
+    compile();
 }
 
 void CustomPuzzlePath::setPositionPathPoint(int index, const QPointF &pathPoint)
@@ -69,6 +95,7 @@ void CustomPuzzlePath::setPositionPathPoint(int index, const QPointF &pathPoint)
         break;
     }
     }
+    compile();
 }
 
 void CustomPuzzlePath::setPositionControlPoint(int index, const QPointF &controlPoint)
@@ -101,6 +128,7 @@ void CustomPuzzlePath::setPositionControlPoint(int index, const QPointF &control
         break;
     }
     }
+    compile();
 }
 
 void CustomPuzzlePath::setTypeOfLine(int index, TypeOfLine typeOfLine)
@@ -108,6 +136,7 @@ void CustomPuzzlePath::setTypeOfLine(int index, TypeOfLine typeOfLine)
     if (index <= 0 || index >= m_pathPoints.size()) return;
 
     m_pathPoints[index].typeOfLine = typeOfLine;
+    compile();
 }
 
 void CustomPuzzlePath::setRestrictionPathPoint(int index, TypeOfRestriction type, QPointF *line1P1, QPointF *line1P2, QPointF *line2P1, QPointF *line2P2, double distanceFromLine)
@@ -138,7 +167,10 @@ void CustomPuzzlePath::setRestrictionPathPoint(int index, TypeOfRestriction type
         QPointF intersectionPoint(0.0, 0.0);
         QLineF::IntersectionType intersectionType = QLineF(*line1P1, *line1P2).intersects(QLineF(*line2P1, *line2P2), &intersectionPoint);
         if (intersectionType != QLineF::NoIntersection) m_pathPoints[index].position = intersectionPoint;
-        else return;
+        else {
+            compile();
+            return;
+        }
         break;
     }
     }
@@ -148,6 +180,7 @@ void CustomPuzzlePath::setRestrictionPathPoint(int index, TypeOfRestriction type
     m_pathPoints[index].restriction.line2P1 = line2P1;
     m_pathPoints[index].restriction.line2P2 = line2P2;
     m_pathPoints[index].restriction.distanceFromLine = distanceFromLine;
+    compile();
 }
 
 void CustomPuzzlePath::setRestrictionControlPoint(int index, TypeOfRestriction type, QPointF *line1P1, QPointF *line1P2, QPointF *line2P1, QPointF *line2P2, double distanceFromLine)
@@ -178,7 +211,10 @@ void CustomPuzzlePath::setRestrictionControlPoint(int index, TypeOfRestriction t
         QPointF intersectionPoint(0.0, 0.0);
         QLineF::IntersectionType intersectionType = QLineF(*line1P1, *line1P2).intersects(QLineF(*line2P1, *line2P2), &intersectionPoint);
         if (intersectionType != QLineF::NoIntersection) m_pathPoints[index].positionControlPoint = intersectionPoint;
-        else return;
+        else {
+            compile();
+            return;
+        }
         break;
     }
     }
@@ -188,6 +224,7 @@ void CustomPuzzlePath::setRestrictionControlPoint(int index, TypeOfRestriction t
     m_pathPoints[index].restrictionControlPoint.line2P1 = line2P1;
     m_pathPoints[index].restrictionControlPoint.line2P2 = line2P2;
     m_pathPoints[index].restrictionControlPoint.distanceFromLine = distanceFromLine;
+    compile();
 }
 
 void CustomPuzzlePath::setRandomOffsetPathPoint(int index, TypeOfRandomOffset type, double value, QPointF *lineP1, QPointF *lineP2)
@@ -216,6 +253,7 @@ void CustomPuzzlePath::setRandomOffsetPathPoint(int index, TypeOfRandomOffset ty
     m_pathPoints[index].randomOffset.value = value;
     m_pathPoints[index].randomOffset.lineP1 = lineP1;
     m_pathPoints[index].randomOffset.lineP2 = lineP2;
+    compile();
 }
 
 void CustomPuzzlePath::setRandomOffsetControlPoint(int index, TypeOfRandomOffset type, double value, QPointF *lineP1, QPointF *lineP2)
@@ -244,6 +282,7 @@ void CustomPuzzlePath::setRandomOffsetControlPoint(int index, TypeOfRandomOffset
     m_pathPoints[index].randomOffsetControlPoint.value = value;
     m_pathPoints[index].randomOffsetControlPoint.lineP1 = lineP1;
     m_pathPoints[index].randomOffsetControlPoint.lineP2 = lineP2;
+    compile();
 }
 
 CustomPuzzlePath::PathPoint CustomPuzzlePath::pathPoint(int index) const
@@ -272,78 +311,91 @@ int CustomPuzzlePath::numberOfPoints() const
     return m_pathPoints.size();
 }
 
-CustomPuzzlePath CustomPuzzlePath::getRandomizedPath() const
+const CompiledPuzzlePath &CustomPuzzlePath::compiled() const
 {
-    CustomPuzzlePath randomizedPath = *this;
-    double lengthStartToEnd = QLineF(randomizedPath.pathPoint(0).position, randomizedPath.pathPoint(randomizedPath.numberOfPoints() - 1).position).length();
-
-    //Solve circular offset
-
-    for (int i = 0; i < randomizedPath.numberOfPoints(); ++i) {
-        if (randomizedPath.pathPoint(i).randomOffset.type == TypeOfRandomOffset::CIRCULAR) {
-            QLineF pathPointToRandomOffset;
-            pathPointToRandomOffset.setP1(randomizedPath.pathPoint(i).position);
-            pathPointToRandomOffset.setAngle(Jigsaw::randomNumber(0, 359));
-            pathPointToRandomOffset.setLength(Jigsaw::randomNumber(0, randomizedPath.pathPoint(i).randomOffset.value) * lengthStartToEnd / 100);
-            randomizedPath.setRandomOffsetPathPoint(i, TypeOfRandomOffset::NONE, 0.0);
-            randomizedPath.setPositionPathPoint(i, pathPointToRandomOffset.p2());
-            for (int j = 0; j < randomizedPath.numberOfPoints(); ++j) {
-                randomizedPath.setPositionPathPoint(j, randomizedPath.pathPoint(j).position);
-                if (j == 0) continue;
-                randomizedPath.setPositionControlPoint(j, randomizedPath.pathPoint(j).positionControlPoint);
-            }
-        }
-        if (i == 0) continue;
-        if (randomizedPath.pathPoint(i).randomOffsetControlPoint.type == TypeOfRandomOffset::CIRCULAR) {
-            QLineF pathControlPointToRandomOffset;
-            pathControlPointToRandomOffset.setP1(randomizedPath.pathPoint(i).positionControlPoint);
-            pathControlPointToRandomOffset.setAngle(Jigsaw::randomNumber(0, 359));
-            pathControlPointToRandomOffset.setLength(Jigsaw::randomNumber(0, randomizedPath.pathPoint(i).randomOffsetControlPoint.value) * lengthStartToEnd / 100);
-            randomizedPath.setRandomOffsetControlPoint(i, TypeOfRandomOffset::NONE, 0.0);
-            randomizedPath.setPositionControlPoint(i, pathControlPointToRandomOffset.p2());
-            for (int j = 0; j < randomizedPath.numberOfPoints(); ++j) {
-                randomizedPath.setPositionPathPoint(j, randomizedPath.pathPoint(j).position);
-                if (j == 0) continue;
-                randomizedPath.setPositionControlPoint(j, randomizedPath.pathPoint(j).positionControlPoint);
-            }
+    return *m_compiled;
+}
+
+double CustomPuzzlePath::recommendedInnerBoundsPercentage() const
+{
+    return m_recommendedInnerBoundsPercentage;
+}
+
+void CustomPuzzlePath::setRecommendedInnerBoundsPercentage(double percentage)
+{
+    m_recommendedInnerBoundsPercentage = percentage;
+}
+
+void CustomPuzzlePath::write(QDataStream &stream) const
+{
+    stream << quint16(m_pathPoints.size());
+    for (PathPoint pathPoint : m_pathPoints) {
+        stream << pathPoint.position << pathPoint.positionControlPoint << quint8(pathPoint.typeOfLine);
+        stream << quint8(pathPoint.randomOffset.type) << pathPoint.randomOffset.value;
+        stream << quint8(pathPoint.restriction.type) << pathPoint.restriction.distanceFromLine;
+        stream << quint8(pathPoint.randomOffsetControlPoint.type) << pathPoint.randomOffsetControlPoint.value;
+        stream << quint8(pathPoint.restrictionControlPoint.type) << pathPoint.restrictionControlPoint.distanceFromLine;
+
+        // 指针保存为槽，-1 表示没有点
+        for (QPointF** pointer : pointers(pathPoint)) {
+            stream << qint16(CompiledPuzzlePath::slotOf(m_pathPoints, *pointer));
         }
     }
+    stream << m_recommendedInnerBoundsPercentage;
+    m_compiled->write(stream);
+}
 
-    //Solve line offset
-
-    for (int i = 0; i < randomizedPath.numberOfPoints(); ++i) {
-        if (randomizedPath.pathPoint(i).randomOffset.type == TypeOfRandomOffset::LINE) {
-            QLineF pathPointToRandomOffset;
-            pathPointToRandomOffset.setP1(randomizedPath.pathPoint(i).position);
-            pathPointToRandomOffset.setAngle(QLineF(*randomizedPath.pathPoint(i).randomOffset.lineP1, *randomizedPath.pathPoint(i).randomOffset.lineP2).angle());
-            pathPointToRandomOffset.setAngle(Jigsaw::randomNumber(0, 1) == 0 ? pathPointToRandomOffset.angle() : pathPointToRandomOffset.angle() - 180);
-            pathPointToRandomOffset.setLength(Jigsaw::randomNumber(0, randomizedPath.pathPoint(i).randomOffset.value) * lengthStartToEnd / 100);
-            randomizedPath.setRandomOffsetPathPoint(i, TypeOfRandomOffset::NONE, 0.0);
-            randomizedPath.setPositionPathPoint(i, pathPointToRandomOffset.p2());
-            for (int i = 0; i < randomizedPath.numberOfPoints(); ++i) {
-                randomizedPath.setPositionPathPoint(i, randomizedPath.pathPoint(i).position);
-                if (i == 0) continue;
-                randomizedPath.setPositionControlPoint(i, randomizedPath.pathPoint(i).positionControlPoint);
-            }
-        }
-        if (i == 0) continue;
-        if (randomizedPath.pathPoint(i).randomOffsetControlPoint.type == TypeOfRandomOffset::LINE) {
-            QLineF pathControlPointToRandomOffset;
-            pathControlPointToRandomOffset.setP1(randomizedPath.pathPoint(i).positionControlPoint);
-            pathControlPointToRandomOffset.setAngle(QLineF(*randomizedPath.pathPoint(i).randomOffsetControlPoint.lineP1, *randomizedPath.pathPoint(i).randomOffsetControlPoint.lineP2).angle());
-            pathControlPointToRandomOffset.setAngle(Jigsaw::randomNumber(0, 1) == 0 ? pathControlPointToRandomOffset.angle() : pathControlPointToRandomOffset.angle() - 180);
-            pathControlPointToRandomOffset.setLength(Jigsaw::randomNumber(0, randomizedPath.pathPoint(i).randomOffsetControlPoint.value) * lengthStartToEnd / 100);
-            randomizedPath.setRandomOffsetControlPoint(i, TypeOfRandomOffset::NONE, 0.0);
-            randomizedPath.setPositionControlPoint(i, pathControlPointToRandomOffset.p2());
-            for (int i = 0; i < randomizedPath.numberOfPoints(); ++i) {
-                randomizedPath.setPositionPathPoint(i, randomizedPath.pathPoint(i).position);
-                if (i == 0) continue;
-                randomizedPath.setPositionControlPoint(i, randomizedPath.pathPoint(i).positionControlPoint);
-            }
+bool CustomPuzzlePath::read(QDataStream &stream)
+{
+    quint16 numberOfPoints = 0;
+    stream >> numberOfPoints;
+    if (stream.status() != QDataStream::Ok || numberOfPoints < 2) return false;
+
+    QVector<PathPoint> pathPoints(numberOfPoints);
+    QVector<qint16> slots;
+    for (auto &pathPoint : pathPoints) {
+        quint8 typeOfLine, randomOffsetType, restrictionType, randomOffsetControlPointType, restrictionControlPointType;
+        stream >> pathPoint.position >> pathPoint.positionControlPoint >> typeOfLine;
+        stream >> randomOffsetType >> pathPoint.randomOffset.value;
+        stream >> restrictionType >> pathPoint.restriction.distanceFromLine;
+        stream >> randomOffsetControlPointType >> pathPoint.randomOffsetControlPoint.value;
+        stream >> restrictionControlPointType >> pathPoint.restrictionControlPoint.distanceFromLine;
+        if (typeOfLine > quint8(TypeOfLine::CURVE) ||
+            randomOffsetType > quint8(TypeOfRandomOffset::LINE) || randomOffsetControlPointType > quint8(TypeOfRandomOffset::LINE) ||
+            restrictionType > quint8(TypeOfRestriction::INTERSECTIONPOINT) || restrictionControlPointType > quint8(TypeOfRestriction::INTERSECTIONPOINT)) return false;
+        pathPoint.typeOfLine = static_cast<TypeOfLine>(typeOfLine);
+        pathPoint.randomOffset.type = static_cast<TypeOfRandomOffset>(randomOffsetType);
+        pathPoint.restriction.type = static_cast<TypeOfRestriction>(restrictionType);
+        pathPoint.randomOffsetControlPoint.type = static_cast<TypeOfRandomOffset>(randomOffsetControlPointType);
+        pathPoint.restrictionControlPoint.type = static_cast<TypeOfRestriction>(restrictionControlPointType);
+
+        for (int i = 0; i < pointers(pathPoint).size(); ++i) {
+            qint16 slot = -1;
+            stream >> slot;
+            slots.push_back(slot);
         }
     }
 
-    return randomizedPath;
+    double recommendedInnerBoundsPercentage = 0.0;
+    stream >> recommendedInnerBoundsPercentage;
+    std::shared_ptr<CompiledPuzzlePath> compiled = std::make_shared<CompiledPuzzlePath>();
+    if (stream.status() != QDataStream::Ok || !compiled->read(stream, pathPoints)) return false;
+
+    // 先交给自己，指针才能指向这个对象的点
+    QVector<PathPoint> previousPathPoints = std::exchange(m_pathPoints, std::move(pathPoints));
+    int index = 0;
+    for (auto &pathPoint : m_pathPoints) {
+        for (QPointF** pointer : pointers(pathPoint)) *pointer = pointOfSlot(slots[index++]);
+    }
+
+    // 保存的编译结果必须和点一致，否则文件被改过或已损坏
+    if (!compiled->isEquivalentTo(CompiledPuzzlePath(m_pathPoints))) {
+        m_pathPoints = std::move(previousPathPoints);
+        return false;
+    }
+    m_compiled = compiled;
+    m_recommendedInnerBoundsPercentage = recommendedInnerBoundsPercentage;
+    return true;
 }
 
 void CustomPuzzlePath::changeDistanceFromLine(QPointF &pointToChange, const QLineF &line, double newDistance)
@@ -356,3 +408,40 @@ void CustomPuzzlePath::changeDistanceFromLine(QPointF &pointToChange, const QLin
     lineNormalVector.setLength(newDistance);
     pointToChange = lineNormalVector.p2();
 }
+
+void CustomPuzzlePath::compile()
+{
+    // 编译后的路径不会再改变，所有副本和工作线程都可以共用
+    m_compiled = std::make_shared<CompiledPuzzlePath>(m_pathPoints);
+    m_recommendedInnerBoundsPercentage = 0.0;
+}
+
+void CustomPuzzlePath::detach()
+{
+    if (m_pathPoints.isDetached()) return;
+
+    // 复制时马上复制一份点，指针改为指向自己的点，不再指向原来的路径
+    QVector<PathPoint> source = m_pathPoints;
+    m_pathPoints.detach();
+    for (auto &pathPoint : m_pathPoints) {
+        for (QPointF** pointer : pointers(pathPoint)) *pointer = pointOfSlot(CompiledPuzzlePath::slotOf(source, *pointer));
+    }
+}
+
+QPointF *CustomPuzzlePath::pointOfSlot(int slot)
+{
+    int index = slot / 2;
+    if (slot < 0 || index >= m_pathPoints.size()) return nullptr;
+
+    if (slot % 2 == 0) return &m_pathPoints[index].position;
+    return index != 0 ? &m_pathPoints[index].positionControlPoint : nullptr;
+}
+
+QVector<QPointF **> CustomPuzzlePath::pointers(PathPoint &pathPoint)
+{
+    return {&pathPoint.randomOffset.lineP1, &pathPoint.randomOffset.lineP2,
+            &pathPoint.restriction.line1P1, &pathPoint.restriction.line1P2, &pathPoint.restriction.line2P1, &pathPoint.restriction.line2P2,
+            &pathPoint.randomOffsetControlPoint.lineP1, &pathPoint.randomOffsetControlPoint.lineP2,
+            &pathPoint.restrictionControlPoint.line1P1, &pathPoint.restrictionControlPoint.line1P2,
+            &pathPoint.restrictionControlPoint.line2P1, &pathPoint.restrictionControlPoint.line2P2};
+}
@@ -3,10 +3,27 @@
 
 #include <QPainterPath>
 #include <QPoint>
+#include <QDataStream>
+#include <memory>
 #include "core/jigsaw_types.h"
 
+class CompiledPuzzlePath;
+
 /*
  * The CustomPuzzlePath class is used to store the user's inputs from the editor.
+ *
+ * Random offsets and restrictions refer to other points with pointers into this path. A copy gets its own points right
+ * away and its pointers are moved to them, so the restrictions of a copy never point into the original. Every change
+ * compiles the path into a CompiledPuzzlePath, which refers to points by index instead. Copies share the compiled path,
+ * use compiled() to generate paths from it.
+ *
+ * The recommended inner bounds percentage is the result of PuzzlePath::calculateRecommendedInnerBoundsPercentage() for
+ * this path. It is slow to calculate, so it is stored with the path, saved with it and reset by every change. A value
+ * of 0 or less means it wasn't calculated.
+ *
+ * write() and read() store the points with slots instead of pointers, followed by the compiled path. read() compiles the
+ * points again and fails if the stored compiled path differs, so a file with points and slots that don't belong
+ * together is never loaded.
  */
 
 class CustomPuzzlePath
@@ -120,6 +137,8 @@ public:
 
     CustomPuzzlePath();
     CustomPuzzlePath(const QVector<PathPoint> &pathPoints);
+    CustomPuzzlePath(const CustomPuzzlePath &other);
+    CustomPuzzlePath &operator=(const CustomPuzzlePath &other);
     ~CustomPuzzlePath();
 
     void insertNewPoint(const PathPoint &pathPoint, int index = -1);
@@ -142,12 +161,25 @@ public:
     QPointF* positionControlPoint(int index);
     int numberOfPoints() const;
 
-    CustomPuzzlePath getRandomizedPath() const;
+    const CompiledPuzzlePath &compiled() const;
+
+    double recommendedInnerBoundsPercentage() const;
+    void setRecommendedInnerBoundsPercentage(double percentage);
+
+    void write(QDataStream &stream) const;
+    bool read(QDataStream &stream);
 
     static void changeDistanceFromLine(QPointF &pointToChange, const QLineF &line, double newDistance);
 
 private:
     QVector<CustomPuzzlePath::PathPoint> m_pathPoints;
+    std::shared_ptr<const CompiledPuzzlePath> m_compiled;
+    double m_recommendedInnerBoundsPercentage;
+
+    void compile();
+    void detach();
+    QPointF* pointOfSlot(int slot);
+    static QVector<QPointF**> pointers(PathPoint &pathPoint);
 };
 
 #endif // CUSTOM_PUZZLE_PATH_H
@@ -0,0 +1,311 @@
+#include "merged_piece_sprite.h"
+#include "core/board_view.h"
+#include "core/trace.h"
+#include "core/render_stats.h"
+#include "tools/image_ops.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QtMath>
+
+MergedPieceSprite::MergedPieceSprite(QWidget *parent)
+    : QWidget{parent}
+    , m_anchor(nullptr)
+    , m_leader(nullptr)
+    , m_piecesOutdated(false)
+    , m_boardView(nullptr)
+    , m_scale(1.0)
+    , m_scaleOutdated(false)
+    , m_angle(0)
+    , m_rotatedAngle(0)
+{
+    // 和碎片一样由棋盘做点击检测
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+void MergedPieceSprite::setBoardView(const BoardView *boardView)
+{
+    m_boardView = boardView;
+    updateView();
+}
+
+void MergedPieceSprite::updateView()
+{
+    if (m_anchor && targetScale() != m_scale) {
+        if (isVisible()) reflatten();
+        else m_scaleOutdated = true;
+    }
+    placeWidget();
+    update();
+}
+
+void MergedPieceSprite::flatten(const QVector<PuzzlePiece*> &pieces)
+{
+    TraceSpan span("MergedPieceSprite::flatten");
+    // 清空之前先让碎片跟上，否则会按旧的位置拼图
+    syncPieces();
+    m_pieces.clear();
+    m_pieceOffsets.clear();
+    m_pieceIndices.clear();
+    m_pieceCells.clear();
+    m_cellSize = QSizeF();
+    m_anchor = nullptr;
+    m_leader = nullptr;
+    m_image = QImage();
+    m_hitMask = HitMask();
+    m_scale = targetScale();
+    m_scaleOutdated = false;
+    addPieces(pieces);
+}
+
+void MergedPieceSprite::addPieces(const QVector<PuzzlePiece*> &pieces)
+{
+    if (pieces.isEmpty()) return;
+    syncPieces();
+
+    if (m_scaleOutdated) {
+        // 图片的缩放已经过时，显示时连同新的碎片一起重新拼图
+        for (auto piece : pieces) {
+            piece->hide();
+            insertPiece(piece);
+        }
+        return;
+    }
+
+    if (!m_anchor) {
+        m_anchor = pieces.first();
+        m_angle = m_anchor->angle();
+        m_rotatedAngle = m_angle;
+        m_origin = m_anchor->spriteRect().topLeft();
+    }
+    else {
+        // 合并时整组碎片可能被移动过
+        followAnchor();
+    }
+
+    // 碎片按图片的缩放绘制，位置是图片中的像素
+    QVector<QImage> images;
+    QVector<QPoint> offsets;
+    QRect imageRect(QPoint(0, 0), m_image.size());
+    QRect bounds = imageRect;
+    for (auto piece : pieces) {
+        images.push_back(piece->renderSprite(m_scale));
+        offsets.push_back(((piece->spriteRect().topLeft() - m_origin) * m_scale).toPoint());
+        bounds |= QRect(offsets.last(), images.last().size());
+    }
+    if (bounds != imageRect) {
+        // 新的碎片超出了图片，图片和遮罩一起扩大
+        QImage image(bounds.size(), ImageOps::FORMAT);
+        image.fill(Qt::transparent);
+        HitMask hitMask(bounds.size());
+        if (!m_image.isNull()) {
+            QPainter painter(&image);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(-bounds.topLeft(), m_image);
+            hitMask.unite(m_hitMask, -bounds.topLeft());
+        }
+        m_image = image;
+        m_hitMask = hitMask;
+        m_origin += QPointF(bounds.topLeft()) / m_scale;
+        for (QPoint &offset : offsets) {
+            offset -= bounds.topLeft();
+        }
+    }
+    m_anchorOffset = m_origin - m_anchor->spriteRect().topLeft();
+
+    // 只画新加入的碎片
+    QPainter painter(&m_image);
+    for (int i = 0; i < pieces.size(); ++i) {
+        painter.drawImage(offsets[i], images[i]);
+        m_hitMask.unite(HitMask(images[i]), offsets[i]);
+        pieces[i]->hide();
+        insertPiece(pieces[i]);
+    }
+    painter.end();
+
+    placeWidget();
+    update();
+    RenderStats::countRedraw();
+    updateMemoryUsage();
+}
+
+void MergedPieceSprite::followAnchor()
+{
+    if (!m_anchor || isRotated()) return;
+    syncPieces();
+    m_origin = m_anchor->spriteRect().topLeft() + m_anchorOffset;
+    placeWidget();
+}
+
+/*
+ * Moves the sprite to piece, which was dragged, without moving the other pieces of the group. They are marked as
+ * outdated and moved by syncPieces().
+ */
+
+void MergedPieceSprite::follow(PuzzlePiece *piece)
+{
+    int index = m_pieceIndices.value(piece, -1);
+    if (!m_anchor || index < 0 || isRotated()) return;
+
+    // 锚点碎片可能也没有移动，从跟随的碎片算出它的位置
+    m_leader = piece;
+    m_piecesOutdated = true;
+    m_origin = piece->spriteRect().topLeft() - m_pieceOffsets[index] + m_anchorOffset;
+    placeWidget();
+}
+
+void MergedPieceSprite::syncPieces()
+{
+    if (!m_piecesOutdated) return;
+    m_piecesOutdated = false;
+
+    // 组内碎片的角度和大小相同，spriteRect() 的偏移也是位置的偏移
+    int leaderIndex = m_pieceIndices.value(m_leader, -1);
+    if (leaderIndex < 0) return;
+    QPointF anchorPosition = m_leader->originalPosition() - m_pieceOffsets[leaderIndex];
+    for (int i = 0; i < m_pieces.size(); ++i) {
+        if (m_pieces[i] != m_leader) m_pieces[i]->move(anchorPosition + m_pieceOffsets[i]);
+    }
+}
+
+/*
+ * Shows the group rotated to angle around rotatingPoint (in coordinates of the board) by painting the image with a
+ * transformation. The widget is enlarged to the bounding rectangle of the rotated image.
+ */
+
+void MergedPieceSprite::rotate(int angle, const QPointF &rotatingPoint)
+{
+    m_rotatedAngle = angle;
+    m_rotatingPoint = rotatingPoint;
+    placeWidget();
+    update();
+}
+
+bool MergedPieceSprite::isRotated() const
+{
+    return m_rotatedAngle != m_angle;
+}
+
+QRectF MergedPieceSprite::boardRect() const
+{
+    return QRectF(m_origin, QSizeF(m_image.size()) / m_scale);
+}
+
+QRectF MergedPieceSprite::boundingBoardRect() const
+{
+    return m_boundingBoardRect;
+}
+
+bool MergedPieceSprite::hitTest(const QPoint &pos) const
+{
+    QPointF point = m_hitTransform.map(QPointF(pos) + QPointF(0.5, 0.5));
+    return m_hitMask.contains(qFloor(point.x()), qFloor(point.y()));
+}
+
+/*
+ * Returns the piece of the group under pos (in coordinates of the board widget). Only the pieces in the cell under pos
+ * are tested. If the hit mask and the masks of the pieces disagree by a pixel at the edges, the anchor is returned,
+ * since every piece drags the whole group.
+ */
+
+PuzzlePiece *MergedPieceSprite::pieceAt(const QPoint &pos) const
+{
+    // 碎片还没有跟上时，只有跟随的碎片在正确的位置上
+    if (m_piecesOutdated) return m_leader;
+    if (m_cellSize.isEmpty()) return m_anchor;
+
+    QPointF point = m_hitTransform.map(QPointF(pos - this->pos()) + QPointF(0.5, 0.5)) / m_scale + m_anchorOffset;
+    QPoint cell(qFloor(point.x() / m_cellSize.width()), qFloor(point.y() / m_cellSize.height()));
+    const QVector<int> indices = m_pieceCells.value(cell);
+    for (int i = indices.size() - 1; i >= 0; --i) {
+        PuzzlePiece* piece = m_pieces[indices[i]];
+        if (piece->geometry().contains(pos) && piece->hitTest(pos - piece->pos())) return piece;
+    }
+    return m_anchor;
+}
+
+void MergedPieceSprite::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    if (m_transform.type() <= QTransform::TxTranslate) {
+        // 没有缩放和旋转时只画需要重绘的部分
+        QPoint offset = QPointF(m_transform.dx(), m_transform.dy()).toPoint();
+        painter.drawImage(event->rect(), m_image, event->rect().translated(-offset));
+        return;
+    }
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setTransform(m_transform);
+    painter.drawImage(0, 0, m_image);
+}
+
+void MergedPieceSprite::showEvent(QShowEvent *event)
+{
+    if (m_scaleOutdated) reflatten();
+    QWidget::showEvent(event);
+}
+
+double MergedPieceSprite::targetScale() const
+{
+    return m_boardView ? m_boardView->levelScale() : 1.0;
+}
+
+/*
+ * Appends piece to the group and sorts it into every cell its sprite overlaps. The cells have the size of a piece and
+ * are relative to the anchor, so they stay valid while the group is moved.
+ */
+
+void MergedPieceSprite::insertPiece(PuzzlePiece *piece)
+{
+    QPointF offset = piece->spriteRect().topLeft() - m_anchor->spriteRect().topLeft();
+    if (m_cellSize.isEmpty()) m_cellSize = m_anchor->spriteRect().size();
+    m_pieceIndices.insert(piece, m_pieces.size());
+    m_pieces.push_back(piece);
+    m_pieceOffsets.push_back(offset);
+
+    QRectF rect(offset, m_cellSize);
+    int left = qFloor(rect.left() / m_cellSize.width());
+    int right = qFloor(rect.right() / m_cellSize.width());
+    int top = qFloor(rect.top() / m_cellSize.height());
+    int bottom = qFloor(rect.bottom() / m_cellSize.height());
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            m_pieceCells[QPoint(x, y)].push_back(m_pieces.size() - 1);
+        }
+    }
+}
+
+void MergedPieceSprite::reflatten()
+{
+    // flatten() 会清空 m_pieces，所以先复制
+    const QVector<PuzzlePiece*> pieces = m_pieces;
+    flatten(pieces);
+}
+
+/*
+ * Sets m_transform and the geometry of the widget. The image is mapped onto the board, rotated around the rotating
+ * point if the group is being rotated, and mapped onto the screen by the BoardView.
+ */
+
+void MergedPieceSprite::placeWidget()
+{
+    QTransform transform = QTransform::fromScale(1.0 / m_scale, 1.0 / m_scale) * QTransform::fromTranslate(m_origin.x(), m_origin.y());
+    if (isRotated()) {
+        QTransform rotation;
+        rotation.translate(m_rotatingPoint.x(), m_rotatingPoint.y());
+        rotation.rotate(m_angle - m_rotatedAngle);
+        rotation.translate(-m_rotatingPoint.x(), -m_rotatingPoint.y());
+        transform *= rotation;
+    }
+    m_boundingBoardRect = transform.mapRect(QRectF(m_image.rect()));
+    if (m_boardView) transform *= m_boardView->transform();
+
+    QRect rect = transform.mapRect(QRectF(m_image.rect())).toAlignedRect();
+    m_transform = transform * QTransform::fromTranslate(-rect.left(), -rect.top());
+    m_hitTransform = m_transform.inverted();
+    setGeometry(rect);
+}
+
+void MergedPieceSprite::updateMemoryUsage()
+{
+    m_imageMemory.set(MemoryBudget::imageBytes(m_image));
+    m_hitMaskMemory.set(m_hitMask.bytes());
+}
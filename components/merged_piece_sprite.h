@@ -0,0 +1,105 @@
+#ifndef MERGED_PIECE_SPRITE_H
+#define MERGED_PIECE_SPRITE_H
+
+#include "puzzle_piece.h"
+#include "tools/hit_mask.h"
+#include "core/memory_budget.h"
+#include <QWidget>
+#include <QImage>
+#include <QTransform>
+#include <QVector>
+#include <QHash>
+
+class BoardView;
+
+/*
+ * A MergedPieceSprite shows a large group of merged PuzzlePieces as a single image. flatten() draws the sprites of all
+ * pieces into one image and hides the pieces, so the board paints one widget for the group instead of one for every
+ * piece. addPieces() draws only the pieces that joined the group and enlarges the image if they lie outside of it. The
+ * pieces are never shown again, they keep being moved and rotated with the group, but they don't redraw themselves
+ * while they are hidden.
+ *
+ * The sprite follows its anchor, the first piece it was flattened from. After the pieces of the group were moved,
+ * followAnchor() moves the sprite by the same distance. While the group is dragged, only the dragged piece moves:
+ * follow() places the sprite next to it, and the hidden pieces stay where they are until syncPieces() moves them all
+ * at once, e.g. when the group is dropped. Everything that reads the positions of the pieces of a group has to call
+ * syncPieces() first, flatten() and addPieces() do it themselves. While the group is rotated, rotate() paints the image
+ * rotated around the rotating point instead of drawing it again. Once the rotation is finished, the group has to be
+ * flattened again at its new angle, isRotated() tells if that's necessary.
+ *
+ * The image is drawn at BoardView::levelScale() and painted scaled to the zoom of the view. updateView() only flattens
+ * the group again if the level scale changed, and not before the sprite is shown if it is hidden. boardRect() is the
+ * rectangle of the unrotated image on the board, boundingBoardRect() the rectangle the image covers while it is
+ * rotated, which is used for culling.
+ *
+ * The hit mask of the sprite is the union of the masks of its pieces. hitTest() takes a point in coordinates of the
+ * sprite, pieceAt() returns the piece under a point in coordinates of the board widget, so the board can forward mouse
+ * events to it. The pieces are sorted into cells of the size of a piece relative to the anchor, so pieceAt() only
+ * tests the few pieces that overlap the cell under the point. While the pieces aren't synced, it returns the piece the
+ * group follows, which is the only one at its real position.
+ */
+
+class MergedPieceSprite : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MergedPieceSprite(QWidget *parent = nullptr);
+
+    void setBoardView(const BoardView* boardView);
+    void updateView();
+
+    void flatten(const QVector<PuzzlePiece*> &pieces);
+    void addPieces(const QVector<PuzzlePiece*> &pieces);
+    void followAnchor();
+    void follow(PuzzlePiece* piece);
+    void syncPieces();
+
+    void rotate(int angle, const QPointF &rotatingPoint);
+    bool isRotated() const;
+
+    QRectF boardRect() const;
+    QRectF boundingBoardRect() const;
+    bool hitTest(const QPoint &pos) const;
+    PuzzlePiece* pieceAt(const QPoint &pos) const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+
+private:
+    QVector<PuzzlePiece*> m_pieces;
+    QVector<QPointF> m_pieceOffsets;            // 与 m_pieces 一一对应，碎片相对于锚点碎片的位置
+    QHash<const PuzzlePiece*, int> m_pieceIndices;
+    QHash<QPoint, QVector<int>> m_pieceCells;   // 按碎片大小划分的格子中有哪些碎片，坐标相对于锚点碎片
+    QSizeF m_cellSize;
+    PuzzlePiece* m_anchor;
+    QPointF m_anchorOffset;     // 图片左上角相对于锚点碎片 spriteRect() 左上角的偏移
+    PuzzlePiece* m_leader;      // 拖动时整组跟随的碎片，其他碎片在 syncPieces() 之前不移动
+    bool m_piecesOutdated;
+
+    const BoardView* m_boardView;
+    double m_scale;             // 图片的缩放
+    bool m_scaleOutdated;       // 隐藏时缩放级别变了，显示时重新拼图
+
+    QImage m_image;
+    QPointF m_origin;           // 图片左上角在棋盘上的位置（没有旋转时）
+    HitMask m_hitMask;
+    int m_angle;                // 拼成图片时碎片的角度
+    int m_rotatedAngle;         // 旋转中的角度
+    QPointF m_rotatingPoint;
+    QTransform m_transform;     // 从图片到控件的坐标变换
+    QTransform m_hitTransform;  // m_transform 的逆变换
+    QRectF m_boundingBoardRect;
+
+    MemoryUsage m_imageMemory{MemoryBudget::Category::ROTATEDSPRITES};
+    MemoryUsage m_hitMaskMemory{MemoryBudget::Category::MASKS};
+
+    double targetScale() const;
+    void insertPiece(PuzzlePiece* piece);
+    void reflatten();
+    void placeWidget();
+    void updateMemoryUsage();
+};
+
+#endif // MERGED_PIECE_SPRITE_H
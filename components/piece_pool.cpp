@@ -0,0 +1,75 @@
+#include "piece_pool.h"
+
+PiecePool::PiecePool(QWidget *parent)
+    : m_parent(parent)
+    , m_size(0)
+    , m_reusedPieces(0)
+{
+
+}
+
+PuzzlePiece *PiecePool::acquire(int id, const QSize &size, const QBrush &background, const QPainterPath &jigsawPath)
+{
+    if (m_size == 0) return new PuzzlePiece(id, size, background, jigsawPath, m_parent);
+
+    // 优先使用尺寸相同的碎片，它的精灵图可以直接重用。空的分组会被删除，所以找到的分组都不是空的
+    auto it = m_pieces.find(sizeKey(size));
+    if (it == m_pieces.end()) it = m_pieces.begin();
+
+    PuzzlePiece* piece = it->takeLast();
+    if (it->isEmpty()) m_pieces.erase(it);
+    --m_size;
+    ++m_reusedPieces;
+
+    piece->recycle(id, size, background, jigsawPath);
+    return piece;
+}
+
+void PiecePool::release(PuzzlePiece *piece)
+{
+    if (!piece) return;
+    if (m_size >= MAXPIECES || piece->parentWidget() != m_parent) {
+        delete piece;
+        return;
+    }
+
+    // retire() 保留碎片的尺寸，acquire() 按它查找
+    piece->retire();
+    m_pieces[sizeKey(piece->originalSize().toSize())].push_back(piece);
+    ++m_size;
+}
+
+int PiecePool::trim(int maxPieces)
+{
+    int deletedPieces = 0;
+    for (auto it = m_pieces.begin(); it != m_pieces.end() && m_size > maxPieces;) {
+        while (!it->isEmpty() && m_size > maxPieces) {
+            delete it->takeLast();
+            --m_size;
+            ++deletedPieces;
+        }
+        if (it->isEmpty()) it = m_pieces.erase(it);
+        else ++it;
+    }
+    return deletedPieces;
+}
+
+int PiecePool::size() const
+{
+    return m_size;
+}
+
+int PiecePool::reusedPieces() const
+{
+    return m_reusedPieces;
+}
+
+void PiecePool::resetStatistics()
+{
+    m_reusedPieces = 0;
+}
+
+quint64 PiecePool::sizeKey(const QSize &size)
+{
+    return (quint64(quint32(size.width())) << 32) | quint32(size.height());
+}
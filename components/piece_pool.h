@@ -0,0 +1,46 @@
+#ifndef PIECE_POOL_H
+#define PIECE_POOL_H
+
+#include "puzzle_piece.h"
+#include <QHash>
+#include <QVector>
+#include <QSize>
+
+/*
+ * The PiecePool keeps the PuzzlePieces of a finished or abandoned puzzle, so starting or loading the next puzzle doesn't
+ * create thousands of widgets again. release() retires a piece: it is hidden and drops its fragment, path and hit mask,
+ * but keeps the widget and its sprite. acquire() recycles a retired piece or creates a new one if the pool is empty.
+ *
+ * Pieces are kept by their size. acquire() prefers a piece of the requested size, because it can draw into the sprite
+ * it already has, so restarting a puzzle with the same number of pieces allocates no sprites at all. If there is none,
+ * a piece of another size is recycled and gets a new sprite.
+ *
+ * The pool keeps at most MAXPIECES pieces, release() deletes any piece beyond that. trim() deletes pooled pieces, for
+ * example if memory is low. All pieces are children of the parent widget, so the remaining ones are deleted with it.
+ */
+
+class PiecePool
+{
+    static constexpr int MAXPIECES = 10000;
+
+public:
+    explicit PiecePool(QWidget* parent);
+
+    PuzzlePiece* acquire(int id, const QSize &size, const QBrush &background, const QPainterPath &jigsawPath);
+    void release(PuzzlePiece* piece);
+    int trim(int maxPieces = 0);
+
+    int size() const;
+    int reusedPieces() const;
+    void resetStatistics();
+
+private:
+    QWidget* m_parent;
+    QHash<quint64, QVector<PuzzlePiece*>> m_pieces;  // 按碎片尺寸分组
+    int m_size;
+    int m_reusedPieces;
+
+    static quint64 sizeKey(const QSize &size);
+};
+
+#endif // PIECE_POOL_H
@@ -1,4 +1,5 @@
 #include "puzzle_path.h"
+#include "compiled_puzzle_path.h"
 
 PuzzlePath::PuzzlePath()
     : m_start(QPoint(0, 0))
@@ -169,9 +170,14 @@ QPainterPath PuzzlePath::singleJigsawPiecePath(const QRect &outerBounds, const Q
 {
     if (typeOfPiece == Jigsaw::TypeOfPiece::count) return QPainterPath();
 
-    QRect usedInnerBounds = useRecommendedInnerBounds && typeOfPiece != Jigsaw::TypeOfPiece::CUSTOM
-                            ? recommendedInnerBounds(outerBounds, typeOfPiece, minForcedPaths)
-                            : innerBounds;
+    QRect usedInnerBounds = innerBounds;
+    if (useRecommendedInnerBounds && typeOfPiece != Jigsaw::TypeOfPiece::CUSTOM) {
+        usedInnerBounds = recommendedInnerBounds(outerBounds, typeOfPiece, minForcedPaths);
+    }
+    else if (useRecommendedInnerBounds && customPath.recommendedInnerBoundsPercentage() > 0) {
+        // 自定义形状的内边界在编辑器中计算过，和形状一起保存
+        usedInnerBounds = innerBoundsFromPercentage(outerBounds, customPath.recommendedInnerBoundsPercentage());
+    }
     QPoint topLeft, topRight, bottomRight, bottomLeft;
     QRect topBounds, rightBounds, bottomBounds, leftBounds;
     QVector<PuzzlePath> jigsawPaths(4);
@@ -556,21 +562,20 @@ bool PuzzlePath::generateStandardFunnyPath()
 
 bool PuzzlePath::generateCustomPath()
 {
-    CustomPuzzlePath customPathTemp;
-    if (m_noRandom) customPathTemp = m_customPath;
+    const CompiledPuzzlePath &compiledPath = m_customPath.compiled();
+    const QVector<QPointF> &customPositions = compiledPath.positions();
+    const QVector<CompiledPuzzlePath::Segment> &segments = compiledPath.segments();
 
     QLineF lineStartToEnd(m_start, m_end);
     double lengthStartToEnd = lineStartToEnd.length();
     double angleStartToEnd = lineStartToEnd.angle();
 
-    QLineF customLineStartToEnd(m_customPath.pathPoint(0).position, m_customPath.pathPoint(m_customPath.numberOfPoints() - 1).position);
+    QPointF customStart = customPositions[CompiledPuzzlePath::pathPointSlot(0)];
+    QLineF customLineStartToEnd(customStart, customPositions[CompiledPuzzlePath::pathPointSlot(m_customPath.numberOfPoints() - 1)]);
     double customLengthStartToEnd = customLineStartToEnd.length();
 
-    QVector<QPointF> actualPathPoints;
-    actualPathPoints.push_back(m_start);
-
-    QVector<QPointF> actualControlPoints;
-    actualControlPoints.push_back(QPoint());
+    QVector<QPointF> positions;
+    QVector<QPointF> actualPositions(customPositions.size());
 
     int side;
     int emergencyCounter = 0;
@@ -579,29 +584,20 @@ bool PuzzlePath::generateCustomPath()
 
         side = Jigsaw::randomNumber(1, 2);
         side = (side == 1) ? 1 : -1;
-        if (m_noRandom) side = 1;
-        else customPathTemp = m_customPath.getRandomizedPath();
-
-        for (int i = 1; i < customPathTemp.numberOfPoints(); ++i) {
-            QLineF customLineStartToPathPoint(customPathTemp.pathPoint(0).position, customPathTemp.pathPoint(i).position);
-            double angle = angleStartToEnd + customLineStartToEnd.angleTo(customLineStartToPathPoint) * side;
-            double length = customLineStartToPathPoint.length() / customLengthStartToEnd * lengthStartToEnd;
-            QLineF lineStartToActualPathPoint;
-            lineStartToActualPathPoint.setP1(m_start);
-            lineStartToActualPathPoint.setAngle(angle);
-            lineStartToActualPathPoint.setLength(length);
-            QPointF actualPathPoint = lineStartToActualPathPoint.p2();
-            actualPathPoints.push_back(actualPathPoint);
-
-            QLineF customLineStartToControlPoint(customPathTemp.pathPoint(0).position, customPathTemp.pathPoint(i).positionControlPoint);
-            angle = angleStartToEnd + customLineStartToEnd.angleTo(customLineStartToControlPoint) * side;
-            length = customLineStartToControlPoint.length() / customLengthStartToEnd * lengthStartToEnd;
-            QLineF lineStartToActualControlPoint;
-            lineStartToActualControlPoint.setP1(m_start);
-            lineStartToActualControlPoint.setAngle(angle);
-            lineStartToActualControlPoint.setLength(length);
-            QPointF actualControlPoint = lineStartToActualControlPoint.p2();
-            actualControlPoints.push_back(actualControlPoint);
+        if (m_noRandom) {
+            side = 1;
+            positions = customPositions;
+        }
+        else positions = compiledPath.evaluate();
+
+        // 把编辑器中的坐标转换到起点和终点之间
+        for (int i = 0; i < positions.size(); ++i) {
+            QLineF customLineStartToPoint(customStart, positions[i]);
+            QLineF lineStartToActualPoint;
+            lineStartToActualPoint.setP1(m_start);
+            lineStartToActualPoint.setAngle(angleStartToEnd + customLineStartToEnd.angleTo(customLineStartToPoint) * side);
+            lineStartToActualPoint.setLength(customLineStartToPoint.length() / customLengthStartToEnd * lengthStartToEnd);
+            actualPositions[i] = lineStartToActualPoint.p2();
         }
 
         ++emergencyCounter;
@@ -609,10 +605,10 @@ bool PuzzlePath::generateCustomPath()
         m_path.clear();
         m_path.moveTo(m_start);
 
-        for (int i = 1; i < actualPathPoints.size(); ++i) {
-            m_customPath.pathPoint(i).typeOfLine == CustomPuzzlePath::TypeOfLine::STRAIGHT
-                    ? m_path.lineTo(actualPathPoints[i])
-                    : m_path.quadTo(actualControlPoints[i], actualPathPoints[i]);
+        for (const auto &segment : segments) {
+            segment.typeOfLine == CustomPuzzlePath::TypeOfLine::STRAIGHT
+                    ? m_path.lineTo(actualPositions[segment.pathPoint])
+                    : m_path.quadTo(actualPositions[segment.controlPoint], actualPositions[segment.pathPoint]);
         }
         if (m_noRandom) break;
     }
@@ -749,15 +745,7 @@ QRect PuzzlePath::recommendedInnerBounds(const QRect &outerBounds, Jigsaw::TypeO
         break;
     }
 
-    double width = sizePercentage * outerBounds.width();
-    double height = sizePercentage * outerBounds.height();
-    if (width > height) width = height;
-    if (height > width) height = width;
-
-    QPoint innerBoundsTopLeft = outerBounds.topLeft() + QPoint((outerBounds.width() - round(width)) / 2, (outerBounds.height() - round(height)) / 2);
-    QSize innerBoundsSize(width, height);
-    QRect innerBounds(innerBoundsTopLeft, innerBoundsSize);
-    return innerBounds;
+    return innerBoundsFromPercentage(outerBounds, sizePercentage);
 
 //    Test Result 2023-05-09 with QSize(1000, 1000):
 //    Type of Piece: TRAPEZOID
@@ -792,6 +780,19 @@ QRect PuzzlePath::recommendedInnerBounds(const QRect &outerBounds, Jigsaw::TypeO
 //        Minimum Forced Paths: 4 Recommended size percentage: 0.35
 }
 
+QRect PuzzlePath::innerBoundsFromPercentage(const QRect &outerBounds, double sizePercentage)
+{
+    double width = sizePercentage * outerBounds.width();
+    double height = sizePercentage * outerBounds.height();
+    if (width > height) width = height;
+    if (height > width) height = width;
+
+    QPoint innerBoundsTopLeft = outerBounds.topLeft() + QPoint((outerBounds.width() - round(width)) / 2, (outerBounds.height() - round(height)) / 2);
+    QSize innerBoundsSize(width, height);
+    QRect innerBounds(innerBoundsTopLeft, innerBoundsSize);
+    return innerBounds;
+}
+
 QVector<double> PuzzlePath::calculateRecommendedInnerBoundsPercentage(QVector<Jigsaw::TypeOfPiece> types, QSize size, int startPercentage, int startPaths, const CustomPuzzlePath &customPath)
 {
     bool liveDebug = false;
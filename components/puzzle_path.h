@@ -90,6 +90,7 @@ private:
 
     static bool pathHasCollisions(const PuzzlePath &jigsawPath, const QVector<PuzzlePath> &collisionPaths);
     static QRect recommendedInnerBounds(const QRect &outerBounds, Jigsaw::TypeOfPiece typeOfPiece, int minForcedPaths);
+    static QRect innerBoundsFromPercentage(const QRect &outerBounds, double sizePercentage);
 };
 
 #endif // PUZZLE_PATH_H
@@ -1,7 +1,13 @@
 #include "puzzle_piece.h"
+#include "core/board_input_dispatcher.h"
+#include "core/board_view.h"
+#include "core/render_stats.h"
+#include "tools/image_ops.h"
+#include <QtMath>
+#include <cmath>
 
 PuzzlePiece::PuzzlePiece(int id, QWidget* parent)
-    : PuzzleLabel{parent}
+    : PuzzleLabel{parent, false}
     , m_id(id)
     , m_selected(false)
     , m_draggedDistance(0)
@@ -12,15 +18,21 @@ PuzzlePiece::PuzzlePiece(int id, QWidget* parent)
     , m_rotated(false)
     , m_rotationEnabled(true)
     , m_dragEnabled(true)
-    , m_moveTimer(new QTimer(this))
+    , m_fragmentReleased(false)
+    , m_spriteOutdated(false)
+    , m_spriteScale(1.0)
+    , m_boardView(nullptr)
+    , m_inputDispatcher(nullptr)
     , m_timerStartTime(QDateTime::currentDateTime())
 {
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    countMemoryAsPiece();
+    updateHitMask();
     expandGeometryForRotation();
-    QObject::connect(m_moveTimer, &QTimer::timeout, this, &PuzzlePiece::moveTimerTimeOut);
 }
 
 PuzzlePiece::PuzzlePiece(int id, const QPixmap &background, QWidget *parent)
-    : PuzzleLabel{background, parent}
+    : PuzzleLabel{background, parent, QString(), QRect(), false}
     , m_id(id)
     , m_selected(false)
     , m_draggedDistance(0)
@@ -31,15 +43,21 @@ PuzzlePiece::PuzzlePiece(int id, const QPixmap &background, QWidget *parent)
     , m_rotated(false)
     , m_rotationEnabled(true)
     , m_dragEnabled(true)
-    , m_moveTimer(new QTimer(this))
+    , m_fragmentReleased(false)
+    , m_spriteOutdated(false)
+    , m_spriteScale(1.0)
+    , m_boardView(nullptr)
+    , m_inputDispatcher(nullptr)
     , m_timerStartTime(QDateTime::currentDateTime())
 {
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    countMemoryAsPiece();
+    updateHitMask();
     expandGeometryForRotation();
-    QObject::connect(m_moveTimer, &QTimer::timeout, this, &PuzzlePiece::moveTimerTimeOut);
 }
 
 PuzzlePiece::PuzzlePiece(int id, const QSize &size, const QBrush &background, const QPainterPath &jigsawPath, QWidget *parent)
-    : PuzzleLabel{size, background, jigsawPath, parent}
+    : PuzzleLabel{size, background, jigsawPath, parent, QString(), QRect(), false}
     , m_id(id)
     , m_selected(false)
     , m_draggedDistance(0)
@@ -50,11 +68,17 @@ PuzzlePiece::PuzzlePiece(int id, const QSize &size, const QBrush &background, co
     , m_rotated(false)
     , m_rotationEnabled(true)
     , m_dragEnabled(true)
-    , m_moveTimer(new QTimer(this))
+    , m_fragmentReleased(false)
+    , m_spriteOutdated(false)
+    , m_spriteScale(1.0)
+    , m_boardView(nullptr)
+    , m_inputDispatcher(nullptr)
     , m_timerStartTime(QDateTime::currentDateTime())
 {
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    countMemoryAsPiece();
+    updateHitMask();
     expandGeometryForRotation();
-    QObject::connect(m_moveTimer, &QTimer::timeout, this, &PuzzlePiece::moveTimerTimeOut);
 }
 
 PuzzlePiece::~PuzzlePiece()
@@ -64,31 +88,41 @@ PuzzlePiece::~PuzzlePiece()
 
 void PuzzlePiece::setPixmap(const QPixmap &newPixmap)
 {
+    m_fragmentReleased = false;
     PuzzleLabel::setPixmap(newPixmap);
+    updateHitMask();
     redraw();
 }
 
 void PuzzlePiece::setJigsawPath(const QPainterPath &newJigsawPath, const QSize &newSize, const QBrush &newBrush)
 {
+    m_fragmentReleased = false;
     PuzzleLabel::setJigsawPath(newJigsawPath, newSize, newBrush);
+    updateHitMask();
     redraw();
 }
 
 void PuzzlePiece::setJigsawPath(const QPainterPath &newJigsawPath, const QSize &newSize)
 {
+    restoreFragment();
     PuzzleLabel::setJigsawPath(newJigsawPath, newSize);
+    updateHitMask();
     redraw();
 }
 
 void PuzzlePiece::setJigsawPath(const QPainterPath &newJigsawPath)
 {
+    restoreFragment();
     PuzzleLabel::setJigsawPath(newJigsawPath);
+    updateHitMask();
     redraw();
 }
 
 void PuzzlePiece::setBorderPen(const QPen &newBorderPen)
 {
+    restoreFragment();
     PuzzleLabel::setBorderPen(newBorderPen);
+    updateHitMask();
     redraw();
 }
 
@@ -97,7 +131,7 @@ void PuzzlePiece::setAngle(int newAngle)
     if (newAngle == m_angle) return;
     m_angle = newAngle;
     redraw();
-    emit rotated(m_id, m_angle, mapToParent(m_maxRectForRotation.center() - m_maxRectForRotation.topLeft()));
+    if (m_inputDispatcher) m_inputDispatcher->pieceRotated(m_id, m_angle, center());
 }
 
 
@@ -108,7 +142,7 @@ void PuzzlePiece::rotateAroundPoint(int angle, const QPointF &point, double cons
         int angleDif = m_angle - angle;
         m_angle = angle;
         redraw();
-        QLineF line(point, mapToParent(m_maxRectForRotation.center() - m_maxRectForRotation.topLeft()));
+        QLineF line(point, center());
         line.setAngle(line.angle() - angleDif);
         if (constDistance > 0.0) line.setLength(constDistance);
         QPointF newPosition = line.p2();
@@ -138,15 +172,15 @@ int PuzzlePiece::angle() const
 void PuzzlePiece::move(const QPointF &pos)
 {
     m_actualPosition = pos + m_maxRectForRotation.topLeft();
-    QLabel::move(m_actualPosition.toPoint());
     m_originalPosition = pos;
+    placeWidget();
 }
 
 void PuzzlePiece::move(double x, double y)
 {
     m_actualPosition = QPointF(x, y) + m_maxRectForRotation.topLeft();
-    QLabel::move(m_actualPosition.toPoint());
     m_originalPosition = QPoint(x, y);
+    placeWidget();
 }
 
 bool PuzzlePiece::rotationIsEnabled() const
@@ -176,13 +210,83 @@ int PuzzlePiece::id() const
 
 QPointF PuzzlePiece::center() const
 {
-    return mapToParent(m_maxRectForRotation.center() - m_maxRectForRotation.topLeft());
+    return m_originalPosition + m_maxRectForRotation.center();
+}
+
+QRectF PuzzlePiece::spriteRect() const
+{
+    return QRectF(m_actualPosition, m_maxRectForRotation.size());
+}
+
+/*
+ * Sets the levels the piece is drawn from when it is zoomed out. levels is an ImagePyramid of the whole puzzle image of
+ * the given size, scaled to half its size, and fragmentPosition is the top left corner of the fragment in the image.
+ * Without levels a zoomed out piece is drawn from its full fragment.
+ */
+
+void PuzzlePiece::setFragmentLevels(ImagePyramidPointer levels, const QSize &imageSize, const QPoint &fragmentPosition)
+{
+    m_fragmentLevels = std::move(levels);
+    m_fragmentImageSize = imageSize;
+    m_fragmentPosition = fragmentPosition;
+    if (textureLevel(viewScale()) > 0) redraw();
+}
+
+bool PuzzlePiece::releaseFragment()
+{
+    // 精灵图过期或者缩放过时不能从中恢复碎片
+    if (m_fragmentReleased || m_spriteOutdated || m_spriteScale != 1.0 || m_mode != PuzzleLabel::Mode::BRUSH || m_rotationEnabled || m_angle != 0) return false;
+    if (m_brush.texture().isNull()) return false;
+
+    m_brush = QBrush();
+    m_fragmentReleased = true;
+    updateMemoryUsage();
+    return true;
+}
+
+bool PuzzlePiece::hitTest(const QPoint &pos) const
+{
+    // 用像素中心反向旋转，得到未旋转碎片上的像素
+    QPointF point = m_hitTransform.map(QPointF(pos) + QPointF(0.5, 0.5));
+    return m_hitMask.contains(qFloor(point.x()), qFloor(point.y()));
+}
+
+void PuzzlePiece::updateHitMask()
+{
+    QImage image;
+    switch (m_mode) {
+    case PuzzleLabel::Mode::PIXMAP:
+        image = ImageOps::toImage(PuzzleLabel::pixmap());
+        break;
+    case PuzzleLabel::Mode::BRUSH: {
+        // 只需要形状，用纯色画刷绘制即可
+        image = QImage(m_originalSize.toSize(), ImageOps::FORMAT);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setPen(borderPen());
+        painter.setBrush(Qt::black);
+        painter.drawPath(jigsawPath());
+        break;
+    }
+    }
+    m_hitMask = HitMask(image);
+    m_hitMaskMemory.set(m_hitMask.bytes());
+}
+
+void PuzzlePiece::restoreFragment()
+{
+    if (!m_fragmentReleased) return;
+
+    // 没有旋转时，碎片就是图片中没有扩大的部分
+    QRect fragmentRect(-m_maxRectForRotation.topLeft().toPoint(), m_originalSize.toSize());
+    m_brush = QBrush(QLabel::pixmap().copy(fragmentRect));
+    m_fragmentReleased = false;
 }
 
 void PuzzlePiece::expandGeometryForRotation()
 {
-    int oldWidth = pixmap().size().width();
-    int oldHeight = pixmap().size().height();
+    int oldWidth = m_originalSize.toSize().width();
+    int oldHeight = m_originalSize.toSize().height();
     double radius = qSqrt(qPow(1.0 * oldHeight / 2, 2) + qPow(1.0 * oldWidth / 2, 2));
     double newWidth = 2.0 * radius;
     double newHeight = newWidth;
@@ -190,46 +294,138 @@ void PuzzlePiece::expandGeometryForRotation()
     double offsetHeight = (newHeight - oldHeight) / 2;
     m_maxRectForRotation = QRectF(QPointF(-offsetWidth, -offsetHeight), QSizeF(newWidth, newHeight));
     m_actualPosition = m_originalPosition + m_maxRectForRotation.topLeft();
-    setGeometry(m_maxRectForRotation.translated(m_originalPosition).toRect());
+    placeWidget();
     redraw();
 }
 
-void PuzzlePiece::moveTimerTimeOut()
+/*
+ * Resets a retired piece to the state of a piece created with the same arguments. The piece is drawn only once, into
+ * the sprite it already has if the size matches. Rotation and dragging are enabled again and the piece has no
+ * dispatcher, it stays hidden until show() is called.
+ */
+
+void PuzzlePiece::recycle(int id, const QSize &size, const QBrush &background, const QPainterPath &jigsawPath)
+{
+    m_id = id;
+    m_selected = false;
+    m_draggedDistance = 0;
+    m_dragged = false;
+    m_cursorOffset = QPointF(0.0, 0.0);
+    m_angle = 0;
+    m_startingAngle = 0;
+    m_rotated = false;
+    m_rotationEnabled = true;
+    m_dragEnabled = true;
+    m_fragmentReleased = false;
+    m_inputDispatcher = nullptr;
+    m_timerStartTime = QDateTime::currentDateTime();
+    m_originalPosition = QPointF(0.0, 0.0);
+    m_fragmentLevels.reset();
+
+    assignJigsawPath(jigsawPath, size, background);
+    updateHitMask();
+    expandGeometryForRotation();
+}
+
+void PuzzlePiece::retire()
+{
+    // 控件和精灵图留给下一局，碎片图片、路径和点击遮罩马上释放
+    hide();
+    m_selected = false;
+    m_dragged = false;
+    m_rotated = false;
+    m_inputDispatcher = nullptr;
+    m_fragmentReleased = false;
+    assignJigsawPath(QPainterPath(), m_originalSize.toSize(), QBrush());
+    m_fragmentLevels.reset();
+    m_hitMask = HitMask();
+    m_hitMaskMemory.set(0);
+    updateMemoryUsage();
+}
+
+/*
+ * Returns the drawn and rotated pixmap of the piece. A hidden piece isn't redrawn when it is moved or rotated, so its
+ * sprite is drawn here if it is outdated.
+ */
+
+const QPixmap &PuzzlePiece::currentSprite()
+{
+    if (m_spriteOutdated) drawSprite();
+    return m_sprite;
+}
+
+void PuzzlePiece::setBoardView(const BoardView *boardView)
+{
+    m_boardView = boardView;
+    updateView();
+}
+
+/*
+ * Places the widget after the BoardView changed. The sprite is only drawn again if the zoom changed, and not before
+ * the piece is shown if it is hidden.
+ */
+
+void PuzzlePiece::updateView()
+{
+    placeWidget();
+    m_hitTransform = spriteTransform(viewScale()).inverted();
+    if (viewScale() != m_spriteScale) redraw();
+}
+
+void PuzzlePiece::setInputDispatcher(BoardInputDispatcher *inputDispatcher)
+{
+    m_inputDispatcher = inputDispatcher;
+}
+
+/*
+ * Called by the BoardInputDispatcher while the piece is selected. Moves the piece with the cursor and returns false
+ * once the piece isn't selected anymore, because it was dropped after DROPPEDAFTERMSECS.
+ */
+
+bool PuzzlePiece::followCursor()
 {
-    QPointF newPosition = QCursor::pos() + m_cursorOffset;
+    if (!m_selected) return false;
+
+    QPointF newPosition = cursorPosition(QCursor::pos()) + m_cursorOffset;
     QPointF draggedBy = newPosition - m_originalPosition;
-    if (draggedBy.isNull()) return;
-    move(newPosition);
-    emit dragged(m_id, draggedBy);
+    if (!draggedBy.isNull()) {
+        move(newPosition);
+        if (m_inputDispatcher) m_inputDispatcher->pieceDragged(m_id, draggedBy);
+    }
+
+    // 光标不动时也要按时放下
     if (m_timerStartTime.msecsTo(QDateTime::currentDateTime()) >= DROPPEDAFTERMSECS) {
-        m_moveTimer->stop();
         m_selected = false;
         m_dragged = false;
-        emit dragStopped(m_id);
+        if (m_inputDispatcher) m_inputDispatcher->pieceDragStopped(m_id);
+        return false;
     }
+    return true;
 }
 
 void PuzzlePiece::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton && m_dragEnabled && !m_rotated) {
-        m_cursorOffset = m_originalPosition - mapToGlobal(event->pos());
+        m_cursorOffset = m_originalPosition - cursorPosition(event->globalPosition());
         m_selected = !m_selected;
         if (m_selected) {
-            m_moveTimer->start(1000 / FPS);
             m_timerStartTime = QDateTime::currentDateTime();
-            emit dragStarted(m_id);
+            if (m_inputDispatcher) {
+                m_inputDispatcher->startFollowingCursor(this);
+                m_inputDispatcher->pieceDragStarted(m_id);
+            }
         }
-        else {
-            m_moveTimer->stop();
-            emit dragStopped(m_id);
+        else if (m_inputDispatcher) {
+            m_inputDispatcher->stopFollowingCursor(this);
+            m_inputDispatcher->pieceDragStopped(m_id);
         }
         emit leftClicked(m_id);
         return;
     }
     else if (event->button() == Qt::RightButton && !m_selected) {
-        m_startingAngle = QLineF(m_maxRectForRotation.center(), event->pos() + m_maxRectForRotation.topLeft()).angle() - m_angle;
+        m_startingAngle = QLineF(QRectF(rect()).center(), event->position()).angle() - m_angle;
         m_rotated = true;
-        emit rotateStarted(m_id);
+        if (m_inputDispatcher) m_inputDispatcher->pieceRotateStarted(m_id);
         emit rightClicked(m_id);
     }
     emit clicked(m_id);
@@ -245,12 +441,14 @@ void PuzzlePiece::mouseReleaseEvent(QMouseEvent *event)
 {
     if (m_selected && m_dragged && m_draggedDistance >= MINDRAGDISTANCE) {
         m_selected = false;
-        m_moveTimer->stop();
-        emit dragStopped(m_id);
+        if (m_inputDispatcher) {
+            m_inputDispatcher->stopFollowingCursor(this);
+            m_inputDispatcher->pieceDragStopped(m_id);
+        }
     }
     m_draggedDistance = 0;
     m_dragged = false;
-    if (m_rotated) emit rotateStopped(m_id);
+    if (m_rotated && m_inputDispatcher) m_inputDispatcher->pieceRotateStopped(m_id);
     m_rotated = false;
     emit released(m_id);
 }
@@ -269,7 +467,7 @@ void PuzzlePiece::mouseMoveEvent(QMouseEvent *event)
         ++m_draggedDistance;
     }
     else if (event->buttons() == Qt::RightButton && m_rotationEnabled && !m_selected) {
-        int angle = QLineF(m_maxRectForRotation.center(), event->pos() + m_maxRectForRotation.topLeft()).angle();
+        int angle = QLineF(QRectF(rect()).center(), event->position()).angle();
         angle -= m_startingAngle;
         angle %= 360;
         if (angle < 0) angle += 360;
@@ -287,36 +485,143 @@ void PuzzlePiece::leaveEvent(QEvent *event)
     emit left(m_id);
 }
 
+void PuzzlePiece::showEvent(QShowEvent *event)
+{
+    if (m_spriteOutdated) drawSprite();
+    PuzzleLabel::showEvent(event);
+}
+
 void PuzzlePiece::redraw()
 {
-    QPixmap rotatedPixmap(m_maxRectForRotation.toRect().size());
-    rotatedPixmap.fill(Qt::transparent);
+    restoreFragment();
+    m_hitTransform = spriteTransform(viewScale()).inverted();
 
-    QTransform transform;
-    transform.translate(m_maxRectForRotation.width() / 2, m_maxRectForRotation.height() / 2);
-    transform.rotate(-m_angle);
-    transform.translate(m_maxRectForRotation.width() / -2, m_maxRectForRotation.height() / -2);
-    transform.translate(-m_maxRectForRotation.left(), -m_maxRectForRotation.top());
+    // 隐藏的碎片（合并组已拼成一张图，在碎片池中，或者在视口外）等到显示或者需要精灵图时再绘制
+    if (isHidden()) {
+        m_spriteOutdated = true;
+        return;
+    }
+    drawSprite();
+}
 
-    QPainter painter(&rotatedPixmap);
-    QBrush brush = m_brush;
-    QPainterPath path = jigsawPath();
+void PuzzlePiece::drawSprite()
+{
+    double scale = viewScale();
+    QSize spriteSize = scaledSpriteSize(scale);
+    if (m_sprite.size() == spriteSize) {
+        // QLabel 先放开它的副本，绘制时就不会把整个精灵图复制一遍
+        QLabel::clear();
+    }
+    else {
+        m_sprite = QPixmap(spriteSize);
+    }
+    m_sprite.fill(Qt::transparent);
+    m_spriteOutdated = false;
+    m_spriteScale = scale;
+
+    QPainter painter(&m_sprite);
+    paintPiece(painter, scale);
+    painter.end();
+
+    QLabel::setPixmap(m_sprite);
+
+    RenderStats::countRedraw();
+    updateMemoryUsage();
+}
+
+/*
+ * Draws the rotated piece at the given scale into a new image, the top left corner of the image is the top left
+ * corner of spriteRect(). Used to draw the piece into a MergedPieceSprite at its own scale.
+ */
+
+QImage PuzzlePiece::renderSprite(double scale)
+{
+    restoreFragment();
+    QImage image(scaledSpriteSize(scale), ImageOps::FORMAT);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    paintPiece(painter, scale);
+    painter.end();
+
+    RenderStats::countRedraw();
+    return image;
+}
+
+void PuzzlePiece::paintPiece(QPainter &painter, double scale)
+{
+    painter.setTransform(spriteTransform(scale));
 
     switch (m_mode) {
     case PuzzleLabel::Mode::PIXMAP:
-        painter.setTransform(transform);
         painter.drawPixmap(PuzzleLabel::pixmap().rect(), PuzzleLabel::pixmap(), PuzzleLabel::pixmap().rect());
         break;
     case PuzzleLabel::Mode::BRUSH:
-        painter.setTransform(transform);
         painter.setPen(borderPen());
-        painter.setBrush(brush);
-        painter.drawPath(path);
+        painter.setBrush(levelBrush(scale));
+        painter.drawPath(jigsawPath());
         break;
-    default:
-        return;
     }
+}
+
+int PuzzlePiece::textureLevel(double scale)
+{
+    return scale >= 1.0 ? 0 : qFloor(-std::log2(scale) + 1e-6);
+}
+
+/*
+ * Returns the brush to draw the piece at the given scale. If the piece is drawn at half its size or smaller, the brush
+ * is a lower level of the fragment levels, scaled back up and moved, so the fragment lies where it is in the puzzle
+ * image. The level is shared by all pieces and used as it is, in ImageOps::FORMAT.
+ */
+
+QBrush PuzzlePiece::levelBrush(double scale) const
+{
+    int level = textureLevel(scale);
+    if (level == 0 || !m_fragmentLevels || m_fragmentLevels->isNull()) return m_brush;
+
+    // 第 0 层已经是一半大小
+    const QImage &image = m_fragmentLevels->level(qMin(level, m_fragmentLevels->levels()) - 1);
+    QBrush brush(image);
+    brush.setTransform(QTransform::fromScale(double(m_fragmentImageSize.width()) / image.width(),
+                                             double(m_fragmentImageSize.height()) / image.height())
+                       * QTransform::fromTranslate(-m_fragmentPosition.x(), -m_fragmentPosition.y()));
+    return brush;
+}
+
+QTransform PuzzlePiece::spriteTransform(double scale) const
+{
+    QTransform transform;
+    transform.scale(scale, scale);
+    transform.translate(m_maxRectForRotation.width() / 2, m_maxRectForRotation.height() / 2);
+    transform.rotate(-m_angle);
+    transform.translate(m_maxRectForRotation.width() / -2, m_maxRectForRotation.height() / -2);
+    transform.translate(-m_maxRectForRotation.left(), -m_maxRectForRotation.top());
+    return transform;
+}
+
+QSize PuzzlePiece::scaledSpriteSize(double scale) const
+{
+    return QSize(qCeil(m_maxRectForRotation.width() * scale), qCeil(m_maxRectForRotation.height() * scale));
+}
+
+double PuzzlePiece::viewScale() const
+{
+    return m_boardView ? m_boardView->zoom() : 1.0;
+}
+
+void PuzzlePiece::placeWidget()
+{
+    QPointF topLeft = m_boardView ? m_boardView->mapToScreen(m_actualPosition) : m_actualPosition;
+    setGeometry(QRect(topLeft.toPoint(), scaledSpriteSize(viewScale())));
+}
 
-    QLabel::setPixmap(rotatedPixmap);
-    setMask(rotatedPixmap.mask());
+/*
+ * Returns the position on the board under the cursor at globalPosition.
+ */
+
+QPointF PuzzlePiece::cursorPosition(const QPointF &globalPosition) const
+{
+    QPointF position = parentWidget() ? parentWidget()->mapFromGlobal(globalPosition) : globalPosition;
+    return m_boardView ? m_boardView->mapFromScreen(position) : position;
 }
@@ -2,9 +2,13 @@
 #define PUZZLE_PIECE_H
 
 #include "ui/puzzle_label.h"
+#include "tools/hit_mask.h"
+#include "tools/image_pyramid.h"
 #include <QDateTime>
 #include <QMouseEvent>
-#include <QTimer>
+
+class BoardInputDispatcher;
+class BoardView;
 
 /*
  * The JigsawPiece class inherits JigsawLabel. You can drag and rotate a JigsawPiece by clicking on it. For the rotation
@@ -19,18 +23,37 @@
  * then moved along with the cursor. If you click it again, it is unselected and dropped. In rare cases it is possible a
  * JigsawPiece isn't dropped if you click it again, because the cursor is not inside its borders anymore. Therefore a
  * JigsawPiece is always dropped after a certain time (10 secs by default).
- * 
- * There are two important signals in this class:
- *
- * dragged(int id, const QPointF &draggedBy)
- * This signal is emitted every time the JigsawPiece is dragged by one of the two ways to drag a JigsawPiece described above.
- * It can be used to move other JigsawPieces which are already merged in a jigsaw puzzle game.
  *
- * rotated(int id, int angle, const QPointF &rotatingPoint)
- * This signal is emitted every time the JigsawPiece is rotated. It should be used to rotate merged pieces with the
- * rotateAroundPoint function.
+ * A board has thousands of pieces, so a piece has neither its own timer nor signals for dragging and rotating. It
+ * reports them by its ID to the BoardInputDispatcher set with setInputDispatcher(), which also moves the selected
+ * pieces with the cursor by calling followCursor(). A piece without a dispatcher can be rotated, but doesn't follow the
+ * cursor when it is selected.
  *
  * It is not allowed to draw text onto a JigsawPiece, so some of the functions implemented in JigsawLabel are deleted.
+ *
+ * A JigsawPiece has no widget mask and is transparent for mouse events, because a mask would have to be rebuilt as a
+ * QRegion on every rotation. Instead the board picks the piece under the cursor with hitTest() and forwards the mouse
+ * events to it. hitTest() maps the point back onto the unrotated piece and looks it up in a HitMask, which is only
+ * rebuilt if the shape of the piece changes. Since the piece doesn't get enter and leave events anymore, entered() and
+ * left() are only emitted if the owner sends these events.
+ *
+ * If memory is low, releaseFragment() drops the fragment of the image a piece that can't be rotated is drawn from. As
+ * long as the piece isn't rotated, the fragment is just the visible part of its pixmap, so it is copied back from the
+ * pixmap before the piece is redrawn. The edges lose a little bit of their antialiasing with every restore.
+ *
+ * The rotated pixmap is drawn into the same sprite as long as its size doesn't change. A hidden piece, e.g. one of a
+ * merged group that is shown by a MergedPieceSprite, only marks its sprite as outdated when it is moved or rotated.
+ * The sprite is drawn when the piece is shown again or currentSprite() is called. retire() hides a piece that is
+ * no longer needed and drops its fragment, path and hit mask, but keeps the widget and the sprite. recycle() turns a
+ * retired piece into a new one, like the constructor does. Both are used by the PiecePool.
+ *
+ * The position, center() and spriteRect() of a piece are board coordinates. If a BoardView is set with setBoardView(),
+ * the widget is placed and scaled by it, and updateView() has to be called when the view changes. Without a view the
+ * board and the widget coordinates are the same.
+ *
+ * A zoomed out piece is drawn from the fragment levels set with setFragmentLevels(), an ImagePyramid of the whole
+ * puzzle image built once by the PuzzleSetupWorker. The brush uses the level as it is and only moves it to the position
+ * of the fragment, so neither the full fragment is filtered nor anything is read back, copied or converted per piece.
  */
 
 class PuzzlePiece : public PuzzleLabel
@@ -39,7 +62,6 @@ class PuzzlePiece : public PuzzleLabel
 private:
     static constexpr unsigned int MINDRAGDISTANCE = 5;
     static constexpr unsigned int MINROTATEANGLE = 10;
-    static constexpr unsigned int FPS = 60;
     static constexpr unsigned int DROPPEDAFTERMSECS = 10000;
 
     int m_id;
@@ -52,17 +74,39 @@ private:
     bool m_rotated;
     bool m_rotationEnabled;
     bool m_dragEnabled;
+    bool m_fragmentReleased;
+    bool m_spriteOutdated;
+    double m_spriteScale;
 
     QRectF m_maxRectForRotation;
+    QPixmap m_sprite;
     void expandGeometryForRotation();
+    void drawSprite();
+    void paintPiece(QPainter &painter, double scale);
+    QTransform spriteTransform(double scale) const;
+    QSize scaledSpriteSize(double scale) const;
+
+    ImagePyramidPointer m_fragmentLevels;
+    QSize m_fragmentImageSize;
+    QPoint m_fragmentPosition;
+    static int textureLevel(double scale);
+    QBrush levelBrush(double scale) const;
+
+    const BoardView* m_boardView;
+    double viewScale() const;
+    void placeWidget();
+    QPointF cursorPosition(const QPointF &globalPosition) const;
+
+    HitMask m_hitMask;
+    QTransform m_hitTransform;
+    MemoryUsage m_hitMaskMemory{MemoryBudget::Category::MASKS};
+    void updateHitMask();
+    void restoreFragment();
 
     QPointF m_actualPosition;
-    QTimer* m_moveTimer;
+    BoardInputDispatcher* m_inputDispatcher;
     QDateTime m_timerStartTime;
 
-private slots:
-    void moveTimerTimeOut();
-
     // QWidget interface
 protected:
     virtual void mousePressEvent(QMouseEvent *event) override;
@@ -70,6 +114,7 @@ protected:
     virtual void mouseMoveEvent(QMouseEvent *event) override;
     virtual void enterEvent(QEnterEvent *event) override;
     virtual void leaveEvent(QEvent *event) override;
+    virtual void showEvent(QShowEvent *event) override;
 
     void redraw();
 
@@ -105,6 +150,22 @@ public:
 
     int id() const;
     QPointF center() const;
+    QRectF spriteRect() const;
+
+    void setBoardView(const BoardView* boardView);
+    void updateView();
+    QImage renderSprite(double scale);
+
+    void setInputDispatcher(BoardInputDispatcher* inputDispatcher);
+    bool followCursor();
+
+    void setFragmentLevels(ImagePyramidPointer levels, const QSize &imageSize, const QPoint &fragmentPosition);
+    bool releaseFragment();
+    bool hitTest(const QPoint &pos) const;
+    const QPixmap &currentSprite();
+
+    void recycle(int id, const QSize &size, const QBrush &background, const QPainterPath &jigsawPath);
+    void retire();
 
 public slots:
     void setRotationEnabled(bool val = true);
@@ -117,12 +178,6 @@ signals:
     void rightClicked(int id);
     void leftClicked(int id);
     void released(int id);
-    void dragged(int id, const QPointF &draggedBy);
-    void dragStarted(int id);
-    void dragStopped(int id);
-    void rotated(int id, int angle, const QPointF &rotatingPoint);
-    void rotateStarted(int id);
-    void rotateStopped(int id);
     void entered(int id);
     void left(int id);
     void requestPositionValidation(int id);
@@ -0,0 +1,62 @@
+#include "board_input_dispatcher.h"
+#include "components/puzzle_piece.h"
+
+BoardInputDispatcher::BoardInputDispatcher(QObject *parent)
+    : QObject{parent}
+    , m_moveTimer(new QTimer(this))
+{
+    m_moveTimer->setInterval(1000 / FPS);
+    QObject::connect(m_moveTimer, &QTimer::timeout, this, &BoardInputDispatcher::moveTimerTimeOut);
+}
+
+void BoardInputDispatcher::startFollowingCursor(PuzzlePiece *piece)
+{
+    if (!m_followingPieces.contains(piece)) m_followingPieces.push_back(piece);
+    if (!m_moveTimer->isActive()) m_moveTimer->start();
+}
+
+void BoardInputDispatcher::stopFollowingCursor(PuzzlePiece *piece)
+{
+    m_followingPieces.removeAll(piece);
+    if (m_followingPieces.isEmpty()) m_moveTimer->stop();
+}
+
+void BoardInputDispatcher::pieceDragStarted(int id)
+{
+    emit dragStarted(id);
+}
+
+void BoardInputDispatcher::pieceDragged(int id, const QPointF &draggedBy)
+{
+    emit dragged(id, draggedBy);
+}
+
+void BoardInputDispatcher::pieceDragStopped(int id)
+{
+    emit dragStopped(id);
+}
+
+void BoardInputDispatcher::pieceRotateStarted(int id)
+{
+    emit rotateStarted(id);
+}
+
+void BoardInputDispatcher::pieceRotated(int id, int angle, const QPointF &rotatingPoint)
+{
+    emit rotated(id, angle, rotatingPoint);
+}
+
+void BoardInputDispatcher::pieceRotateStopped(int id)
+{
+    emit rotateStopped(id);
+}
+
+void BoardInputDispatcher::moveTimerTimeOut()
+{
+    // 槽函数可能会选中或放下碎片，所以遍历一份副本
+    const QVector<QPointer<PuzzlePiece>> pieces = m_followingPieces;
+    for (const auto &piece : pieces) {
+        if (!piece || !piece->followCursor()) m_followingPieces.removeAll(piece);
+    }
+    if (m_followingPieces.isEmpty()) m_moveTimer->stop();
+}
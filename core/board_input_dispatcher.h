@@ -0,0 +1,63 @@
+#ifndef BOARD_INPUT_DISPATCHER_H
+#define BOARD_INPUT_DISPATCHER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QPointF>
+#include <QVector>
+
+class PuzzlePiece;
+
+/*
+ * The BoardInputDispatcher collects the drags and rotations of all PuzzlePieces on a board. A piece reports them by its
+ * ID to the dispatcher it was given with PuzzlePiece::setInputDispatcher(), and the board connects once to the signals
+ * of the dispatcher instead of connecting to every single piece.
+ *
+ * dragged(int id, const QPointF &draggedBy)
+ * Emitted every time a piece is dragged. It can be used to move other pieces which are already merged with it.
+ *
+ * rotated(int id, int angle, const QPointF &rotatingPoint)
+ * Emitted every time a piece is rotated. It should be used to rotate merged pieces with PuzzlePiece::rotateAroundPoint().
+ *
+ * A selected piece follows the cursor. All selected pieces are moved by one timer that runs FPS times a second and only
+ * while at least one piece is selected. A piece that is deleted while it is selected is removed the next time the timer
+ * fires.
+ */
+
+class BoardInputDispatcher : public QObject
+{
+    Q_OBJECT
+
+    static constexpr int FPS = 60;
+
+public:
+    explicit BoardInputDispatcher(QObject *parent = nullptr);
+
+    void startFollowingCursor(PuzzlePiece* piece);
+    void stopFollowingCursor(PuzzlePiece* piece);
+
+    void pieceDragStarted(int id);
+    void pieceDragged(int id, const QPointF &draggedBy);
+    void pieceDragStopped(int id);
+    void pieceRotateStarted(int id);
+    void pieceRotated(int id, int angle, const QPointF &rotatingPoint);
+    void pieceRotateStopped(int id);
+
+signals:
+    void dragStarted(int id);
+    void dragged(int id, const QPointF &draggedBy);
+    void dragStopped(int id);
+    void rotateStarted(int id);
+    void rotated(int id, int angle, const QPointF &rotatingPoint);
+    void rotateStopped(int id);
+
+private:
+    QTimer* m_moveTimer;
+    QVector<QPointer<PuzzlePiece>> m_followingPieces;
+
+private slots:
+    void moveTimerTimeOut();
+};
+
+#endif // BOARD_INPUT_DISPATCHER_H
@@ -0,0 +1,107 @@
+#include "board_view.h"
+#include <QtMath>
+#include <cmath>
+
+BoardView::BoardView(QObject *parent)
+    : QObject{parent}
+    , m_zoom(1.0)
+    , m_pan(0.0, 0.0)
+{
+
+}
+
+double BoardView::zoom() const
+{
+    return m_zoom;
+}
+
+QPointF BoardView::pan() const
+{
+    return m_pan;
+}
+
+int BoardView::level() const
+{
+    // 只有缩小到一半或更小时才换到更低的级别
+    if (m_zoom >= 1.0) return 0;
+    return qFloor(-std::log2(m_zoom) + 1e-6);
+}
+
+double BoardView::levelScale() const
+{
+    return std::exp2(qCeil(std::log2(m_zoom) - 1e-6));
+}
+
+QPointF BoardView::mapToScreen(const QPointF &point) const
+{
+    return point * m_zoom + m_pan;
+}
+
+QPointF BoardView::mapFromScreen(const QPointF &point) const
+{
+    return (point - m_pan) / m_zoom;
+}
+
+QRectF BoardView::mapToScreen(const QRectF &rect) const
+{
+    return QRectF(mapToScreen(rect.topLeft()), rect.size() * m_zoom);
+}
+
+QRectF BoardView::mapFromScreen(const QRectF &rect) const
+{
+    return QRectF(mapFromScreen(rect.topLeft()), rect.size() / m_zoom);
+}
+
+QTransform BoardView::transform() const
+{
+    return QTransform(m_zoom, 0.0, 0.0, m_zoom, m_pan.x(), m_pan.y());
+}
+
+/*
+ * Multiplies the zoom by factor, within MINZOOM and MAXZOOM. The point of the board under screenPoint stays where it
+ * is, like zooming at the cursor in an image viewer.
+ */
+
+void BoardView::zoomAt(const QPointF &screenPoint, double factor)
+{
+    double newZoom = qBound(MINZOOM, m_zoom * factor, MAXZOOM);
+    if (qFuzzyCompare(newZoom, m_zoom)) return;
+
+    QPointF boardPoint = mapFromScreen(screenPoint);
+    m_zoom = newZoom;
+    m_pan = screenPoint - boardPoint * m_zoom;
+    emit changed(true);
+}
+
+void BoardView::panBy(const QPointF &screenDistance)
+{
+    if (screenDistance.isNull()) return;
+    m_pan += screenDistance;
+    emit changed(false);
+}
+
+/*
+ * Shows rect (on the board) centered in viewport (on the screen). The board is only zoomed out, never in, so a rect
+ * that already fits is shown at its original size.
+ */
+
+void BoardView::fit(const QRectF &rect, const QRectF &viewport)
+{
+    if (rect.isEmpty() || viewport.isEmpty()) return;
+
+    double newZoom = qMin(1.0, qMin(viewport.width() / rect.width(), viewport.height() / rect.height()));
+    newZoom = qMax(MINZOOM, newZoom);
+    bool zoomChanged = !qFuzzyCompare(newZoom, m_zoom);
+
+    m_zoom = newZoom;
+    m_pan = viewport.center() - rect.center() * m_zoom;
+    emit changed(zoomChanged);
+}
+
+void BoardView::reset()
+{
+    bool zoomChanged = !qFuzzyCompare(m_zoom, 1.0);
+    m_zoom = 1.0;
+    m_pan = QPointF(0.0, 0.0);
+    emit changed(zoomChanged);
+}
@@ -0,0 +1,57 @@
+#ifndef BOARD_VIEW_H
+#define BOARD_VIEW_H
+
+#include <QObject>
+#include <QPointF>
+#include <QRectF>
+#include <QTransform>
+
+/*
+ * The BoardView maps the board, on which the pieces are positioned, onto the PuzzleGame widget. A point of the board
+ * is shown at point * zoom() + pan(). Positions, angles and the snapping of pieces don't depend on the view, only the
+ * widgets of the pieces are placed and drawn with it.
+ *
+ * level() is the sprite level for the current zoom: at level n the pieces are drawn from their fragment scaled down
+ * by 2^n, so zooming out doesn't filter the full resolution fragment for every sprite. levelScale() is the scale
+ * MergedPieceSprites are drawn at, the smallest power of two that is at least zoom(). They are painted scaled by at
+ * most a factor of two, so a group only has to be drawn again when the zoom crosses a power of two.
+ *
+ * changed() is emitted after every change, zoomChanged is false if the board was only panned.
+ */
+
+class BoardView : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr double MINZOOM = 0.125;
+    static constexpr double MAXZOOM = 2.0;
+    static constexpr double ZOOMSTEP = 1.25;
+
+    explicit BoardView(QObject *parent = nullptr);
+
+    double zoom() const;
+    QPointF pan() const;
+    int level() const;
+    double levelScale() const;
+
+    QPointF mapToScreen(const QPointF &point) const;
+    QPointF mapFromScreen(const QPointF &point) const;
+    QRectF mapToScreen(const QRectF &rect) const;
+    QRectF mapFromScreen(const QRectF &rect) const;
+    QTransform transform() const;
+
+    void zoomAt(const QPointF &screenPoint, double factor);
+    void panBy(const QPointF &screenDistance);
+    void fit(const QRectF &rect, const QRectF &viewport);
+    void reset();
+
+signals:
+    void changed(bool zoomChanged);
+
+private:
+    double m_zoom;
+    QPointF m_pan;
+};
+
+#endif // BOARD_VIEW_H
@@ -92,6 +92,29 @@ struct Parameters {
 
     int minNumberOfPieces = 1;
     int maxNumberOfPieces = 300;
+
+    /*
+     * Large puzzle mode (1,000 - 10,000 pieces). The image always covers at most 2/3 x 4/5 of the screen, so the pixel
+     * memory doesn't grow with the number of pieces, it only gets spread over more, smaller pieces. What grows is the
+     * overhead of every piece (widget, path, hit mask, bookkeeping) and the work done for every piece while the puzzle
+     * is set up. That's why large puzzles give up on solving path collisions early, don't allow rotation and create
+     * their pieces on the GUI thread for at most setupMSecsPerTick per event loop turn.
+     *
+     * The budget per number of pieces is LARGEPUZZLEBUDGETS below. It is checked by LargePuzzleBenchmark in tests/,
+     * which sets up each of these puzzles and fails if a value is over budget.
+     */
+    int minNumberOfPiecesLargePuzzle = 1000;
+    int maxNumberOfPiecesLargePuzzle = 10000;
+    int maxCollisionAttemptsLargePuzzle = 3;
+    int setupMSecsPerTick = 8;
+
+    // 内存预算（MB），0 表示不限制。可以用环境变量 JIGSAW_MEMORY_BUDGET_MB 覆盖
+    int memoryBudgetMB = 512;
+
+    // 底边栏：隐藏时仍露出的高度和完全滑入/滑出所需的时间
+    int menuPeekHeight = 20;
+    int menuSlideMSecs = 250;
+
     QSize sizeButtonOuterBounds = QSize(widthWidgetNumberOfPieces / 4, heightWidgetNumberOfPieces * 3 / 4);
     QSize sizeButtonInnerBounds = QSize(widthWidgetNumberOfPieces / 8, heightWidgetNumberOfPieces / 4);
 
@@ -108,8 +131,41 @@ struct Parameters {
     QFont mainFont = QFont("Georgia", 16, QFont::Bold);
 };
 
-// 全局随机数生成器，用于确保形状一致性
-extern std::mt19937 g_randomGenerator;
+/*
+ * The budget of a large puzzle at 1920x1080 with rotation disabled, from setting it up to painting the board:
+ *
+ * memoryMB               total of all MemoryBudget categories after the puzzle was set up
+ * setupMSecs             time the PuzzleSetupWorker needs for the grid, the edges and the fragments
+ * microsecondsPerPiece   time needed to create one PuzzlePiece on the GUI thread
+ * fitFrameMSecs          time to paint the whole board, zoomed out until all pieces are visible
+ * viewFrameMSecs         time to paint the board at zoom 1, where all pieces outside the window are hidden
+ *
+ *      pieces    memory    setup     per piece    zoomed out    zoom 1
+ *       1,000     64 MB     2 s        200 us       16 ms        16 ms
+ *       5,000     96 MB     8 s        200 us       50 ms        16 ms
+ *      10,000    128 MB    15 s        200 us      100 ms        16 ms
+ *
+ * Every piece is still a widget, so a frame of the zoomed out board grows with the number of pieces. Only once the
+ * board is zoomed in, culling keeps the frame time independent of the size of the puzzle.
+ */
+
+struct LargePuzzleBudget {
+    int numberOfPieces;
+    int memoryMB;
+    int setupMSecs;
+    int microsecondsPerPiece;
+    int fitFrameMSecs;
+    int viewFrameMSecs;
+};
+
+inline constexpr LargePuzzleBudget LARGEPUZZLEBUDGETS[] = {
+    { 1000, 64, 2000, 200, 16, 16 },
+    { 5000, 96, 8000, 200, 50, 16 },
+    { 10000, 128, 15000, 200, 100, 16 }
+};
+
+// 随机数生成器，用于确保形状一致性。每个线程各有一个生成器，后台生成拼图时不会干扰界面线程
+extern thread_local std::mt19937 g_randomGenerator;
 
 inline int randomNumber(int min, int max) {
     int range = (max - min) + 1;
@@ -117,7 +173,7 @@ inline int randomNumber(int min, int max) {
     return result;
 }
 
-// 设置随机数生成器的种子
+// 设置当前线程随机数生成器的种子
 inline void setRandomSeed(unsigned int seed) {
     g_randomGenerator.seed(seed);
 }
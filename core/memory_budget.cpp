@@ -0,0 +1,173 @@
+#include "memory_budget.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+std::atomic<qint64> MemoryBudget::s_bytes[NUMBEROFCATEGORIES] = {};
+std::atomic<qint64> MemoryBudget::s_peakBytes[NUMBEROFCATEGORIES] = {};
+std::atomic<qint64> MemoryBudget::s_totalBytes{0};
+std::atomic<qint64> MemoryBudget::s_budgetBytes{0};
+std::atomic<int> MemoryBudget::s_tier{static_cast<int>(Tier::FULL)};
+std::atomic_bool MemoryBudget::s_checkPending{false};
+std::atomic<MemoryBudget*> MemoryBudget::s_instance{nullptr};
+
+MemoryBudget::MemoryBudget(QObject *parent)
+    : QObject{parent}
+{
+    s_instance.store(this);
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    s_instance.store(nullptr);
+}
+
+MemoryBudget *MemoryBudget::instance()
+{
+    // 随应用程序一起销毁
+    static QPointer<MemoryBudget> budget;
+    if (!budget) budget = new MemoryBudget(QCoreApplication::instance());
+    return budget;
+}
+
+void MemoryBudget::add(Category category, qint64 bytes)
+{
+    if (bytes == 0) return;
+
+    int index = static_cast<int>(category);
+    qint64 categoryBytes = s_bytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    qint64 peakBytes = s_peakBytes[index].load(std::memory_order_relaxed);
+    while (categoryBytes > peakBytes && !s_peakBytes[index].compare_exchange_weak(peakBytes, categoryBytes, std::memory_order_relaxed)) {}
+
+    qint64 total = s_totalBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (tierFor(total, tier()) != tier()) requestCheck();
+}
+
+qint64 MemoryBudget::totalBytes()
+{
+    return s_totalBytes.load(std::memory_order_relaxed);
+}
+
+MemoryBudget::Usage MemoryBudget::usage()
+{
+    Usage usage;
+    for (int i = 0; i < NUMBEROFCATEGORIES; ++i) {
+        usage.bytes[i] = s_bytes[i].load(std::memory_order_relaxed);
+        usage.peakBytes[i] = s_peakBytes[i].load(std::memory_order_relaxed);
+    }
+    usage.totalBytes = totalBytes();
+    usage.budgetBytes = s_budgetBytes.load(std::memory_order_relaxed);
+    usage.tier = tier();
+    return usage;
+}
+
+MemoryBudget::Tier MemoryBudget::tier()
+{
+    return static_cast<Tier>(s_tier.load(std::memory_order_relaxed));
+}
+
+void MemoryBudget::setBudget(qint64 bytes)
+{
+    s_budgetBytes.store(qMax<qint64>(0, bytes));
+    qDebug() << "内存预算:" << bytes / (1024 * 1024) << "MB";
+    requestCheck();
+}
+
+qint64 MemoryBudget::budgetFromEnvironment(qint64 defaultBytes)
+{
+    bool ok = false;
+    qint64 megabytes = qEnvironmentVariable("JIGSAW_MEMORY_BUDGET_MB").toLongLong(&ok);
+    return ok ? megabytes * 1024 * 1024 : defaultBytes;
+}
+
+QString MemoryBudget::categoryName(Category category)
+{
+    switch (category) {
+    case Category::SOURCEIMAGE:
+        return "源图片";
+    case Category::FRAGMENTS:
+        return "碎片";
+    case Category::ROTATEDSPRITES:
+        return "旋转图片";
+    case Category::MASKS:
+        return "遮罩";
+    case Category::PATHS:
+        return "路径";
+    case Category::SAVEBUFFERS:
+        return "存档缓冲";
+    case Category::INTERFACE:
+        return "界面";
+    }
+    return QString();
+}
+
+QString MemoryBudget::tierName(Tier tier)
+{
+    switch (tier) {
+    case Tier::FULL:
+        return "完整";
+    case Tier::REDUCED:
+        return "缩减";
+    case Tier::MINIMAL:
+        return "最低";
+    }
+    return QString();
+}
+
+qint64 MemoryBudget::imageBytes(const QImage &image)
+{
+    return image.sizeInBytes();
+}
+
+qint64 MemoryBudget::pixmapBytes(const QPixmap &pixmap)
+{
+    if (pixmap.isNull()) return 0;
+    return static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+qint64 MemoryBudget::regionBytes(const QRegion &region)
+{
+    return static_cast<qint64>(region.rectCount()) * sizeof(QRect);
+}
+
+qint64 MemoryBudget::pathBytes(const QPainterPath &path)
+{
+    return static_cast<qint64>(path.elementCount()) * sizeof(QPainterPath::Element);
+}
+
+void MemoryBudget::checkBudget()
+{
+    s_checkPending.store(false);
+
+    Tier currentTier = tier();
+    Tier newTier = tierFor(totalBytes(), currentTier);
+    if (newTier == currentTier) return;
+
+    s_tier.store(static_cast<int>(newTier));
+    qDebug() << "内存等级:" << tierName(newTier) << "已用" << totalBytes() / (1024 * 1024) << "MB";
+    emit tierChanged(newTier);
+}
+
+MemoryBudget::Tier MemoryBudget::tierFor(qint64 totalBytes, Tier currentTier)
+{
+    qint64 budgetBytes = s_budgetBytes.load(std::memory_order_relaxed);
+    if (budgetBytes <= 0) return Tier::FULL;
+
+    double ratio = 1.0 * totalBytes / budgetBytes;
+    auto tierAbove = [ratio](double offset) {
+        if (ratio > MINIMALRATIO - offset) return Tier::MINIMAL;
+        if (ratio > REDUCEDRATIO - offset) return Tier::REDUCED;
+        return Tier::FULL;
+    };
+
+    Tier newTier = tierAbove(0.0);
+    // 回到更高的等级之前要先低于界限一段距离，避免在界限附近来回切换
+    if (newTier < currentTier) newTier = qMin(tierAbove(HYSTERESISRATIO), currentTier);
+    return newTier;
+}
+
+void MemoryBudget::requestCheck()
+{
+    MemoryBudget* budget = s_instance.load();
+    if (!budget || s_checkPending.exchange(true)) return;
+    QMetaObject::invokeMethod(budget, &MemoryBudget::checkBudget, Qt::QueuedConnection);
+}
@@ -0,0 +1,151 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <QObject>
+#include <QPointer>
+#include <QPixmap>
+#include <QImage>
+#include <QRegion>
+#include <QPainterPath>
+#include <atomic>
+
+/*
+ * The MemoryBudget keeps track of the memory used by the puzzle, split into categories:
+ *
+ * SOURCEIMAGE     the decoded image and the overlay image while a puzzle is set up
+ * FRAGMENTS       the fragment of the image each piece is drawn from
+ * ROTATEDSPRITES  the drawn (and rotated) pixmap each piece shows
+ * MASKS           the hit masks of the pieces
+ * PATHS           the QPainterPaths of the pieces
+ * SAVEBUFFERS     the JSON data while a game is saved or loaded
+ * INTERFACE       everything held by PuzzleLabels that aren't pieces, like the menu buttons
+ *
+ * Pixmaps are counted as if they weren't shared, so the values are an upper bound. Counting is a relaxed atomic
+ * addition and can be done from any thread, preferably with a MemoryUsage. The current and the peak value of each
+ * category are shown by the RenderStatsOverlay.
+ *
+ * If the total gets close to the budget, the tier is lowered and tierChanged() is emitted. The caches react to it:
+ *
+ * FULL     everything is cached
+ * REDUCED  above REDUCEDRATIO of the budget. The ShapeCache and the PuzzleButtons stop caching pixmaps.
+ * MINIMAL  above MINIMALRATIO of the budget. In addition pieces which can't be rotated release their fragment and
+ *          recover it from their pixmap if they have to be redrawn.
+ *
+ * The tier only goes back up once the total is HYSTERESISRATIO below the limit. The budget is taken from
+ * Jigsaw::Parameters or from the environment variable JIGSAW_MEMORY_BUDGET_MB, a budget of 0 means unlimited.
+ * instance() must be called from the GUI thread once, before tier changes are reported.
+ */
+
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Category {
+        SOURCEIMAGE,
+        FRAGMENTS,
+        ROTATEDSPRITES,
+        MASKS,
+        PATHS,
+        SAVEBUFFERS,
+        INTERFACE
+    };
+    static constexpr int NUMBEROFCATEGORIES = 7;
+
+    enum class Tier {
+        FULL,
+        REDUCED,
+        MINIMAL
+    };
+
+    struct Usage {
+        qint64 bytes[NUMBEROFCATEGORIES] = {};
+        qint64 peakBytes[NUMBEROFCATEGORIES] = {};
+        qint64 totalBytes = 0;
+        qint64 budgetBytes = 0;
+        Tier tier = Tier::FULL;
+    };
+
+    static MemoryBudget* instance();
+
+    static void add(Category category, qint64 bytes);
+    static qint64 totalBytes();
+    static Usage usage();
+    static Tier tier();
+    static void setBudget(qint64 bytes);
+    static qint64 budgetFromEnvironment(qint64 defaultBytes);
+
+    static QString categoryName(Category category);
+    static QString tierName(Tier tier);
+
+    static qint64 imageBytes(const QImage &image);
+    static qint64 pixmapBytes(const QPixmap &pixmap);
+    static qint64 regionBytes(const QRegion &region);
+    static qint64 pathBytes(const QPainterPath &path);
+
+public slots:
+    void checkBudget();
+
+signals:
+    void tierChanged(MemoryBudget::Tier tier);
+
+private:
+    static constexpr double REDUCEDRATIO = 0.75;
+    static constexpr double MINIMALRATIO = 0.9;
+    static constexpr double HYSTERESISRATIO = 0.05;
+
+    explicit MemoryBudget(QObject* parent = nullptr);
+    ~MemoryBudget();
+
+    static Tier tierFor(qint64 totalBytes, Tier currentTier);
+    static void requestCheck();
+
+    static std::atomic<qint64> s_bytes[NUMBEROFCATEGORIES];
+    static std::atomic<qint64> s_peakBytes[NUMBEROFCATEGORIES];
+    static std::atomic<qint64> s_totalBytes;
+    static std::atomic<qint64> s_budgetBytes;
+    static std::atomic<int> s_tier;
+    static std::atomic_bool s_checkPending;
+    static std::atomic<MemoryBudget*> s_instance;
+};
+
+/*
+ * A MemoryUsage holds the bytes one object uses in one category of the MemoryBudget. set() only adds the difference
+ * to the last value, the destructor removes the bytes again.
+ */
+
+class MemoryUsage
+{
+public:
+    explicit MemoryUsage(MemoryBudget::Category category)
+        : m_category(category)
+        , m_bytes(0)
+    {
+
+    }
+
+    ~MemoryUsage()
+    {
+        set(0);
+    }
+
+    MemoryUsage(const MemoryUsage &) = delete;
+    MemoryUsage &operator=(const MemoryUsage &) = delete;
+
+    void set(qint64 bytes)
+    {
+        if (bytes == m_bytes) return;
+        MemoryBudget::add(m_category, bytes - m_bytes);
+        m_bytes = bytes;
+    }
+
+    qint64 bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    MemoryBudget::Category m_category;
+    qint64 m_bytes;
+};
+
+#endif // MEMORY_BUDGET_H
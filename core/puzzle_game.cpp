@@ -1,5 +1,13 @@
 #include "puzzle_game.h"
 #include "ui/game_menu.h"
+#include "ui/shape_cache.h"
+#include "ui/animation_scheduler.h"
+#include "core/trace.h"
+#include "core/memory_budget.h"
+#include "core/shape_library.h"
+#include "tools/image_ops.h"
+#include "tools/image_pyramid.h"
+#include "tools/piece_scatter.h"
 #include "qapplication.h"
 #include "qdebug.h"
 #include <random>
@@ -9,59 +17,136 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QTimer>
+#include <QImageReader>
+#include <QShortcut>
+#include <QMenu>
+#include <QWheelEvent>
+#include <QtMath>
 
-// 定义全局随机数生成器
-std::mt19937 Jigsaw::g_randomGenerator;
+// 定义随机数生成器（每个线程一个）
+thread_local std::mt19937 Jigsaw::g_randomGenerator;
 
 void PuzzleGame::createNewMergedPiece(PuzzlePiece *firstPiece)
 {
     m_mergedPieces.push_back(QVector<PuzzlePiece*>(1, firstPiece));
-    QObject::disconnect(firstPiece, &PuzzlePiece::dragStopped, this, &PuzzleGame::fixPieceIfPossible);
-    QObject::connect(firstPiece, &PuzzlePiece::dragStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
-    QObject::disconnect(firstPiece, &PuzzlePiece::rotateStopped, this, &PuzzleGame::fixPieceIfPossible);
-    QObject::connect(firstPiece, &PuzzlePiece::rotateStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
+    m_mergedPieceSprites.push_back(nullptr);
+    m_mergedPieceFrontiers.push_back(QSet<int>());
+    m_mergedPieceIDs[firstPiece->id()] = m_mergedPieces.size() - 1;
+    updateFrontier(m_mergedPieces.size() - 1, firstPiece->id());
 }
 
 void PuzzleGame::addPuzzlePieceToMergedPiece(PuzzlePiece *piece, int mergedPieceID)
 {
     m_mergedPieces[mergedPieceID].push_back(piece);
-    QObject::disconnect(piece, &PuzzlePiece::dragStopped, this, &PuzzleGame::fixPieceIfPossible);
-    QObject::connect(piece, &PuzzlePiece::dragStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
-    QObject::disconnect(piece, &PuzzlePiece::rotateStopped, this, &PuzzleGame::fixPieceIfPossible);
-    QObject::connect(piece, &PuzzlePiece::rotateStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
+    m_mergedPieceIDs[piece->id()] = mergedPieceID;
+    updateMergedPieceSprite(mergedPieceID, {piece});
+
+    // 只有新碎片和它在组内的邻居可能改变是否在边缘上
+    updateFrontier(mergedPieceID, piece->id());
+    for (int neighborID : neighborIDs(piece->id())) {
+        if (neighborID >= 0 && neighborID < m_mergedPieceIDs.size() && m_mergedPieceIDs[neighborID] == mergedPieceID) {
+            updateFrontier(mergedPieceID, neighborID);
+        }
+    }
 }
 
 void PuzzleGame::combineTwoMergedPieces(int firstMergedPieceID, int secondMergedPieceID)
 {
+    for (const auto &piece : m_mergedPieces[secondMergedPieceID]) {
+        m_mergedPieceIDs[piece->id()] = firstMergedPieceID;
+    }
+
+    // 已经拼好的图片继续使用，只画另一组的碎片
+    QVector<PuzzlePiece*> addedPieces = m_mergedPieces[secondMergedPieceID];
+    MergedPieceSprite* secondSprite = m_mergedPieceSprites[secondMergedPieceID];
+    if (secondSprite && !m_mergedPieceSprites[firstMergedPieceID]) {
+        m_mergedPieceSprites[firstMergedPieceID] = secondSprite;
+        addedPieces = m_mergedPieces[firstMergedPieceID];
+    }
+    else {
+        delete secondSprite;
+    }
     m_mergedPieces[firstMergedPieceID] += m_mergedPieces[secondMergedPieceID];
+    updateMergedPieceSprite(firstMergedPieceID, addedPieces);
+
+    // 接缝两侧的碎片只可能在两个组的边缘上
+    m_mergedPieceFrontiers[firstMergedPieceID] += m_mergedPieceFrontiers[secondMergedPieceID];
+    const QSet<int> frontier = m_mergedPieceFrontiers[firstMergedPieceID];
+    for (int id : frontier) {
+        updateFrontier(firstMergedPieceID, id);
+    }
+
     m_mergedPieces.removeAt(secondMergedPieceID);
+    m_mergedPieceSprites.removeAt(secondMergedPieceID);
+    m_mergedPieceFrontiers.removeAt(secondMergedPieceID);
+
+    // 被删除的合并组后面的索引前移
+    for (int &mergedPieceID : m_mergedPieceIDs) {
+        if (mergedPieceID > secondMergedPieceID) --mergedPieceID;
+    }
 }
 
-bool PuzzleGame::isPartOfMergedPiece(PuzzlePiece *piece, int &mergedPieceID)
+void PuzzleGame::updateMergedPieceSprite(int mergedPieceID, const QVector<PuzzlePiece*> &addedPieces)
 {
-    mergedPieceID = -1;
-    for (int i = 0; i < m_mergedPieces.size(); ++i) {
-        if (m_mergedPieces[i].contains(piece)) {
-            mergedPieceID = i;
-            return true;
-        }
+    MergedPieceSprite* &sprite = m_mergedPieceSprites[mergedPieceID];
+    if (sprite) {
+        sprite->addPieces(addedPieces);
+        cullMergedPiece(mergedPieceID);
+        return;
     }
-    return false;
+    if (m_mergedPieces[mergedPieceID].size() < MINPIECESTOFLATTEN) return;
+
+    sprite = new MergedPieceSprite(m_boardLayer);
+    sprite->setBoardView(m_boardView);
+    sprite->flatten(m_mergedPieces[mergedPieceID]);
+    sprite->stackUnder(m_mergedPieces[mergedPieceID].first());
+    cullMergedPiece(mergedPieceID);
 }
 
-bool PuzzleGame::areMerged(PuzzlePiece *first, PuzzlePiece *second)
+/*
+ * Returns the IDs of the pieces north, east, south and west of the piece in the solved puzzle, -1 if there is none.
+ * The pieces might not have been created yet while the puzzle is set up.
+ */
+
+QVector<int> PuzzleGame::neighborIDs(int id) const
 {
-    int firstMergedPieceID;
-    int secondMergedPieceID;
-    if (!isPartOfMergedPiece(first, firstMergedPieceID)) return false;
-    if (!isPartOfMergedPiece(second, secondMergedPieceID)) return false;
-    if (firstMergedPieceID == -1 && secondMergedPieceID == -1) return false;
-    if (firstMergedPieceID == secondMergedPieceID) return true;
+    int pieceNorthID = id - m_cols;
+    int pieceEastID = (id + 1) % m_cols == 0 ? -1 : id + 1;
+    int pieceSouthID = (id + m_cols >= m_numberOfPieces) ? -1 : id + m_cols;
+    int pieceWestID = id % m_cols == 0 ? -1 : id - 1;
+    return {pieceNorthID, pieceEastID, pieceSouthID, pieceWestID};
+}
+
+bool PuzzleGame::isOnFrontier(int id) const
+{
+    int mergedPieceID = m_mergedPieceIDs[id];
+    for (int neighborID : neighborIDs(id)) {
+        if (neighborID < 0) continue;
+        if (mergedPieceID < 0 || neighborID >= m_mergedPieceIDs.size() || m_mergedPieceIDs[neighborID] != mergedPieceID) return true;
+    }
     return false;
 }
 
+void PuzzleGame::updateFrontier(int mergedPieceID, int id)
+{
+    if (isOnFrontier(id)) m_mergedPieceFrontiers[mergedPieceID].insert(id);
+    else m_mergedPieceFrontiers[mergedPieceID].remove(id);
+}
+
+bool PuzzleGame::isPartOfMergedPiece(PuzzlePiece *piece, int &mergedPieceID)
+{
+    mergedPieceID = (piece && piece->id() < m_mergedPieceIDs.size()) ? m_mergedPieceIDs[piece->id()] : -1;
+    return mergedPieceID >= 0;
+}
+
+void PuzzleGame::syncMergedPiece(int mergedPieceID)
+{
+    if (m_mergedPieceSprites[mergedPieceID]) m_mergedPieceSprites[mergedPieceID]->syncPieces();
+}
+
 void PuzzleGame::fixPieceIfPossible(int id)
 {
+    TraceSpan span("PuzzleGame::fixPieceIfPossible");
     // 只有在游戏真正开始后才记录移动步数
     if (m_gameStarted) {
         updateMovesDisplay();
@@ -71,50 +156,108 @@ void PuzzleGame::fixPieceIfPossible(int id)
     piece->lower();
     m_background->lower();
 
-    int pieceNorthID = id - m_cols;
-    int pieceEastID = (id + 1) % m_cols == 0 ? -1 : id + 1;
-    int pieceSouthID = (id + m_cols >= m_numberOfPieces) ? -1 : id + m_cols;
-    int pieceWestID = id % m_cols == 0 ? -1 : id - 1;
-
-    QVector<PuzzlePiece*> neighbors;
-    neighbors.push_back(pieceNorthID >= 0 ? m_puzzlePieces[pieceNorthID] : nullptr);
-    neighbors.push_back(pieceEastID >= 0 ? m_puzzlePieces[pieceEastID] : nullptr);
-    neighbors.push_back(pieceSouthID >= 0 ? m_puzzlePieces[pieceSouthID] : nullptr);
-    neighbors.push_back(pieceWestID >= 0 ? m_puzzlePieces[pieceWestID] : nullptr);
+    for (int neighborID : neighborIDs(id)) {
+        // 拼图分批生成时，邻居可能还没有放到棋盘上
+        if (neighborID < 0 || neighborID >= m_puzzlePieces.size()) continue;
+        PuzzlePiece* neighbor = m_puzzlePieces[neighborID];
+        if (!isInCorrectPosition(piece, neighbor)) continue;
+
+        // 贴到第一个合适的邻居上，其余的邻居由合并组检查
+        piece->move(piece->originalPosition() + snapOffset(piece, neighbor));
+        int mergedPieceID;
+        if (isPartOfMergedPiece(neighbor, mergedPieceID)) {
+            addPuzzlePieceToMergedPiece(piece, mergedPieceID);
+        }
+        else {
+            createNewMergedPiece(neighbor);
+            isPartOfMergedPiece(neighbor, mergedPieceID);
+            addPuzzlePieceToMergedPiece(piece, mergedPieceID);
+        }
+        snapMergedPiece(mergedPieceID);
+        checkIfGameWon(piece);
+        return;
+    }
+}
 
+void PuzzleGame::fixMergedPieceIfPossible(int id)
+{
+    TraceSpan span("PuzzleGame::fixMergedPieceIfPossible");
     int mergedPieceID;
-    int neighborMergedPieceID;
+    if (!isPartOfMergedPiece(m_puzzlePieces[id], mergedPieceID)) {
+        fixPieceIfPossible(id);
+        return;
+    }
 
-    for (const auto &neighbor: neighbors) {
-        if (isInCorrectPosition(piece, neighbor) && !areMerged(piece, neighbor)) {
+    // 整组碎片算一步
+    if (m_gameStarted) {
+        updateMovesDisplay();
+    }
 
-            if (isPartOfMergedPiece(piece, mergedPieceID)) {
-                for (const auto &pieces : m_mergedPieces[mergedPieceID]) {
-                    repositionPiece(pieces, neighbor);
+    // 拖动时只移动了图片，先让碎片跟上。旋转结束后，按新的角度重新拼成一张图
+    syncMergedPiece(mergedPieceID);
+    MergedPieceSprite* sprite = m_mergedPieceSprites[mergedPieceID];
+    if (sprite && sprite->isRotated()) sprite->flatten(m_mergedPieces[mergedPieceID]);
+
+    if (sprite) {
+        sprite->lower();
+    }
+    else {
+        for (const auto &piece : m_mergedPieces[mergedPieceID]) {
+            piece->lower();
+        }
+    }
+    m_background->lower();
+
+    snapMergedPiece(mergedPieceID);
+    checkIfGameWon(m_puzzlePieces[id]);
+}
+
+/*
+ * Merges the group with every neighbor that lies in the correct position. Only the pieces on the frontier of the group,
+ * which have at least one neighbor outside of it, are checked. For each neighbor it is merged with, the group is moved
+ * once, so the two fit together exactly. A merge changes the frontier, so the search starts again after each merge.
+ */
+
+void PuzzleGame::snapMergedPiece(int mergedPieceID)
+{
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        const QSet<int> frontier = m_mergedPieceFrontiers[mergedPieceID];
+        for (auto it = frontier.cbegin(); it != frontier.cend() && !merged; ++it) {
+            PuzzlePiece* piece = m_puzzlePieces[*it];
+            for (int neighborID : neighborIDs(piece->id())) {
+                if (neighborID < 0 || neighborID >= m_puzzlePieces.size() || m_mergedPieceIDs[neighborID] == mergedPieceID) continue;
+                PuzzlePiece* neighbor = m_puzzlePieces[neighborID];
+                if (!isInCorrectPosition(piece, neighbor)) continue;
+
+                QPointF offset = snapOffset(piece, neighbor);
+                for (const auto &mergedPiece : m_mergedPieces[mergedPieceID]) {
+                    mergedPiece->move(mergedPiece->originalPosition() + offset);
                 }
+                if (m_mergedPieceSprites[mergedPieceID]) m_mergedPieceSprites[mergedPieceID]->followAnchor();
+
+                int neighborMergedPieceID;
                 if (isPartOfMergedPiece(neighbor, neighborMergedPieceID)) {
                     combineTwoMergedPieces(mergedPieceID, neighborMergedPieceID);
+                    // 删除另一组后索引可能前移
+                    mergedPieceID = m_mergedPieceIDs[piece->id()];
                 }
                 else {
                     addPuzzlePieceToMergedPiece(neighbor, mergedPieceID);
                 }
-            }
-            else
-            {
-                repositionPiece(piece, neighbor);
-                if (isPartOfMergedPiece(neighbor, neighborMergedPieceID)) {
-                    addPuzzlePieceToMergedPiece(piece, neighborMergedPieceID);
-                }
-                else {
-                    createNewMergedPiece(piece);
-                    isPartOfMergedPiece(piece, mergedPieceID);
-                    addPuzzlePieceToMergedPiece(neighbor, mergedPieceID);
-                }
+                merged = true;
+                break;
             }
         }
     }
+}
+
+void PuzzleGame::checkIfGameWon(PuzzlePiece *piece)
+{
+    int mergedPieceID;
     // 检查是否完成拼图
-    if (!m_gameWon && !m_mergedPieces.isEmpty() && m_mergedPieces[0].size() == m_numberOfPieces) {
+    if (!m_gameWon && isPartOfMergedPiece(piece, mergedPieceID) && m_mergedPieces[mergedPieceID].size() == m_numberOfPieces) {
         m_gameWon = true;  // 设置胜利标志，防止重复触发
         // 添加延迟，确保所有操作完成后再显示胜利界面
         QTimer::singleShot(100, this, [this]() {
@@ -123,88 +266,59 @@ void PuzzleGame::fixPieceIfPossible(int id)
     }
 }
 
-void PuzzleGame::fixMergedPieceIfPossible(int id)
-{
-    int mergedPieceID;
-    isPartOfMergedPiece(m_puzzlePieces[id], mergedPieceID);
-    for (const auto &piece: m_mergedPieces[mergedPieceID]) {
-        fixPieceIfPossible(piece->id());
-    }
-}
-
 bool PuzzleGame::isInCorrectPosition(PuzzlePiece *piece, PuzzlePiece *neighbor, int tolerance)
 {
-    if (!neighbor) return false;
-
-    QPoint pieceGridPoint = m_grid->overlayGridPoint(piece->id());
-    QPoint neighborGridPoint = m_grid->overlayGridPoint(neighbor->id());
-
-    QLineF gridLine(pieceGridPoint, neighborGridPoint);
-    QLineF positionLine;
-    positionLine.setP1(piece->center());
-    positionLine.setAngle(gridLine.angle() + piece->angle());
-    positionLine.setLength(gridLine.length());
+    if (!neighbor || piece->angle() != neighbor->angle()) return false;
 
-    QLineF positionDifference(positionLine.p2(), neighbor->center());
-    double distance = positionDifference.length();
+    // 另一组可能正被拖动，碎片还在原来的位置
+    int mergedPieceID;
+    if (isPartOfMergedPiece(piece, mergedPieceID)) syncMergedPiece(mergedPieceID);
+    if (isPartOfMergedPiece(neighbor, mergedPieceID)) syncMergedPiece(mergedPieceID);
 
-    return distance <= tolerance && piece->angle() == neighbor->angle();
+    // 容差是屏幕上的像素，缩小时在棋盘上相应变大
+    double boardTolerance = tolerance / m_boardView->zoom();
+    QPointF difference = snapOffset(piece, neighbor);
+    return QPointF::dotProduct(difference, difference) <= boardTolerance * boardTolerance;
 }
 
-void PuzzleGame::repositionPiece(PuzzlePiece *piece, PuzzlePiece *neighbor)
+/*
+ * Returns how far piece has to be moved to fit exactly to neighbor. The offset between the centers of two pieces in
+ * the solved puzzle is the offset between their grid points, rotated by the angle of the pieces. The sines and cosines
+ * of all angles are calculated once.
+ */
+
+QPointF PuzzleGame::snapOffset(PuzzlePiece *piece, PuzzlePiece *neighbor) const
 {
-    QPoint pieceGridPoint = m_grid->overlayGridPoint(piece->id());
-    QPoint neighborGridPoint = m_grid->overlayGridPoint(neighbor->id());
-    QLineF line(neighborGridPoint, pieceGridPoint);
-    piece->rotateAroundPoint(neighbor->angle(), neighbor->center(), line.length(), line.angle());
+    static const QVector<QPointF> rotationSteps = []() {
+        QVector<QPointF> steps(360);
+        for (int angle = 0; angle < steps.size(); ++angle) {
+            double radians = qDegreesToRadians(static_cast<double>(angle));
+            steps[angle] = QPointF(qCos(radians), qSin(radians));
+        }
+        return steps;
+    }();
+
+    int angle = piece->angle() % 360;
+    if (angle < 0) angle += 360;
+    const QPointF &step = rotationSteps[angle];
+
+    QPoint gridOffset = m_grid->overlayGridPoint(neighbor->id()) - m_grid->overlayGridPoint(piece->id());
+    QPointF expectedOffset(gridOffset.x() * step.x() + gridOffset.y() * step.y(), gridOffset.y() * step.x() - gridOffset.x() * step.y());
+    return neighbor->center() - piece->center() - expectedOffset;
 }
 
-void PuzzleGame::calculateRowsAndCols(int numberOfPieces, const QPixmap &image)
+void PuzzleGame::calculateRowsAndCols(int numberOfPieces, const QSize &imageSize)
 {
     int maxImageWidth = m_parameters.screenWidth * 2 / 3;
     int maxImageHeight = m_parameters.screenHeight * 4 / 5;
     QSize maxImageSize(maxImageWidth, maxImageHeight);
-    QSize imageSize(image.size());
     QSize actualImageSize = imageSize.scaled(maxImageSize, Qt::KeepAspectRatio);
     double imageRatio = 1.0 * actualImageSize.width() / actualImageSize.height();
 
-    // 计算最接近目标碎片数量的行数和列数
-    int rows = 1;
-    int cols = 1;
-    int bestRows = 1;
-    int bestCols = 1;
-    int bestDifference = abs(numberOfPieces - 1);
-    
-    // 尝试不同的行数，找到最接近目标数量的组合
-    for (int r = 1; r <= numberOfPieces; ++r) {
-        int c = qRound(r * imageRatio);
-        if (c < 1) c = 1;
-        
-        int pieces = r * c;
-        int difference = abs(pieces - numberOfPieces);
-        
-        if (difference < bestDifference) {
-            bestDifference = difference;
-            bestRows = r;
-            bestCols = c;
-        }
-        
-        // 如果找到完全匹配的，直接使用
-        if (difference == 0) {
-            bestRows = r;
-            bestCols = c;
-            break;
-        }
-    }
-    
-    // 确保碎片数量不超过目标数量太多
-    if (bestRows * bestCols > numberOfPieces * 1.5) {
-        // 如果碎片数量太多，尝试减少行数
-        bestRows = qRound(qSqrt(numberOfPieces / imageRatio));
-        if (bestRows < 1) bestRows = 1;
-        bestCols = qRound(bestRows * imageRatio);
-        if (bestCols < 1) bestCols = 1;
-    }
+    // 计算最接近目标碎片数量、碎片尽量接近正方形的行数和列数
+    int bestRows;
+    int bestCols;
+    PuzzleGrid::calculateRowsAndCols(numberOfPieces, imageRatio, bestRows, bestCols);
     
     m_rows = bestRows;
     m_cols = bestCols;
@@ -214,59 +328,312 @@ void PuzzleGame::calculateRowsAndCols(int numberOfPieces, const QPixmap &image)
     m_pieceHeight = actualImageSize.height() / m_rows;
 }
 
-void PuzzleGame::setupImage()
+bool PuzzleGame::isLargePuzzle() const
 {
-    QSize overlaySize(m_grid->puzzleTotalSize());
-    QSize scaledImageSize(m_cols * m_pieceWidth + 1, m_rows * m_pieceHeight + 1);
+    return m_numberOfPieces >= m_parameters.minNumberOfPiecesLargePuzzle;
+}
 
-    QPixmap overlayPixmap(overlaySize);
-    overlayPixmap.fill(Qt::transparent);
-    QPixmap scaledImage = m_image.scaled(scaledImageSize);
+void PuzzleGame::setupRenderStatsOverlay()
+{
+    m_renderStatsOverlay = new RenderStatsOverlay(this);
+    m_renderStatsOverlay->move(10, 100);
 
-    QPainter painter(&overlayPixmap);
-    painter.drawPixmap(m_grid->symmetricGridPoint(0), scaledImage, QRect(QPoint(0, 0), scaledImageSize));
+    connect(m_renderStatsOverlay, &RenderStatsOverlay::refreshRequested, this, [this]() {
+        int largestGroup = 0;
+        for (const auto &mergedPiece : m_mergedPieces) {
+            largestGroup = qMax(largestGroup, static_cast<int>(mergedPiece.size()));
+        }
+        m_renderStatsOverlay->setBoardStats(m_puzzlePieces.size(), m_mergedPieces.size(), largestGroup);
+    });
+
+    QShortcut* shortcut = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    shortcut->setContext(Qt::ApplicationShortcut);
+    connect(shortcut, &QShortcut::activated, m_renderStatsOverlay, &RenderStatsOverlay::toggle);
+
+    if (RenderStatsOverlay::enabledByEnvironment()) m_renderStatsOverlay->show();
+}
 
-    m_image = overlayPixmap;
+void PuzzleGame::setupMemoryBudget()
+{
+    connect(MemoryBudget::instance(), &MemoryBudget::tierChanged, this, &PuzzleGame::applyMemoryTier);
+    MemoryBudget::setBudget(MemoryBudget::budgetFromEnvironment(static_cast<qint64>(m_parameters.memoryBudgetMB) * 1024 * 1024));
 }
 
-void PuzzleGame::generatePuzzlePieces()
+void PuzzleGame::setupImagePyramidCache()
 {
-    for (unsigned int i = 0; i < m_numberOfPieces; ++i) {
-        m_puzzlePieces.push_back(new PuzzlePiece(i, m_grid->pieceTotalSize(), QBrush(createImageFragment(i)), m_grid->puzzlePath(i), this));
-        m_puzzlePieces.last()->setRotationEnabled(m_rotationAllowed);
-         if (m_rotationAllowed) m_puzzlePieces.last()->setAngle(Jigsaw::randomNumber(0, 35) * 10);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::dragStarted, this, &PuzzleGame::raisePieces);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::dragged, this, &PuzzleGame::dragMergedPieces);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::dragStopped, this, &PuzzleGame::fixPieceIfPossible);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::rotateStarted, this, &PuzzleGame::raisePieces);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::rotated, this, &PuzzleGame::rotateMergedPieces);
-        QObject::connect(m_puzzlePieces.last(), &PuzzlePiece::rotateStopped, this, &PuzzleGame::fixPieceIfPossible);
+    // 最大保留屏幕两倍的分辨率，足够以后放大棋盘使用
+    ImagePyramidCache* pyramidCache = ImagePyramidCache::instance();
+    pyramidCache->setMaxSize(QSize(m_parameters.screenWidth, m_parameters.screenHeight) * 2);
+    connect(pyramidCache, &ImagePyramidCache::pyramidReady, this, &PuzzleGame::showOwnImagePreview);
+}
+
+void PuzzleGame::applyMemoryTier(MemoryBudget::Tier tier)
+{
+    if (tier == MemoryBudget::Tier::FULL) return;
+
+    ShapeCache::releasePixmaps();
+    ImagePyramidCache::instance()->trim(1);
+    int deletedPieces = m_piecePool.trim();
+    if (deletedPieces > 0) qDebug() << "删除池中的碎片:" << deletedPieces << "块";
+    if (tier == MemoryBudget::Tier::MINIMAL) {
+        int releasedFragments = 0;
+        for (auto piece : m_puzzlePieces) {
+            if (piece->releaseFragment()) ++releasedFragments;
+        }
+        qDebug() << "释放碎片图片:" << releasedFragments << "块";
     }
 }
 
-void PuzzleGame::placePuzzlePieces()
+void PuzzleGame::setupTraceShortcut()
 {
-    for (auto piece: m_puzzlePieces) {
-        double ax, ay;
-        do {
-            ax = Jigsaw::randomNumber(0, m_parameters.screenWidth - m_grid->pieceTotalWidth());
-            ay = Jigsaw::randomNumber(0, m_parameters.screenHeight - m_grid->pieceTotalHeight());
+    QShortcut* shortcut = new QShortcut(QKeySequence(Qt::Key_F4), this);
+    shortcut->setContext(Qt::ApplicationShortcut);
+    connect(shortcut, &QShortcut::activated, this, []() {
+        if (Trace::isEnabled()) {
+            QString filename = Trace::stop();
+            if (filename.isEmpty()) qDebug() << "跟踪写入失败";
+        }
+        else {
+            Trace::start();
         }
-        while (m_parameters.rectFreeArea.contains(QPoint(ax, ay)));
-        piece->move(ax, ay);
-        piece->raise();
-        piece->show();
+    });
+}
+
+void PuzzleGame::setupProgressLabel()
+{
+    m_setupProgressLabel = new QLabel(this);
+    m_setupProgressLabel->setGeometry((width() - 400) / 2, 10, 400, 40);
+    m_setupProgressLabel->setAlignment(Qt::AlignCenter);
+    m_setupProgressLabel->setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 0.7); border-radius: 10px; color: white; font-size: 16px; font-weight: bold; }");
+    m_setupProgressLabel->hide();
+
+    m_setupBatchTimer = new QTimer(this);
+    m_setupBatchTimer->setInterval(0);
+    connect(m_setupBatchTimer, &QTimer::timeout, this, &PuzzleGame::createPendingPuzzlePieces);
+}
+
+void PuzzleGame::setupInputDispatcher()
+{
+    // 所有碎片共用一个分发器，合并的碎片由槽函数处理，合并时不需要重新连接
+    m_inputDispatcher = new BoardInputDispatcher(this);
+    connect(m_inputDispatcher, &BoardInputDispatcher::dragStarted, this, &PuzzleGame::raisePieces);
+    connect(m_inputDispatcher, &BoardInputDispatcher::dragged, this, &PuzzleGame::dragMergedPieces);
+    connect(m_inputDispatcher, &BoardInputDispatcher::dragStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
+    connect(m_inputDispatcher, &BoardInputDispatcher::rotateStarted, this, &PuzzleGame::raisePieces);
+    connect(m_inputDispatcher, &BoardInputDispatcher::rotated, this, &PuzzleGame::rotateMergedPieces);
+    connect(m_inputDispatcher, &BoardInputDispatcher::rotateStopped, this, &PuzzleGame::fixMergedPieceIfPossible);
+}
+
+void PuzzleGame::setupBoardView()
+{
+    m_boardView = new BoardView(this);
+    connect(m_boardView, &BoardView::changed, this, &PuzzleGame::boardViewChanged);
+}
+
+void PuzzleGame::updateSetupProgress(PuzzleSetupWorker::Stage stage, int percent)
+{
+    m_setupProgressLabel->setText(QString("正在生成拼图: %1 %2%").arg(PuzzleSetupWorker::stageName(stage)).arg(percent));
+}
+
+void PuzzleGame::startPuzzleSetup(bool placePieces)
+{
+    m_boardView->reset();
+
+    PuzzleSetupWorker::Settings settings;
+    settings.filename = m_filename;
+    settings.rows = m_rows;
+    settings.cols = m_cols;
+    settings.pieceWidth = m_pieceWidth;
+    settings.pieceHeight = m_pieceHeight;
+    settings.typeOfPiece = m_typeOfPiece;
+    settings.customPath = m_customJigsawPath;
+    settings.randomSeed = m_randomSeed;
+    settings.rotationAllowed = m_rotationAllowed;
+    settings.maxCollisionAttempts = isLargePuzzle() ? m_parameters.maxCollisionAttemptsLargePuzzle : settings.maxCollisionAttempts;
+    settings.placePieces = placePieces;
+    settings.boardSize = QSize(m_parameters.screenWidth, m_parameters.screenHeight);
+    settings.freeArea = m_parameters.rectFreeArea;
+    settings.pyramid = ImagePyramidCache::instance()->find(m_filename);
+    settings.maxImageSize = ImagePyramidCache::instance()->maxSize();
+
+    PuzzleSetupWorker* worker = new PuzzleSetupWorker(settings);
+    QThread* thread = new QThread();
+    worker->moveToThread(thread);
+
+    quint64 generation = ++m_setupGeneration;
+    m_setupThread = thread;
+    m_setupCancelled = worker->cancelFlag();
+    m_setupWorkerFinished = false;
+    m_setupRestoresGame = !placePieces;
+    m_pendingSetupPieces.clear();
+    m_pendingSetupPiecesIndex = 0;
+    m_setupElapsedTimer.start();
+    m_piecePool.resetStatistics();
+
+    QObject::connect(thread, &QThread::started, worker, &PuzzleSetupWorker::run);
+    QObject::connect(worker, &PuzzleSetupWorker::finished, thread, &QThread::quit);
+    QObject::connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    // 已取消的工作线程可能还有信号在队列中，根据生成的编号过滤掉。新的工作线程可能和已删除的在同一个地址，不能比较发送者
+    QObject::connect(worker, &PuzzleSetupWorker::progressChanged, this, [this, generation](PuzzleSetupWorker::Stage stage, int percent) {
+        if (generation == m_setupGeneration) updateSetupProgress(stage, percent);
+    });
+    QObject::connect(worker, &PuzzleSetupWorker::pyramidReady, this, [](const QString &filename, ImagePyramidPointer pyramid) {
+        ImagePyramidCache::instance()->insert(filename, pyramid);
+    });
+    QObject::connect(worker, &PuzzleSetupWorker::gridReady, this, [this, generation](PuzzleGrid* grid) {
+        if (generation != m_setupGeneration) {
+            grid->deleteLater();
+            return;
+        }
+        grid->setParent(this);
+        m_grid = grid;
+    });
+    QObject::connect(worker, &PuzzleSetupWorker::fragmentLevelsReady, this, [this, generation](ImagePyramidPointer levels) {
+        if (generation == m_setupGeneration) m_fragmentLevels = levels;
+    });
+    QObject::connect(worker, &PuzzleSetupWorker::piecesReady, this, [this, generation](const QVector<PuzzleSetupPiece> &pieces) {
+        if (generation != m_setupGeneration) return;
+        m_pendingSetupPieces += pieces;
+        if (!m_setupBatchTimer->isActive()) m_setupBatchTimer->start();
+    });
+    QObject::connect(worker, &PuzzleSetupWorker::finished, this, [this, generation](bool successful) {
+        if (generation != m_setupGeneration) return;
+        m_setupWorkerFinished = true;
+        if (!successful) {
+            qDebug() << "拼图生成失败";
+        }
+        if (m_pendingSetupPiecesIndex >= m_pendingSetupPieces.size()) finishPuzzleSetup();
+    });
+
+    updateSetupProgress(PuzzleSetupWorker::Stage::DECODE, 0);
+    m_setupProgressLabel->show();
+    m_setupProgressLabel->raise();
+
+    thread->start();
+}
+
+void PuzzleGame::cancelPuzzleSetup()
+{
+    if (!m_setupCancelled) return;
+
+    m_setupCancelled->store(true);
+    ++m_setupGeneration;
+    m_setupCancelled.reset();
+
+    // 已经结束的线程会删除自己，只留下还在运行的
+    m_cancelledSetupThreads.removeAll(QPointer<QThread>());
+    if (m_setupThread) m_cancelledSetupThreads.append(m_setupThread);
+    m_setupThread = nullptr;
+    m_setupBatchTimer->stop();
+    m_pendingSetupPieces.clear();
+    m_pendingSetupPiecesIndex = 0;
+    m_setupProgressLabel->hide();
+}
+
+void PuzzleGame::finishPuzzleSetup()
+{
+    TraceSpan span("PuzzleGame::finishPuzzleSetup");
+    ++m_setupGeneration;
+    m_setupCancelled.reset();
+    m_setupBatchTimer->stop();
+    m_pendingSetupPieces.clear();
+    m_pendingSetupPiecesIndex = 0;
+    m_setupProgressLabel->hide();
+
+    qDebug() << "拼图生成完成:" << m_puzzlePieces.size() << "块，用时" << m_setupElapsedTimer.elapsed() << "毫秒，重用" << m_piecePool.reusedPieces() << "块";
+
+    // 合并组恢复之前缩放，拼成的图片直接按最终的缩放绘制
+    fitPiecesIntoView();
+
+    if (m_setupRestoresGame) {
+        restoreGameState(m_pendingGameData);
+        m_pendingGameData = GameSaveData();
+        m_pendingPieceData.clear();
+    }
+    else if (m_puzzlePieces.size() == m_numberOfPieces) {
+        // 启动游戏计时器
+        startGameTimer();
+    }
+}
+
+void PuzzleGame::clearPuzzle()
+{
+    // 碎片放回池中，下一局不用重新创建控件
+    m_mouseTarget = nullptr;
+    m_panning = false;
+    for (auto piece : m_puzzlePieces) {
+        m_piecePool.release(piece);
+    }
+    m_puzzlePieces.clear();
+    qDeleteAll(m_mergedPieceSprites);
+    m_mergedPieceSprites.clear();
+    m_mergedPieceFrontiers.clear();
+    m_mergedPieces.clear();
+    m_mergedPieceIDs.clear();
+
+    if (m_grid) {
+        m_grid->deleteLater();
+        m_grid = nullptr;
     }
+    m_fragmentLevels.reset();
 }
 
-QPixmap PuzzleGame::createImageFragment(int pieceID)
+void PuzzleGame::createPendingPuzzlePieces()
 {
-    QSize puzzlePieceSize(m_grid->pieceTotalSize());
-    QPixmap imageFragment(puzzlePieceSize);
-    QPainter fragmentPainter(&imageFragment);
+    TraceSpan span("PuzzleGame::createPendingPuzzlePieces");
+    // 每次事件循环最多占用 setupMSecsPerTick 毫秒，保证界面在生成大型拼图时也能响应
+    QElapsedTimer tickTimer;
+    tickTimer.start();
+    do {
+        createPuzzlePiece(m_pendingSetupPieces[m_pendingSetupPiecesIndex]);
+        ++m_pendingSetupPiecesIndex;
+    }
+    while (m_pendingSetupPiecesIndex < m_pendingSetupPieces.size() && tickTimer.elapsed() < m_parameters.setupMSecsPerTick);
+    updateSetupProgress(PuzzleSetupWorker::Stage::SPRITES, m_numberOfPieces > 0 ? m_puzzlePieces.size() * 100 / m_numberOfPieces : 100);
+
+    if (m_pendingSetupPiecesIndex >= m_pendingSetupPieces.size()) {
+        m_setupBatchTimer->stop();
+        m_pendingSetupPieces.clear();
+        m_pendingSetupPiecesIndex = 0;
+        if (m_setupWorkerFinished) finishPuzzleSetup();
+    }
+}
+
+void PuzzleGame::createPuzzlePiece(const PuzzleSetupPiece &pieceData)
+{
+    TraceSpan span("PuzzleGame::createPuzzlePiece");
+    if (!m_grid || pieceData.id != m_puzzlePieces.size()) return;
+
+    PuzzlePiece* piece = m_piecePool.acquire(pieceData.id, m_grid->pieceTotalSize(), QBrush(ImageOps::toPixmap(pieceData.fragment)), pieceData.path);
+    piece->setFragmentLevels(m_fragmentLevels, m_grid->puzzleTotalSize(), m_grid->overlayGridPoint(pieceData.id));
+    piece->setBoardView(m_boardView);
+    piece->setRotationEnabled(m_rotationAllowed);
+
+    if (!m_setupRestoresGame) {
+        if (m_rotationAllowed) piece->setAngle(pieceData.angle);
+        piece->move(pieceData.position);
+    }
+    else if (m_pendingPieceData.contains(pieceData.id)) {
+        // 恢复碎片状态（不随机放置）
+        const PuzzlePieceSaveData &savedPiece = m_pendingPieceData[pieceData.id];
+        piece->move(savedPiece.position);
+        piece->setAngle(savedPiece.angle);
+    }
+    else if (m_pendingGameData.pieces.isEmpty()) {
+        // 如果没有碎片数据，使用默认位置
+        piece->move(100.0 + pieceData.id * 10.0, 100.0 + pieceData.id * 10.0);
+    }
+
+    // 放好以后才连接，初始的旋转不会被当作玩家的操作
+    piece->setInputDispatcher(m_inputDispatcher);
+    m_puzzlePieces.push_back(piece);
+    m_mergedPieceIDs.push_back(-1);
+    piece->raise();
+    cullPiece(piece);
 
-    fragmentPainter.drawPixmap(QPoint(0, 0), m_image, QRect(m_grid->overlayGridPoint(pieceID),puzzlePieceSize));
-    return imageFragment;
+    if (MemoryBudget::tier() == MemoryBudget::Tier::MINIMAL) piece->releaseFragment();
 }
 
 void PuzzleGame::setMenuWidget()
@@ -280,7 +647,9 @@ void PuzzleGame::setMenuWidget()
     m_menuWidget->setGeometry(QRect(QPoint(xPos, yPos), menuSize));
     m_menuWidget->raise();
 
-
+    // 鼠标离开时底边栏滑到窗口下方，只露出一小条
+    QObject::connect(m_menuWidget, &GameMenu::enterMenu, this, &PuzzleGame::enterMenu);
+    QObject::connect(m_menuWidget, &GameMenu::leaveMenu, this, &PuzzleGame::leaveMenu);
 
     QObject::connect(m_menuWidget->newPuzzleButton(), &PuzzleButton::clicked, this, &PuzzleGame::menuNewButtonClicked);
     QObject::connect(m_menuWidget->quitButton(), &PuzzleButton::clicked, this, &PuzzleGame::menuQuitButtonClicked);
@@ -314,22 +683,22 @@ void PuzzleGame::setQuitWidget()
     m_quitWidget = new QWidget(this);
     m_quitWidget->setGeometry(QRect(positionWidget, sizeOuterBoundsBackground));
 
-    QPainterPath backgroundLabelPath = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBoundsBackground), innerBoundsBackground, Jigsaw::TypeOfPiece::TRAPEZOID);
-    PuzzleLabel* backgroundLabel = new PuzzleLabel(sizeOuterBoundsBackground, QBrush(QPixmap(":/backgrounds/back3")), backgroundLabelPath,
+    QPainterPath backgroundLabelPath = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBoundsBackground), innerBoundsBackground, Jigsaw::TypeOfPiece::TRAPEZOID);
+    PuzzleLabel* backgroundLabel = new PuzzleLabel(sizeOuterBoundsBackground, ShapeCache::brush(":/backgrounds/back3"), backgroundLabelPath,
                                                    m_quitWidget, "您确定要退出吗?", innerBoundsBackground);
     backgroundLabel->setAlignment(Qt::AlignTop|Qt::AlignHCenter);
     backgroundLabel->setFont(m_parameters.mainFont);
 
-    QPainterPath backgroundYesButtonPath = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    QPainterPath backgroundNoButtonPath = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+    QPainterPath backgroundYesButtonPath = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 1);
+    QPainterPath backgroundNoButtonPath = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 2);
 
-    PuzzleButton* yesButton = new PuzzleButton(sizeOuterBoundsButtons, QBrush(QPixmap(":/backgrounds/back2")), backgroundYesButtonPath, m_quitWidget, "是");
+    PuzzleButton* yesButton = new PuzzleButton(sizeOuterBoundsButtons, ShapeCache::brush(":/backgrounds/back2"), backgroundYesButtonPath, m_quitWidget, "是");
     yesButton->move(innerBoundsBackground.left() + 10, innerBoundsBackground.bottom() - 10 - yesButton->height());
     yesButton->animate();
     yesButton->setFont(m_parameters.mainFont);
     QObject::connect(yesButton, &PuzzleButton::clicked, this, &PuzzleGame::quitWidgetYesClicked);
 
-    PuzzleButton* noButton = new PuzzleButton(sizeOuterBoundsButtons, QBrush(QPixmap(":/backgrounds/back2")), backgroundNoButtonPath, m_quitWidget, "否");
+    PuzzleButton* noButton = new PuzzleButton(sizeOuterBoundsButtons, ShapeCache::brush(":/backgrounds/back2"), backgroundNoButtonPath, m_quitWidget, "否");
     noButton->move(innerBoundsBackground.right() - 10 - noButton->width(), innerBoundsBackground.bottom() - 10 - noButton->height());
     noButton->animate();
     noButton->setFont(m_parameters.mainFont);
@@ -360,8 +729,8 @@ void PuzzleGame::setNewWidget()
     
     m_newWidget->setGeometry(QRect(QPoint(xPos, yPos), widgetSize));
 
-    QPainterPath backgroundLabelPath = PuzzlePath::singleJigsawPiecePath(m_parameters.rectWidget, m_parameters.rectWidgetArea, Jigsaw::TypeOfPiece::TRAPEZOID);
-    PuzzleLabel* backgroundLabel = new PuzzleLabel(m_parameters.sizeWidget, QBrush(QPixmap(":/backgrounds/back3")), backgroundLabelPath, m_newWidget,
+    QPainterPath backgroundLabelPath = ShapeCache::jigsawPath(m_parameters.rectWidget, m_parameters.rectWidgetArea, Jigsaw::TypeOfPiece::TRAPEZOID);
+    PuzzleLabel* backgroundLabel = new PuzzleLabel(m_parameters.sizeWidget, ShapeCache::brush(":/backgrounds/back3"), backgroundLabelPath, m_newWidget,
                                                    "", m_parameters.rectWidgetArea);
     backgroundLabel->setAlignment(Qt::AlignTop|Qt::AlignHCenter);
     backgroundLabel->setFont(m_parameters.mainFont);
@@ -498,7 +867,7 @@ void PuzzleGame::setNewWidgetPuzzlePieceWidget(QWidget *parent, const Jigsaw::Pa
                 path = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeLabelPuzzlePiece), QRect(), currentType, 4, true, m_customJigsawPath);
             } else {
                 // 对于其他形状，使用默认路径
-                path = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeLabelPuzzlePiece), QRect(), currentType, 4, true);
+                path = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeLabelPuzzlePiece), QRect(), currentType, 4, true);
             }
             labelPuzzlePiece[i]->setJigsawPath(path, sizeLabelPuzzlePiece, QBrush(Qt::lightGray));
             labelPuzzlePiece[i]->animate();
@@ -527,8 +896,10 @@ void PuzzleGame::setNewWidgetPuzzlePieceWidget(QWidget *parent, const Jigsaw::Pa
     m_radioButtonPuzzlePiece.last()->show();
     
     // 恢复自定义形状按钮的连接和设置
-    QObject::connect(labelPuzzlePiece.last(), &PuzzleButton::clicked, m_createOwnShapeWidget, &QWidget::show);
-    QObject::connect(labelPuzzlePiece.last(), &PuzzleButton::clicked, m_createOwnShapeWidget, &QWidget::raise);
+    QObject::connect(labelPuzzlePiece.last(), &PuzzleButton::clicked, this, &PuzzleGame::showCreateOwnShapeWidget);
+    labelPuzzlePiece.last()->setContextMenuPolicy(Qt::CustomContextMenu);
+    labelPuzzlePiece.last()->setToolTip(labelPuzzlePiece.last()->toolTip() + "\n右键: 选择已保存的形状");
+    QObject::connect(labelPuzzlePiece.last(), &PuzzleButton::customContextMenuRequested, this, &PuzzleGame::showSavedShapesMenu);
     QFont font("Georgia", 32, QFont::Bold);
     labelPuzzlePiece.last()->setText("?");
     labelPuzzlePiece.last()->setTextArea(labelPuzzlePiece.last()->rect());
@@ -546,14 +917,22 @@ void PuzzleGame::setNewWidgetNumberOfPiecesWidget(QWidget *parent, const Jigsaw:
 
     m_rotationAllowedCheckBox = new QCheckBox("允许旋转", widgetNumberOfPieces);
     m_rotationAllowedCheckBox->setFont(m_parameters.mainFont);
-    m_rotationAllowedCheckBox->setGeometry(QRect(QPoint(par.minBorderWidth + par.widthWidgetNumberOfPieces / 2, par.minBorderWidth), QSize(par.widthWidgetNumberOfPieces / 2 - par.minBorderWidth * 2, par.heightWidgetNumberOfPieces / 4 - par.minBorderWidth * 2)));
+    m_rotationAllowedCheckBox->setGeometry(QRect(QPoint(par.minBorderWidth + par.widthWidgetNumberOfPieces / 2, par.minBorderWidth), QSize(par.widthWidgetNumberOfPieces / 4 - par.minBorderWidth * 2, par.heightWidgetNumberOfPieces / 4 - par.minBorderWidth * 2)));
 
-    QPainterPath path = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), par.sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+    // 大型拼图模式：1000 - 10000 块，不允许旋转
+    m_largePuzzleCheckBox = new QCheckBox("大型拼图", widgetNumberOfPieces);
+    m_largePuzzleCheckBox->setFont(m_parameters.mainFont);
+    m_largePuzzleCheckBox->setGeometry(QRect(QPoint(par.minBorderWidth + par.widthWidgetNumberOfPieces * 3 / 4, par.minBorderWidth), QSize(par.widthWidgetNumberOfPieces / 4 - par.minBorderWidth * 2, par.heightWidgetNumberOfPieces / 4 - par.minBorderWidth * 2)));
+    m_largePuzzleCheckBox->setToolTip(QString("%1 - %2 块").arg(par.minNumberOfPiecesLargePuzzle).arg(par.maxNumberOfPiecesLargePuzzle));
 
-    m_sliderButton = new PuzzleSlider(par.sizeButtonOuterBounds, QBrush(QPixmap(":/backgrounds/back2")), path, QBrush(QPixmap(":/backgrounds/back1")), widgetNumberOfPieces, 10, 10, 50);
+    QPainterPath path = ShapeCache::jigsawPath(QRect(QPoint(0, 0), par.sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+
+    m_sliderButton = new PuzzleSlider(par.sizeButtonOuterBounds, ShapeCache::brush(":/backgrounds/back2"), path, ShapeCache::brush(":/backgrounds/back1"), widgetNumberOfPieces, 10, 10, par.maxNumberOfPieces);
     m_sliderButton->setGeometry(QRect(QPoint(0, caption->height() + par.minBorderWidth), QSize(par.widthWidgetNumberOfPieces - par.minBorderWidth * 4, par.heightWidgetNumberOfPieces / 8)));
     m_sliderButton->setFont(m_parameters.mainFont);
     m_sliderButton->animate();
+
+    QObject::connect(m_largePuzzleCheckBox, &QCheckBox::toggled, this, &PuzzleGame::newWidgetLargePuzzleToggled);
 }
 
 void PuzzleGame::setNewWidgetButtonsWidget(QWidget *parent, const Jigsaw::Parameters &par)
@@ -563,15 +942,15 @@ void PuzzleGame::setNewWidgetButtonsWidget(QWidget *parent, const Jigsaw::Parame
 
     QSize sizeButtonOuterBounds(120, 120);
 
-    QPainterPath pathOkButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    QPainterPath pathCancelButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+    QPainterPath pathOkButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 1);
+    QPainterPath pathCancelButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeButtonOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 2);
 
-    PuzzleButton* okButton = new PuzzleButton(sizeButtonOuterBounds, QBrush(QPixmap(":/backgrounds/back2")), pathOkButton, widgetButtons, "确定");
+    PuzzleButton* okButton = new PuzzleButton(sizeButtonOuterBounds, ShapeCache::brush(":/backgrounds/back2"), pathOkButton, widgetButtons, "确定");
     okButton->animate();
     okButton->setFont(m_parameters.mainFont);
     okButton->move(par.minBorderWidth, par.minBorderWidth);
 
-    PuzzleButton* cancelButton = new PuzzleButton(sizeButtonOuterBounds, QBrush(QPixmap(":/backgrounds/back2")), pathCancelButton, widgetButtons, "取消");
+    PuzzleButton* cancelButton = new PuzzleButton(sizeButtonOuterBounds, ShapeCache::brush(":/backgrounds/back2"), pathCancelButton, widgetButtons, "取消");
     cancelButton->animate();
     cancelButton->setFont(m_parameters.mainFont);
     cancelButton->move(par.rectWidgetButtons.right() - par.minBorderWidth - cancelButton->width(), par.minBorderWidth);
@@ -582,7 +961,6 @@ void PuzzleGame::setNewWidgetButtonsWidget(QWidget *parent, const Jigsaw::Parame
 
 void PuzzleGame::setWonWidget()
 {
-    m_wonWidget = new QWidget(this);
     QSize sizeOuterBoundsBackground(1000, 600);
     QSize sizeInnerBoundsBackground(sizeOuterBoundsBackground - QSize(400, 400));
     QRect innerBoundsBackground(QPoint(200, 200), sizeInnerBoundsBackground);
@@ -608,13 +986,13 @@ void PuzzleGame::setWonWidget()
     m_wonWidget = new QWidget(this);
     m_wonWidget->setGeometry(QRect(positionWidget, sizeOuterBoundsBackground));
 
-    QPainterPath pathBackgroundLabel = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBoundsBackground), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    PuzzleLabel* backgroundLabel = new PuzzleLabel(sizeOuterBoundsBackground, QBrush(QPixmap(":/backgrounds/back3")), pathBackgroundLabel, m_wonWidget, "恭喜您赢了!!!", innerBoundsBackground);
+    QPainterPath pathBackgroundLabel = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBoundsBackground), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+    PuzzleLabel* backgroundLabel = new PuzzleLabel(sizeOuterBoundsBackground, ShapeCache::brush(":/backgrounds/back3"), pathBackgroundLabel, m_wonWidget, "恭喜您赢了!!!", innerBoundsBackground);
     backgroundLabel->setAlignment(Qt::AlignTop|Qt::AlignHCenter);
     backgroundLabel->setFont(m_parameters.mainFont);
 
-    QPainterPath pathOkButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    PuzzleButton* okButton = new PuzzleButton(sizeOuterBoundsButtons, QBrush(QPixmap(":/backgrounds/back2")), pathOkButton, m_wonWidget, "确定");
+    QPainterPath pathOkButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBoundsButtons), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 3);
+    PuzzleButton* okButton = new PuzzleButton(sizeOuterBoundsButtons, ShapeCache::brush(":/backgrounds/back2"), pathOkButton, m_wonWidget, "确定");
     okButton->move(innerBoundsBackground.center() + QPoint(-okButton->width() / 2, okButton->height() / 2));
     okButton->setFont(m_parameters.mainFont);
     okButton->animate();
@@ -640,6 +1018,14 @@ void PuzzleGame::setWonWidget()
     m_wonWidget->hide();
 }
 
+void PuzzleGame::showWonWidget()
+{
+    // 胜利界面在第一次胜利时才创建
+    if (!m_wonWidget) setWonWidget();
+    m_wonWidget->show();
+    m_wonWidget->raise();
+}
+
 void PuzzleGame::wonGame()
 {
     // 停止游戏计时器
@@ -649,31 +1035,37 @@ void PuzzleGame::wonGame()
     for (const auto &puzzlePiece : m_puzzlePieces) {
         puzzlePiece->hide();
     }
+    for (const auto &sprite : m_mergedPieceSprites) {
+        if (sprite) sprite->hide();
+    }
     
     // 检查背景和文件名是否有效
     if (!m_background || m_filename.isEmpty()) {
         // 如果背景或文件名无效，直接显示胜利界面
-        m_wonWidget->show();
-        m_wonWidget->raise();
+        showWonWidget();
         return;
     }
     
-    // 创建适配屏幕的图片
-    QPixmap originalImage(m_filename);
-    if (originalImage.isNull()) {
+    // 图片金字塔在生成拼图时已经缓存，不需要重新解码原图
+    ImagePyramidCache* pyramidCache = ImagePyramidCache::instance();
+    ImagePyramidPointer pyramid = pyramidCache->find(m_filename);
+    if (!pyramid) {
+        pyramid = ImagePyramid::load(m_filename, pyramidCache->maxSize());
+        pyramidCache->insert(m_filename, pyramid);
+    }
+    if (!pyramid) {
         // 如果图片加载失败，直接显示胜利界面
-        m_wonWidget->show();
-        m_wonWidget->raise();
+        showWonWidget();
         return;
     }
     
     // 计算适合屏幕的图片尺寸，留出更多边距
     QSize screenSize = size();
     QSize maxSize = screenSize * 0.5;  // 使用屏幕尺寸的50%，留出更多边距
-    QPixmap scaledImage = originalImage.scaled(maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QPixmap scaledImage = ImageOps::toPixmap(pyramid->scaled(maxSize, Qt::KeepAspectRatio));
     
     // 调试信息
-    qDebug() << "Original image size:" << originalImage.size();
+    qDebug() << "Original image size:" << pyramid->size();
     qDebug() << "Screen size:" << screenSize;
     qDebug() << "Max size:" << maxSize;
     qDebug() << "Scaled image size:" << scaledImage.size();
@@ -683,11 +1075,9 @@ void PuzzleGame::wonGame()
     
     // 连接信号，添加错误处理
     QObject::connect(effect, &ImageEffects::effectFinished, this, [this](bool successful) {
-        if (m_wonWidget) {
-            m_wonWidget->show();
-            m_wonWidget->raise();
-        }
+        showWonWidget();
     });
+    QObject::connect(effect, &ImageEffects::effectFinished, effect, &QObject::deleteLater);
     
     // 运行效果
     effect->run();
@@ -727,51 +1117,306 @@ void PuzzleGame::setCreateOwnShapeWidget()
     m_createOwnShapeWidget->hide();
 }
 
+void PuzzleGame::showCreateOwnShapeWidget()
+{
+    // PathCreator 控件很多，第一次使用时才创建
+    if (!m_createOwnShapeWidget) setCreateOwnShapeWidget();
+    m_createOwnShapeWidget->show();
+    m_createOwnShapeWidget->raise();
+}
+
 PuzzleGame::PuzzleGame(QWidget *parent)
     : QWidget{parent}
     , m_background(new QLabel(this))
+    , m_boardLayer(new QWidget(this))
+    , m_inputDispatcher(nullptr)
+    , m_piecePool(m_boardLayer)
+    , m_boardView(nullptr)
+    , m_panning(false)
+    , m_boardViewZoomed(false)
+    , m_boardViewAnimation(0)
+    , m_grid(nullptr)
+    , m_setupGeneration(0)
+    , m_setupWorkerFinished(false)
+    , m_setupRestoresGame(false)
+    , m_pendingSetupPiecesIndex(0)
+    , m_setupBatchTimer(nullptr)
+    , m_setupProgressLabel(nullptr)
+    , m_menuWidget(nullptr)
+    , m_menuAnimation(0)
+    , m_menuShown(true)
+    , m_ownImageLabel(nullptr)
+    , m_ownShapeLabel(nullptr)
+    , m_wonWidget(nullptr)
+    , m_createOwnShapeWidget(nullptr)
+    , m_customJigsawPathCreator(nullptr)
     , m_gameTime(0)
     , m_moveCount(0)
     , m_gameStarted(false)
     , m_gameWon(false)
+    , m_renderStatsOverlay(nullptr)
+    , m_saveManager(nullptr)
     , m_randomSeed(static_cast<unsigned int>(QDateTime::currentMSecsSinceEpoch()))
 {
+    m_startupTimer.start();
+
     // 让PuzzleWidget填满整个父窗口
     setGeometry(0, 0, parent->width(), parent->height());
     
     // 背景也填满整个PuzzleWidget
     m_background->setGeometry(0, 0, width(), height());
     m_background->setScaledContents(true);
-    m_background->setPixmap(QPixmap(":/backgrounds/back1"));
+    m_background->setPixmap(ShapeCache::pixmap(":/backgrounds/back1"));
+
+    // 碎片在背景上面，其他控件都在碎片上面。鼠标事件由 PuzzleGame 转发给碎片
+    m_boardLayer->setGeometry(0, 0, width(), height());
+    m_boardLayer->setAttribute(Qt::WA_TransparentForMouseEvents);
+
+    logStartupPhase("背景");
 
     // 初始化统计组件
     setupStatsWidget();
-
-    setCreateOwnShapeWidget();
+    setupProgressLabel();
+    setupRenderStatsOverlay();
+    setupTraceShortcut();
+    setupMemoryBudget();
+    setupImagePyramidCache();
+    setupInputDispatcher();
+    setupBoardView();
+    logStartupPhase("统计");
+
+    // 自定义形状、胜利界面和存档管理器很少用到，第一次使用时才创建
     setMenuWidget();
+    logStartupPhase("菜单");
     setNewWidget();
+    logStartupPhase("新游戏界面");
     setQuitWidget();
-    setWonWidget();
+    logStartupPhase("退出界面");
     setupSaveSystem();
+    logStartupPhase("存档系统");
 }
 
-void PuzzleGame::loadImage(const QPixmap &image)
+void PuzzleGame::logStartupPhase(const char *phase)
 {
-    m_image = image;
+    if (m_startupTimer.isValid()) {
+        qDebug() << "启动阶段:" << phase << m_startupTimer.elapsed() << "ms";
+    }
 }
 
-void PuzzleGame::setupPuzzle()
+void PuzzleGame::paintEvent(QPaintEvent *event)
 {
-    // 设置随机种子，确保形状一致性
-    Jigsaw::setRandomSeed(m_randomSeed);
-    
-    m_grid = new PuzzleGrid(m_rows, m_cols, m_pieceWidth, m_pieceHeight, m_typeOfPiece, this, m_customJigsawPath);
-    setupImage();
-    generatePuzzlePieces();
-    placePuzzlePieces();
-    
-    // 启动游戏计时器
-    startGameTimer();
+    QWidget::paintEvent(event);
+    if (m_startupTimer.isValid()) {
+        logStartupPhase("首次绘制");
+        m_startupTimer.invalidate();
+    }
+}
+
+void PuzzleGame::mousePressEvent(QMouseEvent *event)
+{
+    if (!m_mouseTarget && !m_panning) m_mouseTarget = pieceAt(event->position().toPoint());
+    if (!m_mouseTarget) {
+        if (event->button() == Qt::LeftButton || event->button() == Qt::MiddleButton) {
+            // 在空白处拖动时平移棋盘
+            m_panning = true;
+            m_panPosition = event->position().toPoint();
+            return;
+        }
+        QWidget::mousePressEvent(event);
+        return;
+    }
+    forwardMouseEvent(m_mouseTarget, event);
+}
+
+void PuzzleGame::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_panning) {
+        m_boardView->panBy(event->position().toPoint() - m_panPosition);
+        m_panPosition = event->position().toPoint();
+        return;
+    }
+    if (!m_mouseTarget) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    forwardMouseEvent(m_mouseTarget, event);
+}
+
+void PuzzleGame::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (m_panning) {
+        if (event->buttons() == Qt::NoButton) m_panning = false;
+        return;
+    }
+    if (!m_mouseTarget) {
+        QWidget::mouseReleaseEvent(event);
+        return;
+    }
+    forwardMouseEvent(m_mouseTarget, event);
+    // 所有按键都松开后，下一次点击重新查找碎片
+    if (event->buttons() == Qt::NoButton) m_mouseTarget = nullptr;
+}
+
+void PuzzleGame::wheelEvent(QWheelEvent *event)
+{
+    // 以光标为中心缩放，滚轮每转一格缩放 ZOOMSTEP 倍
+    double steps = event->angleDelta().y() / 120.0;
+    if (steps == 0.0 || m_puzzlePieces.isEmpty() || m_gameWon) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+    m_boardView->zoomAt(event->position(), qPow(BoardView::ZOOMSTEP, steps));
+}
+
+/*
+ * Applies a change of the BoardView. A pan only scrolls the board layer, which moves the widgets of all pieces and
+ * groups at once, their sprites and transforms stay the same. Pans by a fraction of a pixel and zooms place every piece
+ * and group again. Both is done by updateBoardView() in the next frame of the AnimationScheduler, so any number of
+ * changes within a frame cost one update.
+ */
+
+void PuzzleGame::boardViewChanged(bool zoomChanged)
+{
+    QPointF distance = m_boardView->pan() - m_scrolledPan;
+    if (zoomChanged || QPointF(distance.toPoint()) != distance) {
+        m_boardViewZoomed = true;
+    }
+    else if (!m_boardViewZoomed) {
+        // 所有控件按整数像素平移，放置的结果和重新计算的一样
+        m_boardLayer->scroll(distance.toPoint().x(), distance.toPoint().y());
+        m_scrolledPan = m_boardView->pan();
+    }
+
+    if (AnimationScheduler::instance()->isRunning(m_boardViewAnimation)) return;
+    m_boardViewAnimation = AnimationScheduler::instance()->onFrame(this, [this]() {
+        updateBoardView();
+        return false;
+    });
+}
+
+/*
+ * Shows the pieces and groups in the viewport and hides the others. After a zoom all of them are placed again, the
+ * hidden ones first, so they are not drawn again at the new zoom before they are shown.
+ */
+
+void PuzzleGame::updateBoardView()
+{
+    TraceSpan span("PuzzleGame::updateBoardView");
+    m_boardViewAnimation = 0;
+    updateCulling();
+    if (!m_boardViewZoomed) return;
+
+    m_boardViewZoomed = false;
+    m_scrolledPan = m_boardView->pan();
+    for (auto piece : m_puzzlePieces) {
+        piece->updateView();
+    }
+    for (auto sprite : m_mergedPieceSprites) {
+        if (sprite) sprite->updateView();
+    }
+}
+
+bool PuzzleGame::isInViewport(const QRectF &boardRect) const
+{
+    return m_boardView->mapToScreen(boardRect).intersects(QRectF(rect()));
+}
+
+void PuzzleGame::updateCulling()
+{
+    // 胜利后碎片一直隐藏
+    if (m_gameWon) return;
+    for (auto piece : m_puzzlePieces) {
+        cullPiece(piece);
+    }
+    for (auto sprite : m_mergedPieceSprites) {
+        if (sprite) sprite->setVisible(isInViewport(sprite->boundingBoardRect()));
+    }
+}
+
+void PuzzleGame::cullPiece(PuzzlePiece *piece)
+{
+    // 拼成一张图的合并组中的碎片由 MergedPieceSprite 显示
+    int mergedPieceID;
+    if (m_gameWon || (isPartOfMergedPiece(piece, mergedPieceID) && m_mergedPieceSprites[mergedPieceID])) return;
+    piece->setVisible(isInViewport(piece->spriteRect()));
+}
+
+void PuzzleGame::cullMergedPiece(int mergedPieceID)
+{
+    if (m_gameWon) return;
+    MergedPieceSprite* sprite = m_mergedPieceSprites[mergedPieceID];
+    if (sprite) {
+        sprite->setVisible(isInViewport(sprite->boundingBoardRect()));
+        return;
+    }
+    for (const auto &piece : m_mergedPieces[mergedPieceID]) {
+        cullPiece(piece);
+    }
+}
+
+/*
+ * Zooms out until all pieces and the board they were scattered on fit into the window, e.g. after a large puzzle was
+ * set up. If they already fit, the view isn't changed.
+ */
+
+void PuzzleGame::fitPiecesIntoView()
+{
+    QRectF bounds;
+    for (auto piece : m_puzzlePieces) {
+        bounds |= piece->spriteRect();
+    }
+    if (m_grid && !m_puzzlePieces.isEmpty()) {
+        QRect screen(0, 0, m_parameters.screenWidth, m_parameters.screenHeight);
+        bounds |= PieceScatter::boardFor(m_puzzlePieces.size(), m_grid->pieceTotalSize(), screen, m_parameters.rectFreeArea);
+    }
+    if (bounds.isEmpty() || QRectF(rect()).contains(m_boardView->mapToScreen(bounds))) return;
+    m_boardView->fit(bounds, rect());
+}
+
+/*
+ * Returns the topmost visible piece whose shape contains pos (in coordinates of the board). The children of the board
+ * layer are stacked in the order of children(), so they are searched from the back. The layer always covers the whole
+ * board widget, so its coordinates are the same. Pieces whose bounding rectangle doesn't contain pos
+ * are skipped before their HitMask is looked at. The pieces of a flattened group are hidden, if pos hits the
+ * MergedPieceSprite of the group, the piece under pos is looked up in the group.
+ */
+
+PuzzlePiece *PuzzleGame::pieceAt(const QPoint &pos) const
+{
+    const QObjectList &objects = m_boardLayer->children();
+    for (int i = objects.size() - 1; i >= 0; --i) {
+        MergedPieceSprite* sprite = qobject_cast<MergedPieceSprite*>(objects[i]);
+        if (sprite) {
+            if (!sprite->isVisible() || !sprite->geometry().contains(pos)) continue;
+            if (sprite->hitTest(pos - sprite->pos())) return sprite->pieceAt(pos);
+            continue;
+        }
+        PuzzlePiece* piece = qobject_cast<PuzzlePiece*>(objects[i]);
+        if (!piece || !piece->isVisible() || !piece->geometry().contains(pos)) continue;
+        if (piece->hitTest(pos - piece->pos())) return piece;
+    }
+    return nullptr;
+}
+
+void PuzzleGame::forwardMouseEvent(PuzzlePiece *piece, QMouseEvent *event)
+{
+    QMouseEvent pieceEvent(event->type(), piece->mapFrom(this, event->position()), event->scenePosition(),
+                           event->globalPosition(), event->button(), event->buttons(), event->modifiers(),
+                           event->pointingDevice());
+    QCoreApplication::sendEvent(piece, &pieceEvent);
+    event->setAccepted(pieceEvent.isAccepted());
+}
+
+PuzzleGame::~PuzzleGame()
+{
+    // 等待后台生成线程结束，避免线程在窗口销毁后继续运行
+    if (m_setupCancelled) m_setupCancelled->store(true);
+    if (m_setupThread) m_cancelledSetupThreads.append(m_setupThread);
+    for (const auto &thread : m_cancelledSetupThreads) {
+        if (!thread) continue;
+        thread->quit();
+        thread->wait();
+    }
 }
 
 void PuzzleGame::menuNewButtonClicked()
@@ -788,36 +1433,34 @@ void PuzzleGame::menuQuitButtonClicked()
 
 void PuzzleGame::enterMenu()
 {
-    if (m_menuWidget->pos().y() > 960) {  // 如果菜单在屏幕下方（隐藏状态）
-        m_moveMenuOutTimer->stop();
-        m_moveMenuInTimer->start(10);
-    }
+    slideMenu(true);
 }
 
 void PuzzleGame::leaveMenu()
 {
-    if (m_menuWidget->pos().y() < 1080) {  // 如果菜单在屏幕上方（显示状态）
-        m_moveMenuOutTimer->start(10);
-        m_moveMenuInTimer->stop();
-    }
+    slideMenu(false);
 }
 
-void PuzzleGame::moveMenuInTimerTimeout()
+int PuzzleGame::menuPosition(bool shown) const
 {
-    if (m_menuWidget->pos().y() <= 960) {  // 移动到屏幕底部显示位置
-        m_moveMenuInTimer->stop();
-        return;
-    }
-    m_menuWidget->move(m_menuWidget->pos() + QPoint(0, -2));  // 向上移动
+    return shown ? height() - m_menuWidget->height() : height() - m_parameters.menuPeekHeight;
 }
 
-void PuzzleGame::moveMenuOutTimerTimeout()
+void PuzzleGame::slideMenu(bool shown)
 {
-    if (m_menuWidget->pos().y() >= 1080) {  // 移动到屏幕下方隐藏位置
-        m_moveMenuOutTimer->stop();
-        return;
-    }
-    m_menuWidget->move(m_menuWidget->pos() + QPoint(0, 2));  // 向下移动
+    if (shown == m_menuShown) return;
+    m_menuShown = shown;
+    AnimationScheduler::instance()->stop(m_menuAnimation);
+
+    // 动画时间与剩余距离成正比，中途反向时速度不变
+    int from = m_menuWidget->y();
+    int to = menuPosition(shown);
+    int distance = qMax(1, m_menuWidget->height() - m_parameters.menuPeekHeight);
+    int duration = m_parameters.menuSlideMSecs * qAbs(to - from) / distance;
+
+    m_menuAnimation = AnimationScheduler::instance()->animate(m_menuWidget, from, to, duration, [this](double y) {
+        m_menuWidget->move(m_menuWidget->x(), qRound(y));
+    }, AnimationScheduler::Easing::OUTCUBIC);
 }
 
 void PuzzleGame::quitWidgetYesClicked()
@@ -828,73 +1471,137 @@ void PuzzleGame::quitWidgetYesClicked()
 void PuzzleGame::newWidgetOkClicked()
 {
     if (!m_radioButtonEx.last()->isChecked()) {
-        QPixmap image;
         for (int i = 0; i < m_radioButtonEx.size(); ++i) {
             if (m_radioButtonEx[i]->isChecked()) {
-                image = QPixmap(":/examples/ex" + QString::number(i));
                 m_filename = ":/examples/ex" + QString::number(i); // 设置文件名
             }
         }
-        loadImage(image);
     }
-    else {
-        loadImage(QPixmap(m_filename));
+
+    // 只读取图片尺寸，图片本身在后台线程中解码
+    QSize imageSize = QImageReader(m_filename).size();
+    if (!imageSize.isValid()) imageSize = QImage(m_filename).size();
+    if (imageSize.isEmpty()) {
+        qDebug() << "无法读取图片:" << m_filename;
+        return;
     }
 
     for (int i = 0; i < m_radioButtonPuzzlePiece.size(); ++i) {
         if (m_radioButtonPuzzlePiece[i]->isChecked()) m_typeOfPiece = PuzzlePath::intToTypeOfPiece(i);
     }
 
-    qDeleteAll(m_puzzlePieces);
-    m_puzzlePieces.clear();
-    m_mergedPieces.clear();
+    cancelPuzzleSetup();
+    stopGameTimer();
+    clearPuzzle();
 
     // 重置游戏统计信息
     resetGameStats();
 
-    calculateRowsAndCols(m_sliderButton->val(), m_image);
-    m_rotationAllowed = m_rotationAllowedCheckBox->isChecked();
+    calculateRowsAndCols(m_sliderButton->val(), imageSize);
+    m_rotationAllowed = m_rotationAllowedCheckBox->isChecked() && !isLargePuzzle();
 
-    setupPuzzle();
+    startPuzzleSetup(true);
     m_newWidget->lower();
     m_newWidget->hide();
 
-    m_background->setPixmap(QPixmap(":/backgrounds/back1"));
+    m_background->setPixmap(ShapeCache::pixmap(":/backgrounds/back1"));
+
+    // 碎片在背景上面，其他控件都在碎片上面。鼠标事件由 PuzzleGame 转发给碎片
+    m_boardLayer->setGeometry(0, 0, width(), height());
+    m_boardLayer->setAttribute(Qt::WA_TransparentForMouseEvents);
 }
 
 void PuzzleGame::newWidgetOwnImageClicked()
 {
     QString fileName = QFileDialog::getOpenFileName(this, "打开图片", m_filename.isEmpty() ? "C:/": m_filename.section('/', 0, -2), "图片文件 (*.png *.jpg *.bmp)");
-    if (!fileName.isEmpty() && fileName != "" && !QPixmap(fileName).isNull()) {
+    // 只检查文件头，图片在后台线程中解码，完成后显示预览
+    if (!fileName.isEmpty() && QImageReader(fileName).canRead()) {
         m_filename = fileName;
         m_radioButtonEx.last()->setCheckable(true);
-        QPixmap preview(fileName);
-        preview = preview.scaled(QSize(m_ownImageLabel->width(), m_ownImageLabel->height()));
-        m_ownImageLabel->setPixmap(preview);
-        m_ownImageLabel->setText("");
-        loadImage(QPixmap(fileName));
+        if (ImagePyramidCache::instance()->request(fileName)) showOwnImagePreview(fileName);
     }
 }
 
+void PuzzleGame::showOwnImagePreview(const QString &filename)
+{
+    if (!m_ownImageLabel || filename != m_filename) return;
+
+    ImagePyramidPointer pyramid = ImagePyramidCache::instance()->find(filename);
+    if (!pyramid) {
+        qDebug() << "无法读取图片:" << filename;
+        return;
+    }
+    m_ownImageLabel->setPixmap(ImageOps::toPixmap(pyramid->scaled(m_ownImageLabel->size())));
+    m_ownImageLabel->setText("");
+}
+
+void PuzzleGame::newWidgetLargePuzzleToggled(bool checked)
+{
+    // 先放宽范围再收紧，避免最小值暂时大于最大值
+    if (checked) {
+        m_sliderButton->setMaxVal(m_parameters.maxNumberOfPiecesLargePuzzle);
+        m_sliderButton->setMinVal(m_parameters.minNumberOfPiecesLargePuzzle);
+    }
+    else {
+        m_sliderButton->setMinVal(10);
+        m_sliderButton->setMaxVal(m_parameters.maxNumberOfPieces);
+    }
+    m_sliderButton->setVal(m_sliderButton->val());
+
+    if (checked) m_rotationAllowedCheckBox->setChecked(false);
+    m_rotationAllowedCheckBox->setEnabled(!checked);
+}
+
 void PuzzleGame::customJigsawPathCreatorApplyClicked(const CustomPuzzlePath &customJigsawPath)
+{
+    setCustomJigsawPath(customJigsawPath);
+    m_createOwnShapeWidget->hide();
+}
+
+void PuzzleGame::showSavedShapesMenu(const QPoint &position)
+{
+    // 形状库在这里才读取，菜单只列出名称，选中的形状才读取文件
+    QStringList names = ShapeLibrary::instance()->shapeNames();
+    QMenu menu(this);
+    if (names.isEmpty()) menu.addAction("没有保存的形状")->setEnabled(false);
+    for (const auto &name : names) {
+        menu.addAction(name)->setData(name);
+    }
+
+    QAction* action = menu.exec(m_ownShapeLabel->mapToGlobal(position));
+    if (action == nullptr || !action->data().isValid()) return;
+
+    CustomPuzzlePath customJigsawPath;
+    if (!ShapeLibrary::instance()->loadShape(action->data().toString(), customJigsawPath)) return;
+    setCustomJigsawPath(customJigsawPath);
+    m_radioButtonPuzzlePiece.last()->setChecked(true);
+}
+
+void PuzzleGame::setCustomJigsawPath(const CustomPuzzlePath &customJigsawPath)
 {
     m_customJigsawPath = customJigsawPath;
 
-    // 更新自定义形状按钮的显示
+    // 更新自定义形状按钮的显示，保存的形状带有计算好的内边界
     QPainterPath customPath = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), m_ownShapeLabel->size()), QRect(QPoint(0, 0),
-                                                                m_ownShapeLabel->size() / 2), Jigsaw::TypeOfPiece::CUSTOM, 4, false, customJigsawPath);
+                                                                m_ownShapeLabel->size() / 2), Jigsaw::TypeOfPiece::CUSTOM, 4, true, customJigsawPath);
     m_ownShapeLabel->setJigsawPath(customPath, m_ownShapeLabel->size());
-
-    m_createOwnShapeWidget->hide();
 }
 
 void PuzzleGame::dragMergedPieces(int id, const QPointF &draggedBy)
 {
     int mergedPieceID;
     if (isPartOfMergedPiece(m_puzzlePieces[id], mergedPieceID)) {
-        for (const auto &piece : m_mergedPieces[mergedPieceID]) {
-            if (piece != m_puzzlePieces[id]) piece->move(piece->originalPosition() + draggedBy);
+        MergedPieceSprite* sprite = m_mergedPieceSprites[mergedPieceID];
+        if (sprite) {
+            // 拼成一张图的组只移动图片，放下时碎片再一起跟上
+            sprite->follow(m_puzzlePieces[id]);
         }
+        else {
+            for (const auto &piece : m_mergedPieces[mergedPieceID]) {
+                if (piece != m_puzzlePieces[id]) piece->move(piece->originalPosition() + draggedBy);
+            }
+        }
+        cullMergedPiece(mergedPieceID);
     }
 }
 
@@ -902,6 +1609,7 @@ void PuzzleGame::rotateMergedPieces(int id, int angle, const QPointF &rotatingPo
 {
     int mergedPieceID;
     if (isPartOfMergedPiece(m_puzzlePieces[id], mergedPieceID)) {
+        syncMergedPiece(mergedPieceID);
         for (const auto &piece : m_mergedPieces[mergedPieceID]) {
             if (piece != m_puzzlePieces[id]) {
                 QPoint pieceGridPoint = m_grid->overlayGridPoint(id);
@@ -910,6 +1618,8 @@ void PuzzleGame::rotateMergedPieces(int id, int angle, const QPointF &rotatingPo
                 piece->rotateAroundPoint(angle, rotatingPoint, line.length(), line.angle());
             }
         }
+        if (m_mergedPieceSprites[mergedPieceID]) m_mergedPieceSprites[mergedPieceID]->rotate(angle, rotatingPoint);
+        cullMergedPiece(mergedPieceID);
     }
 }
 
@@ -920,6 +1630,7 @@ void PuzzleGame::raisePieces(int id)
         for (const auto &piece : m_mergedPieces[mergedPieceID]) {
             piece->raise();
         }
+        if (m_mergedPieceSprites[mergedPieceID]) m_mergedPieceSprites[mergedPieceID]->raise();
     }
     else {
         m_puzzlePieces[id]->raise();
@@ -934,12 +1645,16 @@ void PuzzleGame::resizeEvent(QResizeEvent *event)
     if (m_background) {
         m_background->setGeometry(0, 0, width(), height());
     }
+    if (m_boardLayer) {
+        m_boardLayer->setGeometry(0, 0, width(), height());
+    }
     
     // 调整底边栏位置
     if (m_menuWidget) {
         QSize menuSize = m_menuWidget->size();
         int xPos = (width() - menuSize.width()) / 2;  // 水平居中
-        int yPos = height() - menuSize.height();       // 底部
+        int yPos = menuPosition(m_menuShown);       // 底部
+        AnimationScheduler::instance()->stop(m_menuAnimation);
         m_menuWidget->setGeometry(QRect(QPoint(xPos, yPos), menuSize));
     }
     
@@ -947,6 +1662,14 @@ void PuzzleGame::resizeEvent(QResizeEvent *event)
     if (m_statsWidget) {
         m_statsWidget->setGeometry(10, 10, 200, 80);
     }
+    
+    // 调整生成进度提示位置
+    if (m_setupProgressLabel) {
+        m_setupProgressLabel->setGeometry((width() - 400) / 2, 10, 400, 40);
+    }
+
+    // 视口变了，重新决定哪些碎片显示
+    if (m_boardView) updateCulling();
 }
 
 void PuzzleGame::setupStatsWidget()
@@ -1016,6 +1739,10 @@ void PuzzleGame::resetGameStats()
 void PuzzleGame::setupSaveSystem()
 {
     m_saveSystem = new SaveSystem(this);
+}
+
+void PuzzleGame::setSaveManager()
+{
     m_saveManager = new SaveManager(this);
     
     // 连接存档管理器的信号
@@ -1080,6 +1807,11 @@ GameSaveData PuzzleGame::createCurrentGameData()
     data.moveCount = m_moveCount;
     data.gameStarted = m_gameStarted;
     data.randomSeed = m_randomSeed;
+
+    // 正被拖动的合并组中的碎片还没有跟上
+    for (int mergedPieceID = 0; mergedPieceID < m_mergedPieces.size(); ++mergedPieceID) {
+        syncMergedPiece(mergedPieceID);
+    }
     
     // 保存所有碎片的状态
     for (PuzzlePiece* piece : m_puzzlePieces) {
@@ -1126,19 +1858,11 @@ GameSaveData PuzzleGame::createCurrentGameData()
 void PuzzleGame::loadGameFromData(const GameSaveData& gameData)
 {
     // 停止当前游戏
+    cancelPuzzleSetup();
     stopGameTimer();
     
     // 清理当前游戏状态
-    for (PuzzlePiece* piece : m_puzzlePieces) {
-        piece->deleteLater();
-    }
-    m_puzzlePieces.clear();
-    m_mergedPieces.clear();
-    
-    if (m_grid) {
-        m_grid->deleteLater();
-        m_grid = nullptr;
-    }
+    clearPuzzle();
     
     // 设置游戏参数
     m_rows = gameData.rows;
@@ -1152,100 +1876,59 @@ void PuzzleGame::loadGameFromData(const GameSaveData& gameData)
     m_filename = gameData.imagePath;
     m_randomSeed = gameData.randomSeed;
     
-    // 加载图片
-    if (!m_filename.isEmpty()) {
-        QPixmap image(m_filename);
-        if (!image.isNull()) {
-            loadImage(image);
-        } else {
-            // 如果无法加载图片，尝试从资源加载示例图片
-            QPixmap fallbackImage(":/examples/ex0");
-            if (!fallbackImage.isNull()) {
-                loadImage(fallbackImage);
-            }
-        }
-    } else {
-        // 如果没有图片文件，尝试从资源加载示例图片
-        QPixmap image(":/examples/ex0");
-        if (!image.isNull()) {
-            loadImage(image);
-        }
-    }
-    
-    // 重新创建拼图
-    if (!m_image.isNull()) {
-        // 设置随机种子，确保形状一致性
-        Jigsaw::setRandomSeed(m_randomSeed);
-        
-        // 创建网格和图片，但不放置碎片
-        m_grid = new PuzzleGrid(m_rows, m_cols, m_pieceWidth, m_pieceHeight, m_typeOfPiece, this, m_customJigsawPath);
-        setupImage();
-        generatePuzzlePieces();
-    } else {
-        // 如果图片加载失败，尝试使用默认图片重新创建拼图
+    // 碎片尺寸由图片尺寸和行列数决定，图片本身在后台线程中加载
+    QSize imageSize = QImageReader(m_filename).size();
+    if (!imageSize.isValid()) {
+        // 如果无法读取图片，使用示例图片的尺寸（后台线程也会加载示例图片）
         qDebug() << "图片加载失败，尝试使用默认图片重新创建拼图";
-        QPixmap defaultImage(":/examples/ex0");
-        if (!defaultImage.isNull()) {
-            loadImage(defaultImage);
-            // 设置随机种子，确保形状一致性
-            Jigsaw::setRandomSeed(m_randomSeed);
-            
-            m_grid = new PuzzleGrid(m_rows, m_cols, m_pieceWidth, m_pieceHeight, m_typeOfPiece, this, m_customJigsawPath);
-            setupImage();
-            generatePuzzlePieces();
-        } else {
-            qDebug() << "无法加载默认图片，拼图创建失败";
-            return;
-        }
+        imageSize = QImageReader(":/examples/ex0").size();
     }
-    
-    // 恢复碎片状态（不调用placePuzzlePieces）
-    for (const PuzzlePieceSaveData& pieceData : gameData.pieces) {
-        if (pieceData.id < m_puzzlePieces.size()) {
-            PuzzlePiece* piece = m_puzzlePieces[pieceData.id];
-            piece->move(pieceData.position);
-            piece->setAngle(pieceData.angle);
-            piece->show();
-            piece->raise();
-            // 注意：isFixed 状态会在 fixPieceIfPossible 中自动处理
-        }
-    }
-    
-    // 确保所有碎片都可见
-    for (PuzzlePiece* piece : m_puzzlePieces) {
-        piece->show();
-        piece->raise();
+    if (!imageSize.isValid() || m_rows < 1 || m_cols < 1) {
+        qDebug() << "无法加载默认图片，拼图创建失败";
+        return;
     }
+    QSize actualImageSize = imageSize.scaled(QSize(m_parameters.screenWidth * 2 / 3, m_parameters.screenHeight * 4 / 5), Qt::KeepAspectRatio);
+    m_pieceWidth = actualImageSize.width() / m_cols;
+    m_pieceHeight = actualImageSize.height() / m_rows;
     
-    // 如果没有碎片数据，使用默认位置
-    if (gameData.pieces.isEmpty()) {
-        for (int i = 0; i < m_puzzlePieces.size(); ++i) {
-            PuzzlePiece* piece = m_puzzlePieces[i];
-            piece->move(100.0 + i * 10.0, 100.0 + i * 10.0);
-            piece->setAngle(0);
-            piece->show();
-            piece->raise();
-        }
+    // 碎片会在生成时直接放到存档中的位置（不调用随机放置）
+    m_pendingGameData = gameData;
+    m_pendingPieceData.clear();
+    for (const PuzzlePieceSaveData& pieceData : gameData.pieces) {
+        m_pendingPieceData.insert(pieceData.id, pieceData);
     }
     
+    startPuzzleSetup(false);
+}
+
+void PuzzleGame::restoreGameState(const GameSaveData& gameData)
+{
     // 恢复合并的碎片组（将ID转换回PuzzlePiece*）
+    qDeleteAll(m_mergedPieceSprites);
+    m_mergedPieceSprites.clear();
+    m_mergedPieceFrontiers.clear();
     m_mergedPieces.clear();
+    m_mergedPieceIDs.fill(-1);
     for (const QVector<int>& groupIds : gameData.mergedPieces) {
         QVector<PuzzlePiece*> group;
         for (int id : groupIds) {
-            if (id < m_puzzlePieces.size()) {
+            if (id >= 0 && id < m_puzzlePieces.size() && m_mergedPieceIDs[id] < 0) {
                 group.append(m_puzzlePieces[id]);
+                m_mergedPieceIDs[id] = m_mergedPieces.size();
             }
         }
         if (!group.isEmpty()) {
             m_mergedPieces.append(group);
+            m_mergedPieceSprites.append(nullptr);
+            m_mergedPieceFrontiers.append(QSet<int>());
+            updateMergedPieceSprite(m_mergedPieces.size() - 1, group);
         }
     }
-    
-    // 如果没有合并组数据，保持空
-    if (gameData.mergedPieces.isEmpty()) {
-        // 保持空，表示没有合并的碎片
+    // 所有组都恢复以后才能判断碎片是否在边缘上
+    for (int id = 0; id < m_mergedPieceIDs.size(); ++id) {
+        if (m_mergedPieceIDs[id] >= 0) updateFrontier(m_mergedPieceIDs[id], id);
     }
+    updateCulling();
     
     // 更新显示
     updateTimeDisplay();
@@ -1256,8 +1939,7 @@ void PuzzleGame::loadGameFromData(const GameSaveData& gameData)
         startGameTimer();
     } else if (m_mergedPieces.size() == 1 && m_mergedPieces[0].size() == m_numberOfPieces) {
         // 如果游戏已完成，显示胜利界面
-        m_wonWidget->show();
-        m_wonWidget->raise();
+        showWonWidget();
     } else {
         // 如果游戏未开始，不启动计时器
         stopGameTimer();
@@ -1266,6 +1948,9 @@ void PuzzleGame::loadGameFromData(const GameSaveData& gameData)
 
 void PuzzleGame::showSaveManager()
 {
+    // 存档管理器在第一次打开时才创建
+    if (!m_saveManager) setSaveManager();
+
     // 设置当前游戏数据
     GameSaveData currentData = createCurrentGameData();
     m_saveManager->setCurrentGameData(currentData);
@@ -5,19 +5,32 @@
 #include "ui/game_menu.h"
 #include "components/puzzle_path.h"
 #include "puzzle_grid.h"
+#include "puzzle_setup_worker.h"
+#include "board_input_dispatcher.h"
+#include "board_view.h"
 #include "ui/puzzle_label.h"
 #include "components/puzzle_piece.h"
+#include "components/piece_pool.h"
+#include "components/merged_piece_sprite.h"
 #include "ui/puzzle_button.h"
 #include "ui/puzzle_slider.h"
 #include "tools/image_effects.h"
 #include "save_system.h"
+#include "memory_budget.h"
 #include "ui/save_manager.h"
+#include "ui/render_stats_overlay.h"
 #include <QRadioButton>
 #include <QCheckBox>
 #include <QWidget>
 #include <QTimer>
 #include <QPainterPath>
 #include <QLabel>
+#include <QPointer>
+#include <QList>
+#include <QThread>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
 
 class PuzzleGame : public QWidget
 {
@@ -25,30 +38,70 @@ class PuzzleGame : public QWidget
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
 
 private:
     QLabel* m_background;
+    QWidget* m_boardLayer;  // 所有碎片和合并组的父控件，平移时整体滚动
     QVector<PuzzlePiece*> m_puzzlePieces;
 
+    // 碎片不接收鼠标事件，由棋盘找到光标下的碎片后转发
+    QPointer<PuzzlePiece> m_mouseTarget;
+    BoardInputDispatcher* m_inputDispatcher;
+    PiecePool m_piecePool;  // 上一局的碎片，开始新的一局时重用
+    PuzzlePiece* pieceAt(const QPoint &pos) const;
+    void forwardMouseEvent(PuzzlePiece* piece, QMouseEvent* event);
+
+    // 棋盘可以缩放和平移，只有和视口相交的碎片和合并组才显示，隐藏的碎片不绘制
+    BoardView* m_boardView;
+    bool m_panning;
+    QPoint m_panPosition;
+    QPointF m_scrolledPan;       // 棋盘层上的控件目前按这个平移放置
+    bool m_boardViewZoomed;      // 下一帧要重新放置所有碎片和合并组
+    int m_boardViewAnimation;    // 下一帧更新视图的动画，0 表示没有
+    void updateBoardView();
+    bool isInViewport(const QRectF &boardRect) const;
+    void updateCulling();
+    void cullPiece(PuzzlePiece* piece);
+    void cullMergedPiece(int mergedPieceID);
+    void fitPiecesIntoView();
+
     QVector<QVector<PuzzlePiece*>> m_mergedPieces;
+    QVector<int> m_mergedPieceIDs;  // 每个碎片所在的合并组，-1 表示未合并
+
+    // 与 m_mergedPieces 一一对应，碎片数达到 MINPIECESTOFLATTEN 的合并组拼成一张图显示，其他的为 nullptr
+    static constexpr int MINPIECESTOFLATTEN = 16;
+    QVector<MergedPieceSprite*> m_mergedPieceSprites;
+    void updateMergedPieceSprite(int mergedPieceID, const QVector<PuzzlePiece*> &addedPieces);
+
+    // 与 m_mergedPieces 一一对应，组内至少有一个邻居不在组里的碎片，放下时只检查它们
+    QVector<QSet<int>> m_mergedPieceFrontiers;
+    QVector<int> neighborIDs(int id) const;
+    bool isOnFrontier(int id) const;
+    void updateFrontier(int mergedPieceID, int id);
+    void snapMergedPiece(int mergedPieceID);
+    void checkIfGameWon(PuzzlePiece* piece);
 
     void createNewMergedPiece(PuzzlePiece* firstPiece);
     void addPuzzlePieceToMergedPiece(PuzzlePiece* piece, int mergedPieceID);
     void combineTwoMergedPieces(int firstMergedPieceID, int secondMergedPieceID);
     bool isPartOfMergedPiece(PuzzlePiece* piece, int &mergedPieceID);
-    bool areMerged(PuzzlePiece* first, PuzzlePiece* second);
+    void syncMergedPiece(int mergedPieceID);
 
     bool isInCorrectPosition(PuzzlePiece* piece, PuzzlePiece *neighbor, int tolerance = 5);
-    void repositionPiece(PuzzlePiece* piece, PuzzlePiece* neighbor);
+    QPointF snapOffset(PuzzlePiece* piece, PuzzlePiece* neighbor) const;
 
     int m_numberOfPieces;
     bool m_rotationAllowed;
 
-    void calculateRowsAndCols(int numberOfPieces, const QPixmap &image);
+    void calculateRowsAndCols(int numberOfPieces, const QSize &imageSize);
 
     int m_rows;
     int m_cols;
-    QPixmap m_image;
     Jigsaw::TypeOfPiece m_typeOfPiece;
     CustomPuzzlePath m_customJigsawPath;
     unsigned int m_randomSeed;  // 随机种子，用于确保形状一致性
@@ -57,13 +110,39 @@ private:
     int m_pieceHeight;
 
     PuzzleGrid *m_grid;
-
-    void setupImage();
-
-    void generatePuzzlePieces();
-    void placePuzzlePieces();
-
-    QPixmap createImageFragment(int pieceID);
+    ImagePyramidPointer m_fragmentLevels;  // 缩小时绘制碎片用的整张图片的各层，所有碎片共用
+
+    // 后台生成拼图（解码 → 网格 → 边缘 → 碎片图像 → 界面上的碎片）
+
+    quint64 m_setupGeneration;  // 每次开始、取消或完成生成时加一，过滤已取消的工作线程的信号
+    QPointer<QThread> m_setupThread;
+    QList<QPointer<QThread>> m_cancelledSetupThreads;  // 已取消但可能还在运行，析构时等待它们结束
+    std::shared_ptr<std::atomic_bool> m_setupCancelled;
+    bool m_setupWorkerFinished;
+    bool m_setupRestoresGame;
+    QVector<PuzzleSetupPiece> m_pendingSetupPieces;
+    int m_pendingSetupPiecesIndex;
+    QTimer* m_setupBatchTimer;
+    QLabel* m_setupProgressLabel;
+    GameSaveData m_pendingGameData;
+    QHash<int, PuzzlePieceSaveData> m_pendingPieceData;
+    QElapsedTimer m_setupElapsedTimer;
+
+    // 启动计时，第一次绘制后失效
+    QElapsedTimer m_startupTimer;
+
+    void logStartupPhase(const char* phase);
+
+    bool isLargePuzzle() const;
+
+    void setupProgressLabel();
+    void updateSetupProgress(PuzzleSetupWorker::Stage stage, int percent);
+    void startPuzzleSetup(bool placePieces);
+    void cancelPuzzleSetup();
+    void finishPuzzleSetup();
+    void clearPuzzle();
+    void createPuzzlePiece(const PuzzleSetupPiece &pieceData);
+    void restoreGameState(const GameSaveData& gameData);
 
     //Menu Widgets
 
@@ -73,8 +152,11 @@ private:
 
     void setMenuWidget();
 
-    QTimer* m_moveMenuInTimer;
-    QTimer* m_moveMenuOutTimer;
+    int m_menuAnimation;
+    bool m_menuShown;
+
+    int menuPosition(bool shown) const;
+    void slideMenu(bool shown);
 
     QWidget* m_quitWidget;
 
@@ -85,6 +167,7 @@ private:
     QVector<QRadioButton*> m_radioButtonEx;
     QVector<QRadioButton*> m_radioButtonPuzzlePiece;
     QCheckBox* m_rotationAllowedCheckBox;
+    QCheckBox* m_largePuzzleCheckBox;
     PuzzleButton* m_ownImageLabel;
     PuzzleButton* m_ownShapeLabel;
     QString m_filename;
@@ -99,15 +182,15 @@ private:
     QWidget* m_wonWidget;
 
     void setWonWidget();
+    void showWonWidget();
     void wonGame();
 
     QWidget* m_createOwnShapeWidget;
     PathCreator* m_customJigsawPathCreator;
 
     void setCreateOwnShapeWidget();
-
-    void loadImage(const QPixmap &image);
-    void setupPuzzle();
+    void showCreateOwnShapeWidget();
+    void setCustomJigsawPath(const CustomPuzzlePath &customJigsawPath);
 
     // 计时和计步相关
     QWidget* m_statsWidget;
@@ -118,8 +201,16 @@ private:
     int m_moveCount;
     bool m_gameStarted;  // 游戏是否已经开始
     bool m_gameWon;      // 游戏是否已经胜利
+    RenderStatsOverlay* m_renderStatsOverlay;  // F3 或环境变量 JIGSAW_RENDER_STATS
     
     void setupStatsWidget();
+    void setupRenderStatsOverlay();
+    void setupTraceShortcut();  // F4 开始/停止记录跟踪
+    void setupMemoryBudget();
+    void applyMemoryTier(MemoryBudget::Tier tier);
+    void setupImagePyramidCache();
+    void setupInputDispatcher();
+    void setupBoardView();
     void updateTimeDisplay();
     void updateMovesDisplay();
     void startGameTimer();
@@ -131,12 +222,14 @@ private:
     SaveManager* m_saveManager;
     
     void setupSaveSystem();
+    void setSaveManager();
     GameSaveData createCurrentGameData();
     void loadGameFromData(const GameSaveData& gameData);
     void showSaveManager();
 
 public:
     explicit PuzzleGame(QWidget *parent = nullptr);
+    ~PuzzleGame();
 
 private slots:
     void menuNewButtonClicked();
@@ -144,13 +237,14 @@ private slots:
 
     void enterMenu();
     void leaveMenu();
-    void moveMenuInTimerTimeout();
-    void moveMenuOutTimerTimeout();
 
     void quitWidgetYesClicked();
     void newWidgetOkClicked();
     void newWidgetOwnImageClicked();
+    void showOwnImagePreview(const QString &filename);
+    void newWidgetLargePuzzleToggled(bool checked);
     void customJigsawPathCreatorApplyClicked(const CustomPuzzlePath &customJigsawPath);
+    void showSavedShapesMenu(const QPoint &position);
 
     void dragMergedPieces(int id, const QPointF &draggedBy);
     void rotateMergedPieces(int id, int angle, const QPointF &rotatingPoint);
@@ -158,6 +252,9 @@ private slots:
     void fixPieceIfPossible(int id);
     void fixMergedPieceIfPossible(int id);
 
+    void createPendingPuzzlePieces();
+    void boardViewChanged(bool zoomChanged);
+
 signals:
 
 };
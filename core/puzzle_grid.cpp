@@ -1,7 +1,9 @@
 #include "puzzle_grid.h"
+#include "trace.h"
 #include "qdebug.h"
 #include "qpainter.h"
 #include "qpen.h"
+#include <QtMath>
 #include <random>
 
 int PuzzleGrid::currentRow(int pointID) const
@@ -148,6 +150,7 @@ QSize PuzzleGrid::pieceTotalSize() const
 
 void PuzzleGrid::createGrids()
 {
+    TraceSpan span("PuzzleGrid::createGrids");
     createSymmetricGrid();
     createOverlayGrid();
     createPuzzlePiecesGrid();
@@ -265,8 +268,9 @@ QRect PuzzleGrid::puzzlePieceBounds(int pieceID)
     return QRect(0, 0, 0, 0);
 }
 
-void PuzzleGrid::createGridPaths(Jigsaw::TypeOfPiece typeOfPiece)
+bool PuzzleGrid::createGridPaths(Jigsaw::TypeOfPiece typeOfPiece, const std::atomic_bool *cancelled)
 {
+    TraceSpan span("PuzzleGrid::createGridPaths");
     QPoint start, end;
     QRect boundsCompletePuzzle (QPoint(0, 0), QSize(m_puzzleTotalWidth, m_puzzleTotalHeight));
     QRect boundsFirstPiece;
@@ -275,9 +279,12 @@ void PuzzleGrid::createGridPaths(Jigsaw::TypeOfPiece typeOfPiece)
     Jigsaw::TypeOfPiece type;
     bool hasCollision;
     int emergencyCounter;
+    int finishedPaths = 0;
+    int totalPaths = (m_rows * (m_cols - 1)) + ((m_rows - 1) * m_cols);
 
     for (unsigned int i = 0; i < m_horizontalGridPaths.size(); ++i) {
         if (isOnRightBorder(i)) continue;
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) return false;
 
         start = m_puzzlePiecesGrid[i];
         end = m_puzzlePiecesGrid[i + 1];
@@ -288,10 +295,12 @@ void PuzzleGrid::createGridPaths(Jigsaw::TypeOfPiece typeOfPiece)
         type = (isOnTopBorder(i) || isOnBottomBorder(i)) ? Jigsaw::TypeOfPiece::TRAPEZOID : typeOfPiece;
 
         m_horizontalGridPaths[i] = PuzzlePath(start, end, boundsForPath, type, m_customPath).path();
+        emit pathsProgress(++finishedPaths, totalPaths);
     }
 
     for (unsigned int j = 0; j < m_verticalGridPaths.size(); ++j) {
         if (isOnBottomBorder(j)) continue;
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) return false;
 
         emergencyCounter = 0;
 
@@ -321,20 +330,23 @@ void PuzzleGrid::createGridPaths(Jigsaw::TypeOfPiece typeOfPiece)
 
             if (hasCollision) ++emergencyCounter;
         }
-        while (hasCollision && emergencyCounter <= 20);
+        while (hasCollision && emergencyCounter <= m_maxCollisionAttempts);
 
-        if (emergencyCounter >= 20) {
+        if (emergencyCounter >= m_maxCollisionAttempts) {
             //qDebug() << "Could not solve intersection from vertical grid path" << j << "from" << start << "to" << end;
             m_verticalGridPaths[j] = PuzzlePath(start, end, boundsForPath, Jigsaw::TypeOfPiece::SIMPLEARC).path();
         }
 //        else {
 //            qDebug() << "Intersection solved at attemp" << emergencyCounter;
 //        }
+        emit pathsProgress(++finishedPaths, totalPaths);
     }
+    return true;
 }
 
 void PuzzleGrid::createCombinedPaths()
 {
+    TraceSpan span("PuzzleGrid::createCombinedPaths");
     for (int i = 0; i < m_combinedPaths.size(); ++i) {
         m_combinedPaths[i] = combinePath(i);
     }
@@ -380,7 +392,79 @@ void PuzzleGrid::debugGrid()
     }
 }
 
-PuzzleGrid::PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth, int puzzlePiecesHeight, Jigsaw::TypeOfPiece typeOfPiece, QObject *parent, const CustomPuzzlePath &customPath)
+void PuzzleGrid::calculateRowsAndCols(int numberOfPieces, double imageRatio, int &rows, int &cols)
+{
+    rows = 1;
+    cols = 1;
+    if (numberOfPieces <= 1 || imageRatio <= 0.0) return;
+
+    // 从理想的行数向两边搜索，剩下的行数不可能更好时停止。行数多于碎片数时不会更好
+    int idealRows = qBound(1, qFloor(qSqrt(numberOfPieces / imageRatio)), numberOfPieces);
+    double bestCost = -1.0;
+    for (int direction : {-1, 1}) {
+        int firstRows = direction < 0 ? idealRows : idealRows + 1;
+        for (int r = firstRows; r >= 1 && r <= numberOfPieces; r += direction) {
+            if (bestCost >= 0.0 && minimumCostForRows(numberOfPieces, imageRatio, r) > bestCost) break;
+            int c = bestColsForRows(numberOfPieces, imageRatio, r);
+            double cost = rowsAndColsCost(numberOfPieces, imageRatio, r, c);
+            if (bestCost < 0.0 || cost < bestCost) {
+                bestCost = cost;
+                rows = r;
+                cols = c;
+            }
+        }
+    }
+}
+
+double PuzzleGrid::rowsAndColsCost(int numberOfPieces, double imageRatio, int rows, int cols)
+{
+    double numberOfPiecesError = qAbs(rows * cols - numberOfPieces) / double(numberOfPieces);
+    double pieceRatioError = qAbs(qLn(imageRatio * rows / cols));
+    return WEIGHTNUMBEROFPIECESERROR * numberOfPiecesError + WEIGHTPIECERATIOERROR * pieceRatioError;
+}
+
+/*
+ * Returns a lower bound of the cost of any grid with the given number of rows. Let d be the log of the ratio between
+ * the columns for square pieces (imageRatio * rows) and the columns for the exact number of pieces (numberOfPieces /
+ * rows). Any number of columns is at least |d| / 2 away from one of them on a log scale, which costs at least
+ * 1 - e^(-|d| / 2) in the number of pieces or |d| / 2 in the piece ratio. |d| grows the further rows is from
+ * sqrt(numberOfPieces / imageRatio), so the bound does too.
+ */
+
+double PuzzleGrid::minimumCostForRows(int numberOfPieces, double imageRatio, int rows)
+{
+    double d = qAbs(qLn(imageRatio * rows * rows / numberOfPieces));
+    return qMin(WEIGHTNUMBEROFPIECESERROR * (1.0 - qExp(-d / 2.0)), WEIGHTPIECERATIOERROR * d / 2.0);
+}
+
+/*
+ * Returns the best number of columns for the given number of rows. Between the columns for the exact number of pieces
+ * and the columns for square pieces, the cost is either concave or convex with its minimum where both errors change
+ * equally fast. Outside of them it is monotonic. So the best number of columns is next to one of these three points.
+ */
+
+int PuzzleGrid::bestColsForRows(int numberOfPieces, double imageRatio, int rows)
+{
+    double exactCols = double(numberOfPieces) / rows;
+    double squareCols = imageRatio * rows;
+    double balancedCols = WEIGHTPIECERATIOERROR * numberOfPieces / (WEIGHTNUMBEROFPIECESERROR * rows);
+    int candidateCols[7] = { qFloor(exactCols), qCeil(exactCols), qFloor(squareCols), qCeil(squareCols),
+                             qFloor(balancedCols), qCeil(balancedCols), 1 };
+
+    int bestCols = 1;
+    double bestCost = -1.0;
+    for (int c : candidateCols) {
+        if (c < 1) c = 1;
+        double cost = rowsAndColsCost(numberOfPieces, imageRatio, rows, c);
+        if (bestCost < 0.0 || cost < bestCost) {
+            bestCost = cost;
+            bestCols = c;
+        }
+    }
+    return bestCols;
+}
+
+PuzzleGrid::PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth, int puzzlePiecesHeight, Jigsaw::TypeOfPiece typeOfPiece, QObject *parent, const CustomPuzzlePath &customPath, bool createPathsImmediately)
     : QObject{parent}
     , m_rows(rowsOfPieces + 1)
     , m_cols(colsOfPieces + 1)
@@ -400,6 +484,8 @@ PuzzleGrid::PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth
     , m_puzzlePieceBounds(m_numberOfPieces)
     , m_horizontalGridPaths(m_numberOfGridPoints)
     , m_verticalGridPaths(m_numberOfGridPoints)
+    , m_pathsCreated(false)
+    , m_maxCollisionAttempts(20)
     , m_combinedPaths(m_numberOfPieces)
 {
     calculateHorizontalOverlap();
@@ -409,8 +495,7 @@ PuzzleGrid::PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth
 
     createGrids();
     createPuzzlePieceBounds();
-    createGridPaths(m_typeOfPiece);
-    createCombinedPaths();
+    if (createPathsImmediately) createPaths();
 
     //debugGrid();
 }
@@ -420,6 +505,30 @@ PuzzleGrid::~PuzzleGrid()
 
 }
 
+bool PuzzleGrid::createPaths(const std::atomic_bool *cancelled)
+{
+    if (m_pathsCreated) return true;
+    if (!createGridPaths(m_typeOfPiece, cancelled)) return false;
+    createCombinedPaths();
+    m_pathsCreated = true;
+    return true;
+}
+
+bool PuzzleGrid::pathsCreated() const
+{
+    return m_pathsCreated;
+}
+
+void PuzzleGrid::setMaxCollisionAttempts(int maxCollisionAttempts)
+{
+    m_maxCollisionAttempts = maxCollisionAttempts;
+}
+
+int PuzzleGrid::numberOfPieces() const
+{
+    return m_numberOfPieces;
+}
+
 QPoint PuzzleGrid::symmetricGridPoint(int pieceID, Jigsaw::Direction direction) const
 {
     unsigned int index1 = pieceID + (pieceID / (m_cols - 1));
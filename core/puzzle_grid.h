@@ -7,7 +7,7 @@
 #include <QObject>
 #include <QPoint>
 #include <QRect>
-
+#include <atomic>
 
 
 /*
@@ -16,12 +16,31 @@
  * than the image width divided by the number of pieces in one row or column. Otherwise the image fragment would be
  * cut of at the edges. To achieve this, the class calculates a grid with some overlay. Inside this overlay, a grid
  * point is chosen randomly. After that, all JigsawPaths are calculated.
+ *
+ * Calculating the JigsawPaths is by far the most expensive step. If the grid is created on a worker thread, the paths
+ * can be deferred (createPathsImmediately = false) and calculated afterwards with createPaths(), which reports its
+ * progress via pathsProgress() and stops early if the given cancel flag is set.
+ *
+ * The static function calculateRowsAndCols() finds the number of rows and columns for a given number of pieces and
+ * image ratio (width / height). Each grid is rated by the relative error of the number of pieces and by how far the
+ * pieces are from being square (log of the piece ratio, so 2:1 and 1:2 are rated the same). For a number of rows, the
+ * best number of columns is one of a few candidates next to the points where the rating changes its slope. The rows
+ * are searched outwards from sqrt(numberOfPieces / imageRatio), until a lower bound of the rating for the remaining
+ * rows is worse than the best grid found. Usually only a handful of rows are looked at, no matter how many pieces
+ * are requested. rowsAndColsCost() is the rating, PuzzleGridTest in tests/ compares the result with an exhaustive
+ * search.
  */
 
 class PuzzleGrid : public QObject
 {
     Q_OBJECT
 private:
+    static constexpr double WEIGHTNUMBEROFPIECESERROR = 1.0;
+    static constexpr double WEIGHTPIECERATIOERROR = 0.5;
+
+    static double minimumCostForRows(int numberOfPieces, double imageRatio, int rows);
+    static int bestColsForRows(int numberOfPieces, double imageRatio, int rows);
+
     int m_rows;
     int m_cols;
     int m_numberOfGridPoints;
@@ -78,7 +97,10 @@ private:
     QVector<QPainterPath> m_horizontalGridPaths;
     QVector<QPainterPath> m_verticalGridPaths;
 
-    void createGridPaths(Jigsaw::TypeOfPiece typeOfPiece);
+    bool m_pathsCreated;
+    int m_maxCollisionAttempts;
+
+    bool createGridPaths(Jigsaw::TypeOfPiece typeOfPiece, const std::atomic_bool *cancelled);
     QVector<QPainterPath> m_combinedPaths;
 
     void createCombinedPaths();
@@ -87,9 +109,17 @@ private:
     void debugGrid();
 
 public:
-    explicit PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth, int puzzlePiecesHeight, Jigsaw::TypeOfPiece typeOfPiece, QObject *parent = nullptr, const CustomPuzzlePath &customPath = CustomPuzzlePath());
+    static void calculateRowsAndCols(int numberOfPieces, double imageRatio, int &rows, int &cols);
+    static double rowsAndColsCost(int numberOfPieces, double imageRatio, int rows, int cols);
+
+    explicit PuzzleGrid(int rowsOfPieces, int colsOfPieces, int puzzlePiecesWidth, int puzzlePiecesHeight, Jigsaw::TypeOfPiece typeOfPiece, QObject *parent = nullptr, const CustomPuzzlePath &customPath = CustomPuzzlePath(), bool createPathsImmediately = true);
     ~PuzzleGrid();
 
+    bool createPaths(const std::atomic_bool *cancelled = nullptr);
+    bool pathsCreated() const;
+    void setMaxCollisionAttempts(int maxCollisionAttempts);
+    int numberOfPieces() const;
+
     QPoint symmetricGridPoint(int pieceID, Jigsaw::Direction direction = Jigsaw::Direction::TOPLEFT) const;
     QPoint overlayGridPoint(int pieceID, Jigsaw::Direction direction = Jigsaw::Direction::TOPLEFT) const;
     QPoint puzzlePieceGridPoint(int pieceID, Jigsaw::Direction direction = Jigsaw::Direction::TOPLEFT) const;
@@ -104,7 +134,7 @@ public:
     const QPainterPath &puzzlePath(int pieceID) const;
 
 signals:
-
+    void pathsProgress(int finishedPaths, int totalPaths);
 };
 
 #endif // PUZZLE_GRID_H
@@ -0,0 +1,194 @@
+#include "puzzle_setup_worker.h"
+#include "trace.h"
+#include "tools/image_ops.h"
+#include "tools/piece_scatter.h"
+#include "qdebug.h"
+#include <QPainter>
+
+PuzzleSetupWorker::PuzzleSetupWorker(const Settings &settings, QObject *parent)
+    : QObject{parent}
+    , m_settings(settings)
+    , m_cancelled(std::make_shared<std::atomic_bool>(false))
+    , m_targetThread(QThread::currentThread())
+    , m_stage(Stage::DECODE)
+    , m_percent(-1)
+    , m_overlayImageMemory(MemoryBudget::Category::SOURCEIMAGE)
+{
+
+}
+
+std::shared_ptr<std::atomic_bool> PuzzleSetupWorker::cancelFlag() const
+{
+    return m_cancelled;
+}
+
+QString PuzzleSetupWorker::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::DECODE:
+        return "读取图片";
+    case Stage::GRID:
+        return "生成网格";
+    case Stage::EDGES:
+        return "生成边缘";
+    case Stage::FRAGMENTS:
+        return "切割图片";
+    case Stage::SPRITES:
+        return "放置碎片";
+    default:
+        return "";
+    }
+}
+
+bool PuzzleSetupWorker::isCancelled() const
+{
+    return m_cancelled->load(std::memory_order_relaxed);
+}
+
+void PuzzleSetupWorker::setProgress(Stage stage, int finished, int total)
+{
+    int percent = total > 0 ? finished * 100 / total : 100;
+    if (stage == m_stage && percent == m_percent) return;
+    m_stage = stage;
+    m_percent = percent;
+    emit progressChanged(stage, percent);
+}
+
+ImagePyramidPointer PuzzleSetupWorker::loadPyramid()
+{
+    TraceSpan span("PuzzleSetupWorker::loadPyramid");
+    if (m_settings.pyramid) return m_settings.pyramid;
+
+    ImagePyramidPointer pyramid = ImagePyramid::load(m_settings.filename, m_settings.maxImageSize);
+    if (pyramid) {
+        emit pyramidReady(m_settings.filename, pyramid);
+        return pyramid;
+    }
+    qDebug() << "图片加载失败，使用默认图片:" << m_settings.filename;
+    return ImagePyramid::load(m_settings.fallbackFilename, m_settings.maxImageSize);
+}
+
+PuzzleGrid *PuzzleSetupWorker::createGrid()
+{
+    TraceSpan span("PuzzleSetupWorker::createGrid");
+    PuzzleGrid* grid = new PuzzleGrid(m_settings.rows, m_settings.cols, m_settings.pieceWidth, m_settings.pieceHeight,
+                                      m_settings.typeOfPiece, nullptr, m_settings.customPath, false);
+    grid->setMaxCollisionAttempts(m_settings.maxCollisionAttempts);
+    return grid;
+}
+
+bool PuzzleSetupWorker::createEdges(PuzzleGrid *grid)
+{
+    TraceSpan span("PuzzleSetupWorker::createEdges");
+    QObject::connect(grid, &PuzzleGrid::pathsProgress, this, [this](int finishedPaths, int totalPaths) {
+        setProgress(Stage::EDGES, finishedPaths, totalPaths);
+    });
+    bool successful = grid->createPaths(m_cancelled.get());
+    QObject::disconnect(grid, &PuzzleGrid::pathsProgress, this, nullptr);
+    return successful;
+}
+
+void PuzzleSetupWorker::createOverlayImage(const ImagePyramid &pyramid, PuzzleGrid *grid)
+{
+    TraceSpan span("PuzzleSetupWorker::createOverlayImage");
+    QSize scaledImageSize(m_settings.cols * m_settings.pieceWidth + 1, m_settings.rows * m_settings.pieceHeight + 1);
+
+    m_overlayImage = QImage(grid->puzzleTotalSize(), ImageOps::FORMAT);
+    m_overlayImage.fill(Qt::transparent);
+
+    QPainter painter(&m_overlayImage);
+    painter.drawImage(grid->symmetricGridPoint(0), pyramid.scaled(scaledImageSize));
+    painter.end();
+    m_overlayImageMemory.set(MemoryBudget::imageBytes(m_overlayImage));
+    // 缩小的碎片直接从这些层中取，第 0 层是一半大小的图片，完整大小的已经在碎片里了
+    m_fragmentLevels = std::make_shared<ImagePyramid>(m_overlayImage.scaled(m_overlayImage.size() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+
+    int numberOfPieces = grid->numberOfPieces();
+    m_pieceTotalSize = grid->pieceTotalSize();
+    m_paths.resize(numberOfPieces);
+    m_overlayGridPoints.resize(numberOfPieces);
+    for (int i = 0; i < numberOfPieces; ++i) {
+        m_paths[i] = grid->puzzlePath(i);
+        m_overlayGridPoints[i] = grid->overlayGridPoint(i);
+    }
+}
+
+bool PuzzleSetupWorker::createFragments()
+{
+    TraceSpan span("PuzzleSetupWorker::createFragments");
+    int numberOfPieces = m_paths.size();
+    QVector<int> angles(numberOfPieces, 0);
+    QVector<QPointF> positions(numberOfPieces);
+
+    if (m_settings.rotationAllowed) {
+        for (int i = 0; i < numberOfPieces; ++i) {
+            angles[i] = Jigsaw::randomNumber(0, 35) * 10;
+        }
+    }
+
+    if (m_settings.placePieces) {
+        // 大型拼图放不下时棋盘比屏幕大，生成后缩小视图显示整个棋盘
+        QRect board = PieceScatter::boardFor(numberOfPieces, m_pieceTotalSize, QRect(QPoint(0, 0), m_settings.boardSize), m_settings.freeArea);
+        positions = PieceScatter::scatter(numberOfPieces, m_pieceTotalSize, board, m_settings.freeArea);
+    }
+
+    QVector<PuzzleSetupPiece> batch;
+    batch.reserve(PIECESPERBATCH);
+
+    for (int i = 0; i < numberOfPieces; ++i) {
+        if (isCancelled()) return false;
+
+        PuzzleSetupPiece piece;
+        piece.id = i;
+        piece.fragment = m_overlayImage.copy(QRect(m_overlayGridPoints[i], m_pieceTotalSize));
+        piece.path = m_paths[i];
+        piece.angle = angles[i];
+        piece.position = positions[i];
+        batch.push_back(piece);
+
+        if (batch.size() == PIECESPERBATCH || i == numberOfPieces - 1) {
+            emit piecesReady(batch);
+            batch.clear();
+        }
+        setProgress(Stage::FRAGMENTS, i + 1, numberOfPieces);
+    }
+    return true;
+}
+
+void PuzzleSetupWorker::run()
+{
+    TraceSpan span("PuzzleSetupWorker::run");
+    // 在工作线程中设置随机种子，确保形状一致性
+    Jigsaw::setRandomSeed(m_settings.randomSeed);
+
+    setProgress(Stage::DECODE, 0, 1);
+    ImagePyramidPointer pyramid = loadPyramid();
+    if (!pyramid || isCancelled()) {
+        emit finished(false);
+        return;
+    }
+    setProgress(Stage::DECODE, 1, 1);
+
+    setProgress(Stage::GRID, 0, 1);
+    PuzzleGrid* grid = createGrid();
+    setProgress(Stage::GRID, 1, 1);
+
+    if (isCancelled() || !createEdges(grid)) {
+        delete grid;
+        emit finished(false);
+        return;
+    }
+
+    createOverlayImage(*pyramid, grid);
+    pyramid.reset();
+
+    grid->moveToThread(m_targetThread);
+    emit gridReady(grid);
+    emit fragmentLevelsReady(m_fragmentLevels);
+    m_fragmentLevels.reset();
+
+    bool successful = createFragments();
+    m_overlayImage = QImage();
+    m_overlayImageMemory.set(0);
+    emit finished(successful);
+}
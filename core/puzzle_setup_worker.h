@@ -0,0 +1,138 @@
+#ifndef PUZZLE_SETUP_WORKER_H
+#define PUZZLE_SETUP_WORKER_H
+
+#include "jigsaw_types.h"
+#include "puzzle_grid.h"
+#include "memory_budget.h"
+#include "components/custom_puzzle_path.h"
+#include "tools/image_pyramid.h"
+#include <QObject>
+#include <QThread>
+#include <QImage>
+#include <QPainterPath>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+/*
+ * Everything a PuzzlePiece needs to be put onto the board. The image fragment is a QImage, because QPixmaps must not be
+ * used outside of the GUI thread. It is converted when the PuzzlePiece is created.
+ */
+
+struct PuzzleSetupPiece
+{
+    int id = 0;
+    QImage fragment;
+    QPainterPath path;
+    int angle = 0;
+    QPointF position;
+};
+
+/*
+ * The PuzzleSetupWorker creates a new jigsaw puzzle off the GUI thread. It is moved to a QThread and run() is called
+ * when the thread is started. The setup is done in stages:
+ *
+ * DECODE     The ImagePyramid of the image is loaded, unless the cached one was passed in the settings. A newly loaded
+ *            pyramid is handed to the GUI thread with pyramidReady(), so it can be cached and reused, e.g. for the
+ *            image shown after the puzzle is solved.
+ * GRID       The PuzzleGrid is created without its JigsawPaths.
+ * EDGES      The JigsawPaths are calculated. This is the expensive part for big puzzles.
+ * FRAGMENTS  The image is scaled to the size of the puzzle from the pyramid and cut into fragments, which are sent to
+ *            the GUI thread in small batches via piecesReady(). Before that, the scaled image is halved once more and
+ *            the ImagePyramid of the half image is sent with fragmentLevelsReady(). The pieces are drawn from its
+ *            levels when the board is zoomed out.
+ * SPRITES    The PuzzlePieces are created on the GUI thread. This stage is handled by the receiver, the worker only
+ *            defines it, so all stages can be reported the same way.
+ *
+ * The random generator is seeded on the worker thread before the grid is created and angles and positions are drawn
+ * in the same order as before, so a puzzle created with the same seed always looks the same. The positions are spread
+ * around the free area by PieceScatter, which always finishes in time linear in the number of pieces. boardSize is the
+ * size of the screen, the pieces of a large puzzle are scattered on a board around it that is large enough for all of
+ * them, see PieceScatter::boardFor().
+ *
+ * The grid is handed over with gridReady() as soon as its paths exist. It is moved to the thread of the receiver and
+ * has no parent, so the receiver takes ownership. After that the worker doesn't touch the grid anymore.
+ *
+ * The worker deletes itself when its thread has finished, so other objects must not keep a pointer to it, not even to
+ * identify the sender, since a new worker may get the same address. To cancel the setup, keep the flag returned by cancelFlag() and set it from any thread.
+ * The worker stops at the next checkpoint and emits finished(false).
+ */
+
+class PuzzleSetupWorker : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Stage {
+        DECODE,
+        GRID,
+        EDGES,
+        FRAGMENTS,
+        SPRITES
+    };
+    Q_ENUM(Stage)
+
+    struct Settings {
+        QString filename;
+        QString fallbackFilename = ":/examples/ex0";
+        ImagePyramidPointer pyramid;
+        QSize maxImageSize;
+        int rows = 1;
+        int cols = 1;
+        int pieceWidth = 1;
+        int pieceHeight = 1;
+        Jigsaw::TypeOfPiece typeOfPiece = Jigsaw::TypeOfPiece::TRAPEZOID;
+        CustomPuzzlePath customPath;
+        unsigned int randomSeed = 0;
+        bool rotationAllowed = false;
+        int maxCollisionAttempts = 20;
+        bool placePieces = true;
+        QSize boardSize = QSize(1920, 1080);
+        QRect freeArea;
+    };
+
+    explicit PuzzleSetupWorker(const Settings &settings, QObject *parent = nullptr);
+
+    std::shared_ptr<std::atomic_bool> cancelFlag() const;
+
+    static QString stageName(Stage stage);
+
+private:
+    static constexpr int PIECESPERBATCH = 16;
+
+    Settings m_settings;
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    QThread* m_targetThread;
+    Stage m_stage;
+    int m_percent;
+
+    QImage m_overlayImage;
+    MemoryUsage m_overlayImageMemory;
+    ImagePyramidPointer m_fragmentLevels;
+    QVector<QPainterPath> m_paths;
+    QVector<QPoint> m_overlayGridPoints;
+    QSize m_pieceTotalSize;
+
+    bool isCancelled() const;
+    void setProgress(Stage stage, int finished, int total);
+
+    ImagePyramidPointer loadPyramid();
+    PuzzleGrid* createGrid();
+    bool createEdges(PuzzleGrid* grid);
+    void createOverlayImage(const ImagePyramid &pyramid, PuzzleGrid* grid);
+    bool createFragments();
+
+public slots:
+    void run();
+
+signals:
+    void progressChanged(PuzzleSetupWorker::Stage stage, int percent);
+    void pyramidReady(const QString &filename, ImagePyramidPointer pyramid);
+    void gridReady(PuzzleGrid* grid);
+    void fragmentLevelsReady(ImagePyramidPointer levels);
+    void piecesReady(const QVector<PuzzleSetupPiece> &pieces);
+    void finished(bool successful);
+};
+
+Q_DECLARE_METATYPE(PuzzleSetupPiece)
+
+#endif // PUZZLE_SETUP_WORKER_H
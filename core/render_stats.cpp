@@ -0,0 +1,71 @@
+#include "render_stats.h"
+#include <algorithm>
+
+std::atomic<qint64> RenderStats::s_redraws{0};
+std::atomic<qint64> RenderStats::s_setMasks{0};
+std::atomic<qint64> RenderStats::s_conversions[NUMBEROFCONVERSIONS] = {};
+qint64 RenderStats::s_conversionsTotal[NUMBEROFCONVERSIONS] = {};
+QVector<qint64> RenderStats::s_frameNSecs;
+int RenderStats::s_nextFrame = 0;
+QElapsedTimer RenderStats::s_interval;
+
+void RenderStats::countRedraw()
+{
+    s_redraws.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RenderStats::countSetMask()
+{
+    s_setMasks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RenderStats::countConversion(Conversion conversion)
+{
+    s_conversions[static_cast<int>(conversion)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RenderStats::recordFrame(qint64 nsecs)
+{
+    if (s_frameNSecs.size() < FRAMESAMPLES) {
+        s_frameNSecs.push_back(nsecs);
+    }
+    else {
+        s_frameNSecs[s_nextFrame] = nsecs;
+    }
+    s_nextFrame = (s_nextFrame + 1) % FRAMESAMPLES;
+}
+
+RenderStats::Snapshot RenderStats::takeSnapshot()
+{
+    Snapshot snapshot;
+
+    double seconds = s_interval.isValid() ? s_interval.restart() / 1000.0 : 0.0;
+    if (!s_interval.isValid()) s_interval.start();
+    qint64 redraws = s_redraws.exchange(0, std::memory_order_relaxed);
+    qint64 setMasks = s_setMasks.exchange(0, std::memory_order_relaxed);
+    if (seconds > 0.0) {
+        snapshot.redrawsPerSecond = redraws / seconds;
+        snapshot.setMasksPerSecond = setMasks / seconds;
+    }
+    for (int i = 0; i < NUMBEROFCONVERSIONS; ++i) {
+        qint64 conversions = s_conversions[i].exchange(0, std::memory_order_relaxed);
+        s_conversionsTotal[i] += conversions;
+        snapshot.conversions[i] = s_conversionsTotal[i];
+        if (seconds > 0.0) snapshot.conversionsPerSecond[i] = conversions / seconds;
+    }
+
+    QVector<qint64> frames = s_frameNSecs;
+    snapshot.frames = frames.size();
+    if (!frames.isEmpty()) {
+        std::sort(frames.begin(), frames.end());
+        auto percentile = [&frames](double p) {
+            int index = qMin(frames.size() - 1, static_cast<int>(p * frames.size()));
+            return frames[index] / 1000000.0;
+        };
+        snapshot.frameMSecsP50 = percentile(0.50);
+        snapshot.frameMSecsP90 = percentile(0.90);
+        snapshot.frameMSecsP99 = percentile(0.99);
+    }
+    return snapshot;
+}
+
@@ -0,0 +1,67 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <QVector>
+#include <QElapsedTimer>
+#include <atomic>
+
+/*
+ * RenderStats collects a few cheap counters about the cost of drawing the board. They are always compiled in, counting
+ * is a single relaxed atomic increment. The counters are read by the RenderStatsOverlay, which is hidden by default.
+ *
+ * countRedraw()       a PuzzleLabel or PuzzlePiece was redrawn into a new pixmap
+ * countSetMask()      the mask of a widget was recalculated
+ * countConversion()   an image was converted into another format, a pixmap read back into an image or an image
+ *                     turned into a pixmap (see ImageOps). While pieces are only dragged and rotated, there should
+ *                     be none, the ImagePipelineBenchmark checks that.
+ * recordFrame()       time needed to paint one frame of the main window. Only the last FRAMESAMPLES frames are kept.
+ *
+ * The memory held by pixmaps, masks and paths is counted by the MemoryBudget.
+ *
+ * takeSnapshot() returns the rates since the last snapshot, the number of conversions since the start and the frame
+ * time percentiles of the kept frames. Frames and snapshots must only be used from the GUI thread.
+ */
+
+class RenderStats
+{
+public:
+    enum class Conversion {
+        FORMAT,
+        PIXMAPTOIMAGE,
+        IMAGETOPIXMAP
+    };
+    static constexpr int NUMBEROFCONVERSIONS = 3;
+
+    struct Snapshot {
+        double redrawsPerSecond = 0.0;
+        double setMasksPerSecond = 0.0;
+        double conversionsPerSecond[NUMBEROFCONVERSIONS] = {};
+        qint64 conversions[NUMBEROFCONVERSIONS] = {};
+        int frames = 0;
+        double frameMSecsP50 = 0.0;
+        double frameMSecsP90 = 0.0;
+        double frameMSecsP99 = 0.0;
+    };
+
+    static void countRedraw();
+    static void countSetMask();
+    static void countConversion(Conversion conversion);
+    static void recordFrame(qint64 nsecs);
+
+    static Snapshot takeSnapshot();
+
+private:
+    RenderStats() = delete;
+
+    static constexpr int FRAMESAMPLES = 240;
+
+    static std::atomic<qint64> s_redraws;
+    static std::atomic<qint64> s_setMasks;
+    static std::atomic<qint64> s_conversions[NUMBEROFCONVERSIONS];
+    static qint64 s_conversionsTotal[NUMBEROFCONVERSIONS];
+    static QVector<qint64> s_frameNSecs;
+    static int s_nextFrame;
+    static QElapsedTimer s_interval;
+};
+
+#endif // RENDER_STATS_H
@@ -1,4 +1,6 @@
 #include "save_system.h"
+#include "trace.h"
+#include "memory_budget.h"
 #include "jigsaw_types.h"
 #include <QStandardPaths>
 #include <QDir>
@@ -119,6 +121,7 @@ SaveSystem::SaveSystem(QObject *parent)
 
 bool SaveSystem::saveGame(const GameSaveData& gameData, const QString& saveName)
 {
+    TraceSpan span("SaveSystem::saveGame");
     try {
         if (!ensureSaveDirectory()) {
             qDebug() << "无法创建保存目录";
@@ -142,6 +145,8 @@ bool SaveSystem::saveGame(const GameSaveData& gameData, const QString& saveName)
         }
         
         QByteArray jsonData = doc.toJson();
+        MemoryUsage bufferMemory(MemoryBudget::Category::SAVEBUFFERS);
+        bufferMemory.set(jsonData.size());
         qint64 bytesWritten = file.write(jsonData);
         file.close();
         
@@ -164,6 +169,7 @@ bool SaveSystem::saveGame(const GameSaveData& gameData, const QString& saveName)
 
 GameSaveData SaveSystem::loadGame(const QString& saveName)
 {
+    TraceSpan span("SaveSystem::loadGame");
     GameSaveData emptyData;
     
     try {
@@ -184,6 +190,8 @@ GameSaveData SaveSystem::loadGame(const QString& saveName)
         
         QByteArray data = file.readAll();
         file.close();
+        MemoryUsage bufferMemory(MemoryBudget::Category::SAVEBUFFERS);
+        bufferMemory.set(data.size());
         
         QJsonParseError error;
         QJsonDocument doc = QJsonDocument::fromJson(data, &error);
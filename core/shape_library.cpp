@@ -0,0 +1,118 @@
+#include "shape_library.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+ShapeLibrary::ShapeLibrary(QObject *parent)
+    : QObject(parent)
+{
+    m_shapeDirectory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/JigsawPuzzle/Shapes";
+}
+
+ShapeLibrary *ShapeLibrary::instance()
+{
+    // 随应用程序一起销毁
+    static QPointer<ShapeLibrary> library;
+    if (!library) library = new ShapeLibrary(QCoreApplication::instance());
+    return library;
+}
+
+QStringList ShapeLibrary::shapeNames() const
+{
+    // 只列出文件，不读取内容
+    QDir dir(m_shapeDirectory);
+    QFileInfoList fileList = dir.entryInfoList({"*.jshape"}, QDir::Files, QDir::Time);
+
+    QStringList names;
+    for (const QFileInfo &fileInfo : fileList) {
+        names.append(fileInfo.completeBaseName());
+    }
+    return names;
+}
+
+bool ShapeLibrary::shapeExists(const QString &name) const
+{
+    return QFile::exists(shapeFilePath(name));
+}
+
+bool ShapeLibrary::saveShape(const QString &name, const CustomPuzzlePath &customPath)
+{
+    TraceSpan span("ShapeLibrary::saveShape");
+    if (!isValidName(name)) {
+        qDebug() << "形状名称无效:" << name;
+        return false;
+    }
+    if (!QDir().mkpath(m_shapeDirectory)) {
+        qDebug() << "无法创建形状目录:" << m_shapeDirectory;
+        return false;
+    }
+
+    // 先写到临时文件，写完再替换，保存失败时旧的形状不会损坏
+    QSaveFile file(shapeFilePath(name));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "无法打开形状文件:" << file.fileName() << "错误:" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << MAGIC << VERSION;
+    customPath.write(stream);
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "形状文件写入失败:" << file.fileName() << "错误:" << file.errorString();
+        return false;
+    }
+
+    qDebug() << "形状已保存到:" << file.fileName() << "大小:" << QFileInfo(file.fileName()).size() << "字节";
+    return true;
+}
+
+bool ShapeLibrary::loadShape(const QString &name, CustomPuzzlePath &customPath) const
+{
+    TraceSpan span("ShapeLibrary::loadShape");
+    QFile file(shapeFilePath(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "无法打开形状文件:" << file.fileName() << "错误:" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        qDebug() << "形状文件格式不支持:" << file.fileName() << "版本:" << version;
+        return false;
+    }
+
+    CustomPuzzlePath shape;
+    if (!shape.read(stream)) {
+        qDebug() << "形状文件已损坏:" << file.fileName();
+        return false;
+    }
+
+    customPath = shape;
+    return true;
+}
+
+bool ShapeLibrary::isValidName(const QString &name)
+{
+    static const QString invalidCharacters = "/\\:*?\"<>|";
+    return !name.trimmed().isEmpty() && std::none_of(name.begin(), name.end(), [](QChar c) {return invalidCharacters.contains(c);});
+}
+
+QString ShapeLibrary::shapeFilePath(const QString &name) const
+{
+    return m_shapeDirectory + "/" + name + ".jshape";
+}
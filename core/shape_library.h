@@ -0,0 +1,46 @@
+#ifndef SHAPE_LIBRARY_H
+#define SHAPE_LIBRARY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include "components/custom_puzzle_path.h"
+
+/*
+ * The ShapeLibrary stores the custom shapes of the PathCreator in Documents/JigsawPuzzle/Shapes, one binary file per
+ * shape. A file contains MAGIC, VERSION and the CustomPuzzlePath written by CustomPuzzlePath::write(): the points, the
+ * recommended inner bounds percentage and the compiled path. Loading a shape doesn't calculate its inner bounds again,
+ * but the stored compiled path is checked against the points. Coordinates are stored with double precision, so a
+ * shape is the same after it was saved and loaded again. VERSION 1 files were stored with single precision and are
+ * not loaded.
+ *
+ * shapeNames() only lists the directory, a file is read when its shape is loaded. Files with another MAGIC or VERSION
+ * or damaged files are not loaded.
+ */
+
+class ShapeLibrary : public QObject
+{
+    Q_OBJECT
+
+    static constexpr quint32 MAGIC = 0x4A534850; // "JSHP"
+    static constexpr quint16 VERSION = 2;
+
+public:
+    static ShapeLibrary *instance();
+
+    QStringList shapeNames() const;
+    bool shapeExists(const QString &name) const;
+    bool saveShape(const QString &name, const CustomPuzzlePath &customPath);
+    bool loadShape(const QString &name, CustomPuzzlePath &customPath) const;
+
+    static bool isValidName(const QString &name);
+
+private:
+    explicit ShapeLibrary(QObject *parent = nullptr);
+
+    QString m_shapeDirectory;
+
+    QString shapeFilePath(const QString &name) const;
+};
+
+#endif // SHAPE_LIBRARY_H
@@ -0,0 +1,108 @@
+#include "trace.h"
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <chrono>
+
+std::atomic_bool Trace::s_enabled(false);
+QMutex Trace::s_mutex;
+QVector<Trace::Event> Trace::s_events;
+qint64 Trace::s_startNSecs = 0;
+
+void Trace::start()
+{
+    QMutexLocker locker(&s_mutex);
+    if (s_enabled.load()) return;
+    s_events.clear();
+    s_startNSecs = now();
+    s_enabled.store(true);
+    qDebug() << "开始记录跟踪";
+}
+
+QString Trace::stop()
+{
+    if (!s_enabled.exchange(false)) return QString();
+
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/JigsawPuzzle/Traces";
+    if (!QDir().mkpath(directory)) {
+        qDebug() << "创建跟踪目录失败:" << directory;
+        return QString();
+    }
+    QString filename = directory + "/trace_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".json";
+    return writeJson(filename) ? filename : QString();
+}
+
+bool Trace::writeJson(const QString &filename)
+{
+    QVector<Event> events;
+    qint64 startNSecs;
+    {
+        QMutexLocker locker(&s_mutex);
+        events = s_events;
+        startNSecs = s_startNSecs;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (const Event &event : events) {
+        // Chrome 的时间单位是微秒
+        QJsonObject obj;
+        obj["name"] = QString::fromLatin1(event.name);
+        obj["cat"] = "jigsaw";
+        obj["ph"] = "X";
+        obj["ts"] = (event.startNSecs - startNSecs) / 1000.0;
+        obj["dur"] = event.durationNSecs / 1000.0;
+        obj["pid"] = pid;
+        obj["tid"] = static_cast<qint64>(event.threadID);
+        traceEvents.append(obj);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "无法写入跟踪文件:" << filename;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.close();
+
+    qDebug() << "跟踪已写入:" << filename << "事件数:" << events.size();
+    return true;
+}
+
+void Trace::startFromEnvironment()
+{
+    if (!qEnvironmentVariableIsEmpty("JIGSAW_TRACE")) start();
+}
+
+void Trace::stopFromEnvironment()
+{
+    QString filename = qEnvironmentVariable("JIGSAW_TRACE");
+    if (filename.isEmpty() || !s_enabled.exchange(false)) return;
+    writeJson(filename);
+}
+
+qint64 Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char *name, qint64 startNSecs, qint64 durationNSecs)
+{
+    // 线程编号只用来区分线程，所以直接用线程句柄
+    quint64 threadID = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker locker(&s_mutex);
+    if (!s_enabled.load(std::memory_order_relaxed) || s_events.size() >= MAXEVENTS) return;
+    s_events.push_back({name, startNSecs, durationNSecs, threadID});
+}
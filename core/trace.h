@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+
+/*
+ * Trace records how long the stages of the game take, e.g. creating the grid and the paths of a new puzzle or fixing a
+ * dropped piece, and writes them as a Chrome trace-event JSON file. The file can be opened with chrome://tracing or
+ * https://ui.perfetto.dev.
+ *
+ * A stage is recorded by putting a TraceSpan on the stack at its beginning:
+ *
+ *      TraceSpan span("PuzzleGrid::createGridPaths");
+ *
+ * The span is recorded when it goes out of scope. While tracing is disabled a span only checks a single flag, so spans
+ * can stay in the code. Spans can be used from any thread. The name must be a string literal or live until the trace
+ * was written.
+ *
+ * Tracing is started and stopped with F4 in the game. stop() writes the trace to the traces folder next to the saves.
+ * If the environment variable JIGSAW_TRACE is set to a filename, tracing starts at startup and the trace is written to
+ * that file when the game is closed.
+ */
+
+class Trace
+{
+public:
+    static bool isEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void start();
+    static QString stop();
+    static bool writeJson(const QString &filename);
+
+    static void startFromEnvironment();
+    static void stopFromEnvironment();
+
+    static qint64 now();
+    static void record(const char* name, qint64 startNSecs, qint64 durationNSecs);
+
+private:
+    Trace() = delete;
+
+    static constexpr int MAXEVENTS = 1000000;
+
+    struct Event {
+        const char* name;
+        qint64 startNSecs;
+        qint64 durationNSecs;
+        quint64 threadID;
+    };
+
+    static std::atomic_bool s_enabled;
+    static QMutex s_mutex;
+    static QVector<Event> s_events;
+    static qint64 s_startNSecs;
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name)
+        : m_name(Trace::isEnabled() ? name : nullptr)
+        , m_startNSecs(m_name ? Trace::now() : 0)
+    {
+
+    }
+
+    ~TraceSpan()
+    {
+        if (m_name) Trace::record(m_name, m_startNSecs, Trace::now() - m_startNSecs);
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char* m_name;
+    qint64 m_startNSecs;
+};
+
+#endif // TRACE_H
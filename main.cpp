@@ -1,11 +1,15 @@
 #include "ui/main_window.h"
+#include "core/trace.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Trace::startFromEnvironment();
     MainWindow w;
     w.showFullScreen();
-    return a.exec();
+    int result = a.exec();
+    Trace::stopFromEnvironment();
+    return result;
 }
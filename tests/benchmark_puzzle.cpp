@@ -0,0 +1,178 @@
+#include "benchmark_puzzle.h"
+#include "core/puzzle_setup_worker.h"
+#include "components/puzzle_piece.h"
+#include "tools/image_ops.h"
+#include "tools/piece_scatter.h"
+#include <QElapsedTimer>
+#include <QLinearGradient>
+#include <QPainter>
+#include <algorithm>
+
+BenchmarkPuzzle::BenchmarkPuzzle() :
+    m_piecePool(&m_board),
+    m_setupMSecs(0),
+    m_microsecondsPerPiece(0.0)
+{
+    m_board.resize(m_parameters.screenWidth, m_parameters.screenHeight);
+}
+
+bool BenchmarkPuzzle::setUp(int numberOfPieces, bool rotationAllowed)
+{
+    // 和 PuzzleGame::calculateRowsAndCols() 一样，图片最多占屏幕的 2/3 x 4/5
+    QSize imageSize(m_parameters.screenWidth * 2 / 3, m_parameters.screenHeight * 4 / 5);
+    int rows;
+    int cols;
+    PuzzleGrid::calculateRowsAndCols(numberOfPieces, 1.0 * imageSize.width() / imageSize.height(), rows, cols);
+
+    PuzzleSetupWorker::Settings settings;
+    settings.pyramid = std::make_shared<ImagePyramid>(testImage(imageSize));
+    settings.rows = rows;
+    settings.cols = cols;
+    settings.pieceWidth = imageSize.width() / cols;
+    settings.pieceHeight = imageSize.height() / rows;
+    settings.typeOfPiece = Jigsaw::TypeOfPiece::STANDARD;
+    settings.randomSeed = 1;
+    settings.maxCollisionAttempts = m_parameters.maxCollisionAttemptsLargePuzzle;
+    settings.boardSize = m_board.size();
+    settings.freeArea = m_parameters.rectFreeArea;
+
+    // 工作对象直接在调用线程中运行，信号都是直接调用
+    QVector<PuzzleSetupPiece> setupPieces;
+    bool successful = false;
+    PuzzleSetupWorker worker(settings);
+    QObject::connect(&worker, &PuzzleSetupWorker::gridReady, [this](PuzzleGrid* newGrid) {
+        m_grid.reset(newGrid);
+    });
+    QObject::connect(&worker, &PuzzleSetupWorker::fragmentLevelsReady, [this](ImagePyramidPointer newLevels) {
+        m_fragmentLevels = newLevels;
+    });
+    QObject::connect(&worker, &PuzzleSetupWorker::piecesReady, [&setupPieces](const QVector<PuzzleSetupPiece> &pieces) {
+        setupPieces += pieces;
+    });
+    QObject::connect(&worker, &PuzzleSetupWorker::finished, [&successful](bool newSuccessful) {
+        successful = newSuccessful;
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    worker.run();
+    m_setupMSecs = timer.elapsed();
+    if (!successful || !m_grid || setupPieces.size() != rows * cols) {
+        return false;
+    }
+
+    m_pieces.reserve(setupPieces.size());
+    timer.restart();
+    for (const auto &pieceData : setupPieces) {
+        PuzzlePiece* piece = m_piecePool.acquire(pieceData.id, m_grid->pieceTotalSize(), QBrush(ImageOps::toPixmap(pieceData.fragment)), pieceData.path);
+        piece->setFragmentLevels(m_fragmentLevels, m_grid->puzzleTotalSize(), m_grid->overlayGridPoint(pieceData.id));
+        piece->setBoardView(&m_view);
+        piece->setRotationEnabled(rotationAllowed);
+        piece->move(pieceData.position);
+        piece->setInputDispatcher(&m_inputDispatcher);
+        m_pieces.push_back(piece);
+    }
+    m_microsecondsPerPiece = timer.nsecsElapsed() / 1e3 / m_pieces.size();
+    return true;
+}
+
+const Jigsaw::Parameters &BenchmarkPuzzle::parameters() const
+{
+    return m_parameters;
+}
+
+QWidget* BenchmarkPuzzle::board()
+{
+    return &m_board;
+}
+
+BoardView* BenchmarkPuzzle::view()
+{
+    return &m_view;
+}
+
+BoardInputDispatcher* BenchmarkPuzzle::inputDispatcher()
+{
+    return &m_inputDispatcher;
+}
+
+PuzzleGrid* BenchmarkPuzzle::grid() const
+{
+    return m_grid.get();
+}
+
+const QVector<PuzzlePiece*> &BenchmarkPuzzle::pieces() const
+{
+    return m_pieces;
+}
+
+/*
+ * Returns the rectangle on the board which contains all pieces and the area the PieceScatter could have used for them,
+ * like PuzzleGame::fitPiecesIntoView().
+ */
+
+QRectF BenchmarkPuzzle::scatterBoard() const
+{
+    QRectF bounds = PieceScatter::boardFor(m_pieces.size(), m_grid->pieceTotalSize(), m_board.rect(), m_parameters.rectFreeArea);
+    for (auto piece : m_pieces) {
+        bounds |= piece->spriteRect();
+    }
+    return bounds;
+}
+
+qint64 BenchmarkPuzzle::setupMSecs() const
+{
+    return m_setupMSecs;
+}
+
+double BenchmarkPuzzle::microsecondsPerPiece() const
+{
+    return m_microsecondsPerPiece;
+}
+
+void BenchmarkPuzzle::placePieces()
+{
+    // 和 PuzzleGame 一样，只显示视口中的碎片
+    for (auto piece : m_pieces) {
+        piece->updateView();
+        piece->setVisible(m_view.mapToScreen(piece->spriteRect()).intersects(QRectF(m_board.rect())));
+    }
+}
+
+void BenchmarkPuzzle::renderFrame()
+{
+    if (m_frame.size() != m_board.size()) {
+        m_frame = QImage(m_board.size(), ImageOps::FORMAT);
+    }
+    m_board.render(&m_frame);
+}
+
+double BenchmarkPuzzle::frameMSecs()
+{
+    // 第一次绘制还要画出刚显示的碎片，不计入
+    renderFrame();
+
+    QVector<double> msecs;
+    QElapsedTimer timer;
+    for (int i = 0; i < FRAMES; ++i) {
+        timer.start();
+        renderFrame();
+        msecs.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(msecs.begin(), msecs.end());
+    return msecs[FRAMES / 2];
+}
+
+QImage BenchmarkPuzzle::testImage(const QSize &size)
+{
+    // 渐变让每个碎片的内容都不一样，绘制时不会因为纯色而走捷径
+    QImage image(size, ImageOps::FORMAT);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0.0, Qt::darkBlue);
+    gradient.setColorAt(0.5, Qt::yellow);
+    gradient.setColorAt(1.0, Qt::darkRed);
+    painter.fillRect(image.rect(), gradient);
+    painter.end();
+    return image;
+}
@@ -0,0 +1,71 @@
+#ifndef BENCHMARK_PUZZLE_H
+#define BENCHMARK_PUZZLE_H
+
+#include "core/jigsaw_types.h"
+#include "core/board_view.h"
+#include "core/board_input_dispatcher.h"
+#include "core/puzzle_grid.h"
+#include "components/piece_pool.h"
+#include "tools/image_pyramid.h"
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+#include <memory>
+
+/*
+ * A BenchmarkPuzzle sets up a puzzle for the benchmarks the way the PuzzleGame does: the PuzzleSetupWorker creates the
+ * grid, the edges and the fragments from a generated image, then the pieces are created by a PiecePool on a board
+ * widget and placed with a BoardView. The worker runs directly on the calling thread. setUp() returns false if the
+ * worker failed, setupMSecs() and microsecondsPerPiece() tell how long the worker and the creation of the pieces took.
+ *
+ * The image has the largest size a puzzle image can have on the screen of Jigsaw::Parameters, the board widget has
+ * the size of the screen. All pieces report their drags and rotations to one BoardInputDispatcher. placePieces() places
+ * all pieces after the view changed and hides those outside of the board, like PuzzleGame::updateBoardView().
+ * frameMSecs() is the median time of FRAMES renderings of the board.
+ */
+
+class BenchmarkPuzzle
+{
+public:
+    static constexpr int FRAMES = 11;
+
+    BenchmarkPuzzle();
+
+    BenchmarkPuzzle(const BenchmarkPuzzle &) = delete;
+    BenchmarkPuzzle &operator=(const BenchmarkPuzzle &) = delete;
+
+    bool setUp(int numberOfPieces, bool rotationAllowed);
+
+    const Jigsaw::Parameters &parameters() const;
+    QWidget* board();
+    BoardView* view();
+    BoardInputDispatcher* inputDispatcher();
+    PuzzleGrid* grid() const;
+    const QVector<PuzzlePiece*> &pieces() const;
+    QRectF scatterBoard() const;
+
+    qint64 setupMSecs() const;
+    double microsecondsPerPiece() const;
+
+    void placePieces();
+    void renderFrame();
+    double frameMSecs();
+
+    static QImage testImage(const QSize &size);
+
+private:
+    Jigsaw::Parameters m_parameters;
+    BoardView m_view;
+    BoardInputDispatcher m_inputDispatcher;
+    QWidget m_board;
+    PiecePool m_piecePool;
+    std::unique_ptr<PuzzleGrid> m_grid;
+    ImagePyramidPointer m_fragmentLevels;
+    QVector<PuzzlePiece*> m_pieces;
+    QImage m_frame;
+
+    qint64 m_setupMSecs;
+    double m_microsecondsPerPiece;
+};
+
+#endif // BENCHMARK_PUZZLE_H
@@ -0,0 +1,100 @@
+#include "image_pipeline_benchmark.h"
+#include "benchmark_puzzle.h"
+#include "core/render_stats.h"
+#include "components/merged_piece_sprite.h"
+#include "components/puzzle_piece.h"
+#include "ui/puzzle_button.h"
+#include "tools/image_ops.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEnterEvent>
+#include <QPainterPath>
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+
+void ImagePipelineBenchmark::steadyStatePlay()
+{
+    BenchmarkPuzzle puzzle;
+    QVERIFY(puzzle.setUp(NUMBEROFPIECES, true));
+    const QVector<PuzzlePiece*> &pieces = puzzle.pieces();
+    QVERIFY(pieces.size() >= GROUPSIZE + MOVEDPIECES);
+    QWidget* board = puzzle.board();
+    BoardView* view = puzzle.view();
+
+    MergedPieceSprite* sprite = new MergedPieceSprite(board);
+    sprite->setBoardView(view);
+    sprite->flatten(pieces.mid(0, GROUPSIZE));
+    PuzzlePiece* leader = pieces[0];
+
+    QPainterPath buttonPath;
+    buttonPath.addRoundedRect(QRectF(0, 0, 200, 80), 20, 20);
+    PuzzleButton* button = new PuzzleButton(QSize(200, 80), QBrush(ImageOps::toPixmap(BenchmarkPuzzle::testImage(QSize(200, 80)))), buttonPath, board);
+    button->animate();
+    button->move(20, 20);
+
+    view->reset();
+    puzzle.placePieces();
+    board->show();
+    QVERIFY(QTest::qWaitForWindowExposed(board));
+
+    // 一步中的操作和玩家一帧中的操作一样，缩放在两个相差约 4 倍的缩放比例之间来回，跨过至少一个层级
+    const double zoomFactor = std::pow(BoardView::ZOOMSTEP, 6);
+    const QPointF boardCenter = QRectF(board->rect()).center();
+    // 碎片的位置只取决于步数，预热和测量时走过完全一样的位置
+    auto step = [&](int i) {
+        const double direction = (i / ZOOMINTERVAL) % 2 == 0 ? 1.0 : -1.0;
+        for (int j = GROUPSIZE; j < GROUPSIZE + MOVEDPIECES; ++j) {
+            int k = j - GROUPSIZE;
+            pieces[j]->move(QPointF(100 + 60 * (k % 10) + i, 300 + 60 * (k / 10) - i));
+            pieces[j]->setAngle(i * 15 % 360);
+        }
+        leader->move(boardCenter + QPointF(-i, i));
+        sprite->follow(leader);
+
+        if (i % ZOOMINTERVAL == 0) {
+            view->zoomAt(boardCenter, direction > 0 ? 1.0 / zoomFactor : zoomFactor);
+            sprite->updateView();
+        } else {
+            view->panBy(QPointF(2 * direction, -direction));
+        }
+        puzzle.placePieces();
+
+        if (i % 2 == 0) {
+            QEnterEvent enterEvent(QPointF(10, 10), QPointF(30, 30), QPointF(30, 30));
+            QCoreApplication::sendEvent(button, &enterEvent);
+        } else {
+            QEvent leaveEvent(QEvent::Leave);
+            QCoreApplication::sendEvent(button, &leaveEvent);
+        }
+        QCoreApplication::processEvents();
+        puzzle.renderFrame();
+    };
+
+    for (int i = 0; i < STEPS; ++i) {
+        step(i);
+    }
+    RenderStats::Snapshot before = RenderStats::takeSnapshot();
+
+    QVector<double> msecs;
+    QElapsedTimer timer;
+    for (int i = 0; i < STEPS; ++i) {
+        timer.start();
+        step(i);
+        msecs.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    RenderStats::Snapshot after = RenderStats::takeSnapshot();
+    sprite->syncPieces();
+
+    std::sort(msecs.begin(), msecs.end());
+    double stepMSecs = msecs[STEPS / 2];
+    const char* names[RenderStats::NUMBEROFCONVERSIONS] = {"format", "pixmap to image", "image to pixmap"};
+    qInfo() << "稳定状态每步" << stepMSecs << "毫秒，转换" << after.conversions[0] - before.conversions[0]
+            << after.conversions[1] - before.conversions[1] << after.conversions[2] - before.conversions[2];
+    QTest::setBenchmarkResult(stepMSecs, QTest::WalltimeMilliseconds);
+
+    for (int i = 0; i < RenderStats::NUMBEROFCONVERSIONS; ++i) {
+        qint64 conversions = after.conversions[i] - before.conversions[i];
+        QVERIFY2(conversions == 0, qPrintable(QString("%1 %2 conversions in steady-state play").arg(conversions).arg(names[i])));
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_PIPELINE_BENCHMARK_H
+#define IMAGE_PIPELINE_BENCHMARK_H
+
+#include <QObject>
+
+/*
+ * The ImagePipelineBenchmark checks that steady-state play doesn't convert images. It sets up a BenchmarkPuzzle with
+ * rotation, flattens a group of pieces into a MergedPieceSprite and adds an animated PuzzleButton to the board. Every
+ * step moves and rotates single pieces, drags the group, hovers the button, pans or zooms the view across the sprite
+ * levels and renders a frame.
+ *
+ * The first STEPS steps warm up the caches: the hover pixmaps of the button, the sprites of every level and the merged
+ * image. The next STEPS steps repeat exactly the same play and must not count a single conversion in the RenderStats.
+ * The median step time is reported as the benchmark result.
+ */
+
+class ImagePipelineBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    static constexpr int NUMBEROFPIECES = 100;
+    static constexpr int GROUPSIZE = 16;        // 合并成 MergedPieceSprite 的碎片
+    static constexpr int MOVEDPIECES = 20;      // 每步移动并旋转的单独碎片
+    static constexpr int STEPS = 60;
+    static constexpr int ZOOMINTERVAL = 10;     // 每隔这么多步缩放一次，其余的步平移
+
+private slots:
+    void steadyStatePlay();
+};
+
+#endif // IMAGE_PIPELINE_BENCHMARK_H
@@ -0,0 +1,66 @@
+#include "input_dispatch_benchmark.h"
+#include "benchmark_puzzle.h"
+#include "components/puzzle_piece.h"
+#include <QCursor>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QtTest>
+#include <algorithm>
+
+void InputDispatchBenchmark::followingPieces_data()
+{
+    QTest::addColumn<int>("numberOfFollowingPieces");
+    QTest::newRow("1 piece") << 1;
+    QTest::newRow("10 pieces") << 10;
+    QTest::newRow("100 pieces") << 100;
+}
+
+void InputDispatchBenchmark::followingPieces()
+{
+    QFETCH(int, numberOfFollowingPieces);
+
+    BenchmarkPuzzle puzzle;
+    QVERIFY(puzzle.setUp(NUMBEROFPIECES, false));
+    const QVector<PuzzlePiece*> &pieces = puzzle.pieces();
+    QVERIFY(pieces.size() >= numberOfFollowingPieces);
+    BoardInputDispatcher* dispatcher = puzzle.inputDispatcher();
+
+    // 所有碎片都在视口中，点击的碎片都是可见的
+    puzzle.view()->fit(puzzle.scatterBoard(), QRectF(puzzle.board()->rect()));
+    puzzle.placePieces();
+    puzzle.board()->show();
+    QVERIFY(QTest::qWaitForWindowExposed(puzzle.board()));
+
+    int draggedSignals = 0;
+    connect(dispatcher, &BoardInputDispatcher::dragged, this, [&draggedSignals](int, const QPointF &) {
+        ++draggedSignals;
+    });
+
+    // 点击选中的碎片跟随光标，由调度器唯一的计时器移动
+    const QPoint cursorStart = puzzle.board()->mapToGlobal(puzzle.board()->rect().center());
+    QCursor::setPos(cursorStart);
+    for (int i = 0; i < numberOfFollowingPieces; ++i) {
+        QTest::mousePress(pieces[i], Qt::LeftButton, Qt::NoModifier, pieces[i]->rect().center());
+    }
+
+    // 计时器的槽函数直接调用，测量的只是一帧的分发，不包括等待计时器
+    QVector<double> microseconds;
+    QElapsedTimer timer;
+    for (int i = 0; i < FRAMES; ++i) {
+        QCursor::setPos(cursorStart + QPoint(i % 2 == 0 ? 5 : -5, 0));
+        timer.start();
+        QMetaObject::invokeMethod(dispatcher, "moveTimerTimeOut", Qt::DirectConnection);
+        microseconds.push_back(timer.nsecsElapsed() / 1e3);
+    }
+    QCOMPARE(draggedSignals, numberOfFollowingPieces * FRAMES);
+
+    std::sort(microseconds.begin(), microseconds.end());
+    double frameMicroseconds = microseconds[FRAMES / 2];
+    double microsecondsPerPiece = frameMicroseconds / numberOfFollowingPieces;
+    qInfo() << pieces.size() << "块中" << numberOfFollowingPieces << "块跟随光标: 每帧" << frameMicroseconds
+            << "微秒，每块碎片" << microsecondsPerPiece << "微秒";
+    QTest::setBenchmarkResult(frameMicroseconds / 1e3, QTest::WalltimeMilliseconds);
+
+    QVERIFY2(microsecondsPerPiece <= MAXMICROSECONDSPERPIECE,
+             qPrintable(QString("%1 us per following piece > %2 us").arg(microsecondsPerPiece).arg(MAXMICROSECONDSPERPIECE)));
+}
@@ -0,0 +1,30 @@
+#ifndef INPUT_DISPATCH_BENCHMARK_H
+#define INPUT_DISPATCH_BENCHMARK_H
+
+#include <QObject>
+
+/*
+ * The InputDispatchBenchmark measures what one frame of the BoardInputDispatcher costs while pieces are dragged. It
+ * sets up a BenchmarkPuzzle with NUMBEROFPIECES pieces and selects some of them with a click, so they follow the
+ * cursor. Every frame moves the cursor and runs the timer slot of the dispatcher, which moves the selected pieces and
+ * emits dragged() for each of them. The other pieces have neither timers nor connections, so they must not add to the
+ * cost of a frame.
+ *
+ * A frame is the median of FRAMES frames. The benchmark fails if a following piece costs more than
+ * MAXMICROSECONDSPERPIECE per frame.
+ */
+
+class InputDispatchBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    static constexpr int NUMBEROFPIECES = 1000;
+    static constexpr int FRAMES = 101;
+    static constexpr double MAXMICROSECONDSPERPIECE = 50.0;
+
+private slots:
+    void followingPieces_data();
+    void followingPieces();
+};
+
+#endif // INPUT_DISPATCH_BENCHMARK_H
@@ -0,0 +1,50 @@
+#include "large_puzzle_benchmark.h"
+#include "benchmark_puzzle.h"
+#include "core/jigsaw_types.h"
+#include "core/memory_budget.h"
+#include <QtTest>
+#include <iterator>
+
+void LargePuzzleBenchmark::largePuzzle_data()
+{
+    QTest::addColumn<int>("budgetIndex");
+    for (int i = 0; i < int(std::size(Jigsaw::LARGEPUZZLEBUDGETS)); ++i) {
+        QTest::addRow("%d pieces", Jigsaw::LARGEPUZZLEBUDGETS[i].numberOfPieces) << i;
+    }
+}
+
+void LargePuzzleBenchmark::largePuzzle()
+{
+    QFETCH(int, budgetIndex);
+    const Jigsaw::LargePuzzleBudget &budget = Jigsaw::LARGEPUZZLEBUDGETS[budgetIndex];
+    qint64 bytesBefore = MemoryBudget::totalBytes();
+
+    BenchmarkPuzzle puzzle;
+    QVERIFY(puzzle.setUp(budget.numberOfPieces, false));
+    qint64 setupMSecs = puzzle.setupMSecs();
+    double microsecondsPerPiece = puzzle.microsecondsPerPiece();
+
+    puzzle.view()->fit(puzzle.scatterBoard(), QRectF(puzzle.board()->rect()));
+    puzzle.placePieces();
+    puzzle.board()->show();
+    QVERIFY(QTest::qWaitForWindowExposed(puzzle.board()));
+    double fitFrameMSecs = puzzle.frameMSecs();
+    double memoryMB = (MemoryBudget::totalBytes() - bytesBefore) / (1024.0 * 1024.0);
+
+    puzzle.view()->reset();
+    puzzle.placePieces();
+    double viewFrameMSecs = puzzle.frameMSecs();
+
+    qInfo() << budget.numberOfPieces << "块: 内存" << memoryMB << "MB，生成" << setupMSecs << "毫秒，每块碎片"
+            << microsecondsPerPiece << "微秒，缩小后每帧" << fitFrameMSecs << "毫秒，原始大小每帧" << viewFrameMSecs << "毫秒";
+    QTest::setBenchmarkResult(fitFrameMSecs, QTest::WalltimeMilliseconds);
+
+    QVERIFY2(memoryMB <= budget.memoryMB, qPrintable(QString("memory %1 MB > %2 MB").arg(memoryMB).arg(budget.memoryMB)));
+    QVERIFY2(setupMSecs <= budget.setupMSecs, qPrintable(QString("setup %1 ms > %2 ms").arg(setupMSecs).arg(budget.setupMSecs)));
+    QVERIFY2(microsecondsPerPiece <= budget.microsecondsPerPiece,
+             qPrintable(QString("%1 us per piece > %2 us").arg(microsecondsPerPiece).arg(budget.microsecondsPerPiece)));
+    QVERIFY2(fitFrameMSecs <= budget.fitFrameMSecs,
+             qPrintable(QString("zoomed out frame %1 ms > %2 ms").arg(fitFrameMSecs).arg(budget.fitFrameMSecs)));
+    QVERIFY2(viewFrameMSecs <= budget.viewFrameMSecs,
+             qPrintable(QString("zoom 1 frame %1 ms > %2 ms").arg(viewFrameMSecs).arg(budget.viewFrameMSecs)));
+}
@@ -0,0 +1,20 @@
+#ifndef LARGE_PUZZLE_BENCHMARK_H
+#define LARGE_PUZZLE_BENCHMARK_H
+
+#include <QObject>
+
+/*
+ * The LargePuzzleBenchmark sets up a BenchmarkPuzzle for every entry of Jigsaw::LARGEPUZZLEBUDGETS, fits all pieces
+ * into the view and renders the board zoomed out and at zoom 1. The measured values are printed and compared with the
+ * budget. The benchmark fails if one of them is over budget.
+ */
+
+class LargePuzzleBenchmark : public QObject
+{
+    Q_OBJECT
+private slots:
+    void largePuzzle_data();
+    void largePuzzle();
+};
+
+#endif // LARGE_PUZZLE_BENCHMARK_H
@@ -0,0 +1,32 @@
+#include "image_pipeline_benchmark.h"
+#include "input_dispatch_benchmark.h"
+#include "large_puzzle_benchmark.h"
+#include "puzzle_grid_test.h"
+
+#include <QApplication>
+#include <QtTest>
+
+int main(int argc, char *argv[])
+{
+    // 碎片是控件，需要 QApplication。ctest 用 offscreen 平台运行，不需要显示器
+    QApplication app(argc, argv);
+
+    int result = 0;
+    {
+        PuzzleGridTest test;
+        result |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ImagePipelineBenchmark benchmark;
+        result |= QTest::qExec(&benchmark, argc, argv);
+    }
+    {
+        InputDispatchBenchmark benchmark;
+        result |= QTest::qExec(&benchmark, argc, argv);
+    }
+    {
+        LargePuzzleBenchmark benchmark;
+        result |= QTest::qExec(&benchmark, argc, argv);
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+#include "puzzle_grid_test.h"
+#include "core/jigsaw_types.h"
+#include "core/puzzle_grid.h"
+#include <QtTest>
+#include <QtMath>
+
+double PuzzleGridTest::exhaustiveCost(int numberOfPieces, double imageRatio, double upperBound)
+{
+    // 比上界还大的网格，光碎片数量的误差就已经更差了
+    double bestCost = upperBound;
+    int maxPieces = qFloor(numberOfPieces * (1.0 + upperBound));
+    for (int r = 1; r <= maxPieces; ++r) {
+        for (int c = 1; r * c <= maxPieces; ++c) {
+            bestCost = qMin(bestCost, PuzzleGrid::rowsAndColsCost(numberOfPieces, imageRatio, r, c));
+        }
+    }
+    return bestCost;
+}
+
+void PuzzleGridTest::singlePiece()
+{
+    int rows = 0;
+    int cols = 0;
+    for (double imageRatio : {0.01, 1.0, 16.0 / 9.0, 100.0}) {
+        PuzzleGrid::calculateRowsAndCols(1, imageRatio, rows, cols);
+        QCOMPARE(rows, 1);
+        QCOMPARE(cols, 1);
+    }
+}
+
+void PuzzleGridTest::rowsAndCols_data()
+{
+    QTest::addColumn<int>("numberOfPieces");
+    QTest::addColumn<double>("imageRatio");
+
+    QTest::newRow("2 pieces") << 2 << 1.0;
+    for (int prime : {3, 7, 13, 97, 101, 499, 997, 7919}) {
+        QTest::addRow("%d pieces (prime), 4:3", prime) << prime << 4.0 / 3.0;
+        QTest::addRow("%d pieces (prime), 16:9", prime) << prime << 16.0 / 9.0;
+    }
+    for (double imageRatio : {20.0, 100.0, 1000.0}) {
+        QTest::addRow("very wide %g:1", imageRatio) << 500 << imageRatio;
+        QTest::addRow("very tall 1:%g", imageRatio) << 500 << 1.0 / imageRatio;
+    }
+    Jigsaw::Parameters parameters;
+    QTest::newRow("largest puzzle, 16:9") << parameters.maxNumberOfPiecesLargePuzzle << 16.0 / 9.0;
+    QTest::newRow("largest puzzle, 3:4") << parameters.maxNumberOfPiecesLargePuzzle << 3.0 / 4.0;
+    QTest::newRow("largest puzzle, very wide") << parameters.maxNumberOfPiecesLargePuzzle << 50.0;
+    QTest::newRow("largest puzzle, very tall") << parameters.maxNumberOfPiecesLargePuzzle << 1.0 / 50.0;
+}
+
+void PuzzleGridTest::rowsAndCols()
+{
+    QFETCH(int, numberOfPieces);
+    QFETCH(double, imageRatio);
+
+    int rows = 0;
+    int cols = 0;
+    PuzzleGrid::calculateRowsAndCols(numberOfPieces, imageRatio, rows, cols);
+    QVERIFY(rows >= 1);
+    QVERIFY(cols >= 1);
+
+    double cost = PuzzleGrid::rowsAndColsCost(numberOfPieces, imageRatio, rows, cols);
+    double bestCost = exhaustiveCost(numberOfPieces, imageRatio, cost);
+    QVERIFY2(cost <= bestCost + 1e-12, qPrintable(QString("%1 x %2 is rated %3, the best grid %4").arg(rows).arg(cols).arg(cost).arg(bestCost)));
+}
+
+void PuzzleGridTest::allSmallNumbersOfPieces()
+{
+    for (double imageRatio : {0.25, 3.0 / 4.0, 1.0, 4.0 / 3.0, 16.0 / 9.0, 3.0}) {
+        for (int numberOfPieces = 1; numberOfPieces <= MAXEXHAUSTIVEPIECES; ++numberOfPieces) {
+            int rows = 0;
+            int cols = 0;
+            PuzzleGrid::calculateRowsAndCols(numberOfPieces, imageRatio, rows, cols);
+            double cost = PuzzleGrid::rowsAndColsCost(numberOfPieces, imageRatio, rows, cols);
+            QVERIFY2(cost <= exhaustiveCost(numberOfPieces, imageRatio, cost) + 1e-12,
+                     qPrintable(QString("%1 pieces, ratio %2: %3 x %4 isn't the best grid").arg(numberOfPieces).arg(imageRatio).arg(rows).arg(cols)));
+        }
+    }
+}
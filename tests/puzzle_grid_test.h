@@ -0,0 +1,32 @@
+#ifndef PUZZLE_GRID_TEST_H
+#define PUZZLE_GRID_TEST_H
+
+#include <QObject>
+
+/*
+ * The PuzzleGridTest checks PuzzleGrid::calculateRowsAndCols() against an exhaustive search. The search only has to
+ * look at grids with rows * cols <= numberOfPieces * (1 + best cost), since every bigger grid is rated worse by its
+ * error in the number of pieces alone. Several grids can have the same rating, so the ratings are compared, not the
+ * rows and columns.
+ *
+ * The edge cases are a single piece, prime numbers of pieces (no exact grid except 1 x n), very wide and very tall
+ * images and the largest number of pieces of a large puzzle. Every number of pieces up to MAXEXHAUSTIVEPIECES is
+ * checked for a few common image ratios.
+ */
+
+class PuzzleGridTest : public QObject
+{
+    Q_OBJECT
+private:
+    static constexpr int MAXEXHAUSTIVEPIECES = 300;
+
+    static double exhaustiveCost(int numberOfPieces, double imageRatio, double upperBound);
+
+private slots:
+    void singlePiece();
+    void rowsAndCols_data();
+    void rowsAndCols();
+    void allSmallNumbersOfPieces();
+};
+
+#endif // PUZZLE_GRID_TEST_H
@@ -1,9 +1,14 @@
 #include "creator_canvas.h"
+#include "ui/animation_scheduler.h"
+#include <QPainter>
 
 CreatorCanvas::CreatorCanvas(QWidget *parent)
-    : QLabel{parent}
+    : QWidget{parent}
+    , m_dragPending(false)
+    , m_frameCallback(0)
 {
     setFixedSize(300, 300);
+    setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
 CreatorCanvas::~CreatorCanvas()
@@ -11,6 +16,19 @@ CreatorCanvas::~CreatorCanvas()
     
 }
 
+void CreatorCanvas::setLayers(const QPixmap &background, const QPicture &foreground)
+{
+    m_background = background;
+    m_foreground = foreground;
+    update();
+}
+
+void CreatorCanvas::setForeground(const QPicture &foreground)
+{
+    QRect dirtyRect = foregroundRect();
+    m_foreground = foreground;
+    update(dirtyRect.united(foregroundRect()));
+}
 
 void CreatorCanvas::mousePressEvent(QMouseEvent *event)
 {
@@ -19,10 +37,41 @@ void CreatorCanvas::mousePressEvent(QMouseEvent *event)
 
 void CreatorCanvas::mouseReleaseEvent(QMouseEvent *event)
 {
+    emitPendingDrag();
     emit released();
 }
 
 void CreatorCanvas::mouseMoveEvent(QMouseEvent *event)
 {
-    emit dragged(event->pos());
+    // 鼠标移动比屏幕刷新快得多，每一帧只处理最后的位置
+    m_pendingDrag = event->pos();
+    m_dragPending = true;
+    if (!AnimationScheduler::instance()->isRunning(m_frameCallback)) {
+        m_frameCallback = AnimationScheduler::instance()->onFrame(this, [this]() {
+            return emitPendingDrag();
+        });
+    }
+}
+
+void CreatorCanvas::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.setClipRegion(event->region());
+    if (m_background.isNull()) painter.fillRect(event->rect(), Qt::white);
+    else painter.drawPixmap(event->rect(), m_background, event->rect());
+    painter.drawPicture(0, 0, m_foreground);
+}
+
+QRect CreatorCanvas::foregroundRect() const
+{
+    // 画笔的宽度和文字不一定包含在 boundingRect 中
+    return m_foreground.boundingRect().adjusted(-FOREGROUNDMARGIN, -FOREGROUNDMARGIN, FOREGROUNDMARGIN, FOREGROUNDMARGIN);
+}
+
+bool CreatorCanvas::emitPendingDrag()
+{
+    if (!m_dragPending) return false;
+    m_dragPending = false;
+    emit dragged(m_pendingDrag);
+    return true;
 }
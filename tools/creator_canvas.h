@@ -1,16 +1,30 @@
 #ifndef CREATOR_CANVAS_H
 #define CREATOR_CANVAS_H
 
-#include <QLabel>
+#include <QWidget>
 #include <QMouseEvent>
+#include <QPixmap>
+#include <QPicture>
 
-class CreatorCanvas : public QLabel
+/*
+ * The CreatorCanvas shows the path of the PathCreator in two layers. The background is a cached QPixmap with everything
+ * that doesn't change while the user drags a point. The foreground is a QPicture with the parts that do change. When
+ * only the foreground is replaced, just the area of the old and the new foreground is repainted.
+ *
+ * Mouse moves are collected and dragged() is emitted at most once per frame of the AnimationScheduler with the latest
+ * position. A pending position is always emitted before released().
+ */
+
+class CreatorCanvas : public QWidget
 {
     Q_OBJECT
 public:
     CreatorCanvas(QWidget* parent = nullptr);
     ~CreatorCanvas();
 
+    void setLayers(const QPixmap &background, const QPicture &foreground);
+    void setForeground(const QPicture &foreground);
+
 signals:
     void clicked(const QPoint &position);
     void released();
@@ -21,6 +35,19 @@ protected:
     virtual void mousePressEvent(QMouseEvent *event) override;
     virtual void mouseReleaseEvent(QMouseEvent *event) override;
     virtual void mouseMoveEvent(QMouseEvent *event) override;
+    virtual void paintEvent(QPaintEvent *event) override;
+
+private:
+    static constexpr int FOREGROUNDMARGIN = 12;
+
+    QPixmap m_background;
+    QPicture m_foreground;
+    QPoint m_pendingDrag;
+    bool m_dragPending;
+    int m_frameCallback;
+
+    QRect foregroundRect() const;
+    bool emitPendingDrag();
 };
 
 #endif // CREATOR_CANVAS_H
@@ -0,0 +1,70 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*
+ * A lock-free ring buffer for exactly one producer thread and one consumer thread, e.g. a thread rendering frames and
+ * the GUI thread showing them. It holds up to CAPACITY elements. push() fails instead of blocking if the queue is full,
+ * so the producer can drop the frame and render a newer one later. popLatest() skips all frames but the newest one,
+ * because a consumer that fell behind only needs to show the most recent frame.
+ *
+ * The producer must only call push() and isFull(), the consumer only pop() and popLatest().
+ */
+
+template <typename T, std::size_t CAPACITY>
+class FrameQueue
+{
+public:
+    bool push(T element)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t next = increment(tail);
+        if (next == m_head.load(std::memory_order_acquire)) return false;
+
+        m_elements[tail] = std::move(element);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &element)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+        element = std::move(m_elements[head]);
+        m_elements[head] = T();
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    bool popLatest(T &element)
+    {
+        bool popped = false;
+        while (pop(element)) popped = true;
+        return popped;
+    }
+
+    bool isFull() const
+    {
+        return increment(m_tail.load(std::memory_order_relaxed)) == m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    // One slot stays empty to tell a full queue from an empty one.
+    static constexpr std::size_t SIZE = CAPACITY + 1;
+
+    static std::size_t increment(std::size_t index)
+    {
+        return (index + 1) % SIZE;
+    }
+
+    std::array<T, SIZE> m_elements;
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+#endif // FRAME_QUEUE_H
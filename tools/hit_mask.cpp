@@ -0,0 +1,75 @@
+#include "hit_mask.h"
+#include "image_ops.h"
+
+HitMask::HitMask()
+    : m_width(0)
+    , m_height(0)
+    , m_wordsPerRow(0)
+{
+
+}
+
+HitMask::HitMask(const QImage &image)
+    : m_width(image.width())
+    , m_height(image.height())
+    , m_wordsPerRow((image.width() + 63) / 64)
+    , m_bits(m_wordsPerRow * image.height(), 0)
+{
+    if (image.isNull()) return;
+
+    // 统一转换成一种格式，之后直接从扫描线读取 alpha
+    QImage argb = ImageOps::premultiplied(image);
+    for (int y = 0; y < m_height; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(argb.constScanLine(y));
+        quint64* bits = m_bits.data() + y * m_wordsPerRow;
+        for (int x = 0; x < m_width; ++x) {
+            if (qAlpha(line[x]) >= ALPHATHRESHOLD) bits[x >> 6] |= quint64(1) << (x & 63);
+        }
+    }
+}
+
+HitMask::HitMask(const QSize &size)
+    : m_width(size.width())
+    , m_height(size.height())
+    , m_wordsPerRow((size.width() + 63) / 64)
+    , m_bits(m_wordsPerRow * size.height(), 0)
+{
+
+}
+
+void HitMask::unite(const HitMask &other, const QPoint &offset)
+{
+    for (int y = 0; y < other.m_height; ++y) {
+        int targetY = y + offset.y();
+        if (targetY < 0 || targetY >= m_height) continue;
+
+        const quint64* sourceBits = other.m_bits.constData() + y * other.m_wordsPerRow;
+        quint64* targetBits = m_bits.data() + targetY * m_wordsPerRow;
+        for (int i = 0; i < other.m_wordsPerRow; ++i) {
+            if (sourceBits[i] == 0) continue;
+            // 一个字最多落在目标的两个字上
+            int targetX = offset.x() + i * 64;
+            int word = targetX >= 0 ? targetX / 64 : (targetX - 63) / 64;
+            int shift = targetX - word * 64;
+            if (word >= 0 && word < m_wordsPerRow) targetBits[word] |= sourceBits[i] << shift;
+            if (shift > 0 && word + 1 >= 0 && word + 1 < m_wordsPerRow) targetBits[word + 1] |= sourceBits[i] >> (64 - shift);
+        }
+        // 超出宽度的位保持为 0，否则再合并到更大的遮罩时会变成像素
+        if (m_width % 64 != 0) targetBits[m_wordsPerRow - 1] &= (quint64(1) << (m_width % 64)) - 1;
+    }
+}
+
+bool HitMask::isNull() const
+{
+    return m_bits.isEmpty();
+}
+
+QSize HitMask::size() const
+{
+    return QSize(m_width, m_height);
+}
+
+qint64 HitMask::bytes() const
+{
+    return static_cast<qint64>(m_bits.size()) * sizeof(quint64);
+}
@@ -0,0 +1,55 @@
+#ifndef HIT_MASK_H
+#define HIT_MASK_H
+
+#include <QImage>
+#include <QVector>
+#include <QPoint>
+#include <QSize>
+
+/*
+ * A HitMask stores for every pixel of an image whether it is opaque enough to be clicked, packed into one bit per
+ * pixel. A pixel counts as opaque if its alpha is at least ALPHATHRESHOLD, which is the same threshold QPixmap::mask()
+ * uses. contains() is a single bit test, points outside of the image are never contained.
+ *
+ * It replaces widget masks for hit testing. A widget mask is a QRegion, which can consist of thousands of rectangles
+ * for a jigsaw piece and has to be rebuilt whenever the widget is redrawn. A HitMask is built once from the unrotated
+ * image and points are mapped into it with the inverse transformation instead.
+ *
+ * unite() adds the opaque pixels of another mask at an offset, a whole word at a time, so a mask for several images
+ * can be built from their own masks without drawing the images again.
+ */
+
+class HitMask
+{
+public:
+    HitMask();
+    explicit HitMask(const QImage &image);
+    explicit HitMask(const QSize &size);
+
+    bool contains(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= m_width || y >= m_height) return false;
+        return (m_bits[y * m_wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    bool contains(const QPoint &point) const
+    {
+        return contains(point.x(), point.y());
+    }
+
+    void unite(const HitMask &other, const QPoint &offset);
+
+    bool isNull() const;
+    QSize size() const;
+    qint64 bytes() const;
+
+private:
+    static constexpr int ALPHATHRESHOLD = 128;
+
+    int m_width;
+    int m_height;
+    int m_wordsPerRow;
+    QVector<quint64> m_bits;
+};
+
+#endif // HIT_MASK_H
@@ -1,4 +1,8 @@
 #include "image_effects.h"
+#include "image_effects_renderer.h"
+#include "ui/animation_scheduler.h"
+#include "image_ops.h"
+#include <QPaintEvent>
 
 ImageEffects::ImageEffects(QObject *parent)
     : QObject{parent}
@@ -6,9 +10,10 @@ ImageEffects::ImageEffects(QObject *parent)
     , m_source(QPixmap())
     , m_type(TypeOfEffect::FADEIN)
     , m_duration(1000)
-    , m_timer(new QTimer(this))
+    , m_frameCallback(0)
+    , m_surface(nullptr)
 {
-    QObject::connect(m_timer, &QTimer::timeout, this, &ImageEffects::fadeInTimeout);
+
 }
 
 ImageEffects::ImageEffects(QLabel* target, const QPixmap &source, TypeOfEffect type, QObject *parent, double duration)
@@ -17,14 +22,15 @@ ImageEffects::ImageEffects(QLabel* target, const QPixmap &source, TypeOfEffect t
     , m_source(source)
     , m_type(type)
     , m_duration(duration)
-    , m_timer(new QTimer(this))
+    , m_frameCallback(0)
+    , m_surface(nullptr)
 {
-    setType(type);
+
 }
 
 ImageEffects::~ImageEffects()
 {
-
+    stopRenderer();
 }
 
 void ImageEffects::run()
@@ -37,26 +43,85 @@ void ImageEffects::run()
     m_targetSize = m_target->size();
     // 限制图片最大尺寸为目标的50%，避免图片过大
     QSize maxSize = m_targetSize * 0.5;
-    m_source = m_source.scaled(maxSize, Qt::KeepAspectRatio);
-    m_scaledSourceSize = m_source.size();
-    
+    m_scaledSourceSize = m_source.size().scaled(maxSize, Qt::KeepAspectRatio);
+
     // 调试信息
     qDebug() << "ImageEffects - Target size:" << m_targetSize;
     qDebug() << "ImageEffects - Max size:" << maxSize;
     qDebug() << "ImageEffects - Scaled source size:" << m_scaledSourceSize;
     m_startingPoint = QPoint((m_targetSize.width() - m_scaledSourceSize.width()) / 2, (m_targetSize.height() - m_scaledSourceSize.height()) / 2);
-    m_counter = 0;
-    m_percentagPerTimeout = 1.0 * TIMEOUTMSECS / m_duration;
 
     if (m_target->pixmap().isNull()) {
-        m_unfinishedPixmap = QPixmap(m_targetSize);
-        m_unfinishedPixmap.fill(Qt::transparent);
+        m_background = QPixmap(m_targetSize);
+        m_background.fill(Qt::transparent);
     }
     else {
-        m_unfinishedPixmap = m_target->pixmap();
+        m_background = m_target->pixmap();
+        // 背景只缩放一次，之后每一帧只复制需要重绘的部分
+        if (m_target->hasScaledContents() && m_background.size() != m_targetSize) {
+            m_background = m_background.scaled(m_targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
     }
 
-    m_timer->start(TIMEOUTMSECS);
+    m_surface = new QWidget(m_target);
+    m_surface->setGeometry(m_target->rect());
+    m_surface->setAttribute(Qt::WA_TransparentForMouseEvents);
+    if (!m_background.hasAlphaChannel()) m_surface->setAttribute(Qt::WA_OpaquePaintEvent);
+    m_surface->installEventFilter(this);
+    m_surface->show();
+    m_surface->raise();
+
+    m_frameRect = QRect();
+    m_framePixmap = QPixmap();
+    startRenderer();
+    m_frameCallback = AnimationScheduler::instance()->onFrame(this, [this]() {
+        return showNextFrame();
+    });
+}
+
+void ImageEffects::startRenderer()
+{
+    ImageEffectsRenderer::Settings settings;
+    settings.type = m_type;
+    settings.source = ImageOps::toImage(m_source);
+    settings.sourceRect = QRect(m_startingPoint, m_scaledSourceSize);
+    settings.duration = m_duration;
+
+    m_frames = std::make_shared<ImageEffectsFrameQueue>();
+
+    ImageEffectsRenderer* renderer = new ImageEffectsRenderer(settings, m_frames);
+    QThread* thread = new QThread();
+    renderer->moveToThread(thread);
+
+    m_renderThread = thread;
+    m_renderCancelled = renderer->cancelFlag();
+
+    QObject::connect(thread, &QThread::started, renderer, &ImageEffectsRenderer::run);
+    QObject::connect(renderer, &ImageEffectsRenderer::finished, thread, &QThread::quit);
+    QObject::connect(thread, &QThread::finished, renderer, &QObject::deleteLater);
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    thread->start();
+}
+
+void ImageEffects::stopRenderer()
+{
+    if (m_renderCancelled) m_renderCancelled->store(true);
+    if (m_renderThread) {
+        m_renderThread->quit();
+        m_renderThread->wait();
+    }
+    m_renderCancelled.reset();
+}
+
+bool ImageEffects::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_surface && event->type() == QEvent::Paint) {
+        QPainter painter(m_surface);
+        paintSurface(painter, static_cast<QPaintEvent*>(event)->rect());
+        return true;
+    }
+    return QObject::eventFilter(watched, event);
 }
 
 QPaintDevice *ImageEffects::target() const
@@ -86,24 +151,6 @@ ImageEffects::TypeOfEffect ImageEffects::type() const
 
 void ImageEffects::setType(TypeOfEffect newType)
 {
-    switch (m_type) {
-    case ImageEffects::TypeOfEffect::GROW:
-        QObject::disconnect(m_timer, &QTimer::timeout, this, &ImageEffects::growTimeout);
-        break;
-    case ImageEffects::TypeOfEffect::FADEIN:
-        QObject::disconnect(m_timer, &QTimer::timeout, this, &ImageEffects::fadeInTimeout);
-        break;
-    default:
-        break;
-    }
-    switch (newType) {
-    case ImageEffects::TypeOfEffect::GROW:
-        QObject::connect(m_timer, &QTimer::timeout, this, &ImageEffects::growTimeout);
-        break;
-    case ImageEffects::TypeOfEffect::FADEIN:
-        QObject::connect(m_timer, &QTimer::timeout, this, &ImageEffects::fadeInTimeout);
-        break;
-    }
     m_type = newType;
 }
 
@@ -116,34 +163,48 @@ void ImageEffects::setDuration(double newDuration)
 {
     m_duration = newDuration;
 }
-void ImageEffects::growTimeout()
+
+void ImageEffects::paintSurface(QPainter &painter, const QRect &rect)
 {
-    if (m_percentagPerTimeout * m_counter >= 1.0) {
-        m_timer->stop();
-        emit effectFinished(true);
-        return;
-    }
-    QPainter painter(&m_unfinishedPixmap);
-    QPixmap scaledPixmap = m_source.scaled(m_scaledSourceSize * m_percentagPerTimeout * m_counter, Qt::KeepAspectRatio);
-    QPoint offset((m_scaledSourceSize.width() - scaledPixmap.width()) / 2, (m_scaledSourceSize.height() - scaledPixmap.height()) / 2);
-    painter.drawPixmap(QRect(m_startingPoint + offset, scaledPixmap.size()), scaledPixmap, scaledPixmap.rect());
-    m_target->setPixmap(m_unfinishedPixmap);
-    ++m_counter;
+    painter.drawPixmap(rect, m_background, rect);
+    if (!m_framePixmap.isNull()) painter.drawPixmap(m_frameRect, m_framePixmap);
 }
 
-void ImageEffects::fadeInTimeout()
+void ImageEffects::finish()
 {
-    if (m_percentagPerTimeout * m_counter >= 1.0) {
-        m_timer->stop();
-        emit effectFinished(true);
-        return;
-    }
-    QPainter painter(&m_unfinishedPixmap);
-
-    //No idea why, but the pixmap is fully opaque at a value of 0.1, and not 1.0 as stated in the documentation
+    AnimationScheduler::instance()->stop(m_frameCallback);
+    stopRenderer();
+    m_frames.reset();
+
+    QPixmap finishedPixmap = m_background;
+    QPainter painter(&finishedPixmap);
+    paintSurface(painter, finishedPixmap.rect());
+    painter.end();
+    m_target->setPixmap(finishedPixmap);
+
+    m_surface->deleteLater();
+    m_surface = nullptr;
+    m_background = QPixmap();
+    m_framePixmap = QPixmap();
+
+    emit effectFinished(true);
+}
 
-    painter.setOpacity(m_percentagPerTimeout * m_counter / 10);
-    painter.drawPixmap(QRect(m_startingPoint, m_source.size()), m_source, m_source.rect());
-    m_target->setPixmap(m_unfinishedPixmap);
-    ++m_counter;
+bool ImageEffects::showNextFrame()
+{
+    ImageEffectsFrame frame;
+    if (!m_frames) return false;
+    if (!m_frames->popLatest(frame)) return true;
+
+    // 新的一帧覆盖上一帧，只重绘两帧所在的区域
+    QRect dirtyRect = frame.rect.united(m_frameRect);
+    m_frameRect = frame.rect;
+    m_framePixmap = ImageOps::toPixmap(frame.image);
+
+    if (frame.progress >= 1.0) {
+        finish();
+        return false;
+    }
+    m_surface->update(dirtyRect);
+    return true;
 }
@@ -1,24 +1,50 @@
 #ifndef IMAGE_EFFECTS_H
 #define IMAGE_EFFECTS_H
 
+#include "frame_queue.h"
 #include <QImage>
 #include <QTimer>
 #include <QObject>
 #include <QPainter>
 #include <QLabel>
+#include <QPointer>
+#include <QThread>
+#include <atomic>
+#include <memory>
 #include <random>
 
 /*
- * This class creates the effect for the image you see, when you finish a jigsaw puzzle. It has
- * a slot run() and a signal effectFinished(), so it is possible to run it on a different thread.
+ * A single frame of an effect. image is drawn at rect, in coordinates of the target.
+ */
+
+struct ImageEffectsFrame
+{
+    QRect rect;
+    QImage image;
+    double progress = 0.0;
+};
+
+using ImageEffectsFrameQueue = FrameQueue<ImageEffectsFrame, 3>;
+
+/*
+ * This class creates the effect for the image you see, when you finish a jigsaw puzzle. Call run() to start it, the
+ * signal effectFinished() is emitted when it is done.
+ *
+ * The frames are rendered into QImages by an ImageEffectsRenderer on its own thread and handed over through a lock-free
+ * ImageEffectsFrameQueue. On the GUI thread ImageEffects only takes the newest frame from the queue and draws it once
+ * per frame of the AnimationScheduler, so the effect never blocks input handling. The effect is driven by the time
+ * elapsed since it was started and not by the number of frames, so it always takes the given duration. If either
+ * thread falls behind, frames are dropped.
+ *
+ * While the effect runs, it is drawn on a transparent surface widget on top of the target. Only the part of the surface
+ * that changed since the last frame is repainted. When the effect is finished, the final image is set as the pixmap of
+ * the target and the surface is deleted.
  */
 
 class ImageEffects : public QObject
 {
     Q_OBJECT
 
-    const int TIMEOUTMSECS = 10;
-
 public:
     enum class TypeOfEffect {
         GROW,
@@ -41,23 +67,33 @@ public:
 public slots:
     void run();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private:
     QLabel* m_target;
     QPixmap m_source;
     TypeOfEffect m_type;
     double m_duration;
-    QTimer* m_timer;
+    int m_frameCallback;
 
     QSize m_targetSize;
     QSize m_scaledSourceSize;
     QPoint m_startingPoint;
-    QPixmap m_unfinishedPixmap;
-    int m_counter;
-    double m_percentagPerTimeout;
+    QPixmap m_background;
+    QWidget* m_surface;
+
+    QPointer<QThread> m_renderThread;
+    std::shared_ptr<std::atomic_bool> m_renderCancelled;
+    std::shared_ptr<ImageEffectsFrameQueue> m_frames;
+    QRect m_frameRect;
+    QPixmap m_framePixmap;
 
-private slots:
-    void growTimeout();
-    void fadeInTimeout();
+    void startRenderer();
+    void stopRenderer();
+    void paintSurface(QPainter &painter, const QRect &rect);
+    void finish();
+    bool showNextFrame();
 
 signals:
     void effectFinished(bool successful);
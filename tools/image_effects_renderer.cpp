@@ -0,0 +1,107 @@
+#include "image_effects_renderer.h"
+#include "image_ops.h"
+
+ImageEffectsRenderer::ImageEffectsRenderer(const Settings &settings, std::shared_ptr<ImageEffectsFrameQueue> frames, QObject *parent)
+    : QObject{parent}
+    , m_settings(settings)
+    , m_frames(frames)
+    , m_cancelled(std::make_shared<std::atomic_bool>(false))
+    , m_timer(nullptr)
+    , m_lastFramePending(false)
+{
+
+}
+
+std::shared_ptr<std::atomic_bool> ImageEffectsRenderer::cancelFlag() const
+{
+    return m_cancelled;
+}
+
+void ImageEffectsRenderer::run()
+{
+    // 缩放后的图片和各级缩小的图片都保持这个格式，绘制每一帧时不需要转换
+    ImageOps::makePremultiplied(m_settings.source);
+    if (m_settings.source.size() != m_settings.sourceRect.size()) {
+        m_settings.source = m_settings.source.scaled(m_settings.sourceRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    if (m_settings.type == ImageEffects::TypeOfEffect::GROW) m_pyramid = std::make_unique<ImagePyramid>(m_settings.source);
+
+    // 定时器必须在工作线程中创建
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(m_timer, &QTimer::timeout, this, &ImageEffectsRenderer::timeout);
+
+    m_frameClock.start();
+    m_timer->start(TIMEOUTMSECS);
+    timeout();
+}
+
+void ImageEffectsRenderer::timeout()
+{
+    if (m_cancelled->load(std::memory_order_relaxed)) {
+        stop();
+        return;
+    }
+
+    if (m_lastFramePending) {
+        if (m_frames->push(m_lastFrame)) stop();
+        return;
+    }
+
+    // 界面线程还没有取走之前的帧，跳过这一帧
+    if (m_frames->isFull()) return;
+
+    double progress = qMin(1.0, m_frameClock.elapsed() / m_settings.duration);
+    ImageEffectsFrame frame = renderFrame(progress);
+    bool pushed = m_frames->push(frame);
+
+    if (progress >= 1.0) {
+        if (pushed) {
+            stop();
+        }
+        else {
+            m_lastFrame = frame;
+            m_lastFramePending = true;
+        }
+    }
+}
+
+void ImageEffectsRenderer::stop()
+{
+    m_timer->stop();
+    m_pyramid.reset();
+    emit finished();
+}
+
+QRect ImageEffectsRenderer::growRect(double progress) const
+{
+    QSize sourceSize = m_settings.sourceRect.size();
+    QSize size = sourceSize * progress;
+    QPoint offset((sourceSize.width() - size.width()) / 2, (sourceSize.height() - size.height()) / 2);
+    return QRect(m_settings.sourceRect.topLeft() + offset, size);
+}
+
+ImageEffectsFrame ImageEffectsRenderer::renderFrame(double progress) const
+{
+    ImageEffectsFrame frame;
+    frame.progress = progress;
+
+    switch (m_settings.type) {
+    case ImageEffects::TypeOfEffect::GROW: {
+        frame.rect = growRect(progress);
+        if (frame.rect.isEmpty()) break;
+        frame.image = m_pyramid->scaled(frame.rect.size());
+        break;
+    }
+    case ImageEffects::TypeOfEffect::FADEIN: {
+        frame.rect = m_settings.sourceRect;
+        frame.image = QImage(frame.rect.size(), ImageOps::FORMAT);
+        frame.image.fill(Qt::transparent);
+        QPainter painter(&frame.image);
+        painter.setOpacity(progress);
+        painter.drawImage(frame.image.rect(), m_settings.source);
+        break;
+    }
+    }
+    return frame;
+}
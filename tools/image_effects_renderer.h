@@ -0,0 +1,74 @@
+#ifndef IMAGE_EFFECTS_RENDERER_H
+#define IMAGE_EFFECTS_RENDERER_H
+
+#include "image_effects.h"
+#include "image_pyramid.h"
+#include <QObject>
+#include <QImage>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+/*
+ * The ImageEffectsRenderer renders the frames of an ImageEffects off the GUI thread. It is moved to a QThread and run()
+ * is called when the thread is started. Only QImages are used, because QPixmaps must not be used outside of the GUI
+ * thread.
+ *
+ * The source is scaled to the size of sourceRect once, when the renderer is started.
+ *
+ * Every TIMEOUTMSECS the progress is calculated from the time elapsed since run() and a frame is pushed into the
+ * queue. If the queue is full, because the GUI thread didn't take the last frames yet, no frame is rendered. The last
+ * frame always has a progress of 1.0 and is kept until it fits into the queue. After that finished() is emitted.
+ *
+ * GROW   An ImagePyramid of the source is built once. A frame is the smallest level that is still bigger than the
+ *        frame, scaled to the size of the frame.
+ * FADEIN A frame is the source drawn with the progress as opacity. The background is drawn by the GUI thread.
+ *
+ * To cancel the renderer, set the flag returned by cancelFlag() from any thread.
+ */
+
+class ImageEffectsRenderer : public QObject
+{
+    Q_OBJECT
+
+    const int TIMEOUTMSECS = 16;
+
+public:
+    struct Settings {
+        ImageEffects::TypeOfEffect type = ImageEffects::TypeOfEffect::GROW;
+        QImage source;
+        QRect sourceRect;
+        double duration = 1000;
+    };
+
+    explicit ImageEffectsRenderer(const Settings &settings, std::shared_ptr<ImageEffectsFrameQueue> frames, QObject *parent = nullptr);
+
+    std::shared_ptr<std::atomic_bool> cancelFlag() const;
+
+private:
+    Settings m_settings;
+    std::shared_ptr<ImageEffectsFrameQueue> m_frames;
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    QTimer* m_timer;
+    QElapsedTimer m_frameClock;
+    std::unique_ptr<ImagePyramid> m_pyramid;
+    ImageEffectsFrame m_lastFrame;
+    bool m_lastFramePending;
+
+    QRect growRect(double progress) const;
+    ImageEffectsFrame renderFrame(double progress) const;
+    void stop();
+
+public slots:
+    void run();
+
+private slots:
+    void timeout();
+
+signals:
+    void finished();
+};
+
+#endif // IMAGE_EFFECTS_RENDERER_H
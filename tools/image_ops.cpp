@@ -0,0 +1,254 @@
+#include "image_ops.h"
+#include "core/render_stats.h"
+#include <QtGlobal>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IMAGE_OPS_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_OPS_SSE2
+#endif
+
+namespace {
+
+// x / 255, rounded, for 0 <= x <= 255 * 255
+inline uint32_t div255(uint32_t x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+#ifdef IMAGE_OPS_SSE2
+inline __m128i div255(__m128i x)
+{
+    __m128i rounded = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(rounded, _mm_srli_epi16(rounded, 8)), 8);
+}
+
+inline __m128i broadcastAlpha(__m128i pixels)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
+#ifdef IMAGE_OPS_AVX2
+inline __m256i div255(__m256i x)
+{
+    __m256i rounded = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(rounded, _mm256_srli_epi16(rounded, 8)), 8);
+}
+
+inline __m256i broadcastAlpha(__m256i pixels)
+{
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
+}
+
+void ImageOps::lighten(QImage &image, int amount)
+{
+    blend(image, Target::ALPHA, QColor(Qt::white), amount);
+}
+
+void ImageOps::darken(QImage &image, int amount)
+{
+    blend(image, Target::ZERO, QColor(Qt::black), amount);
+}
+
+void ImageOps::tint(QImage &image, const QColor &color, int amount)
+{
+    blend(image, Target::COLOR, color, amount);
+}
+
+QImage ImageOps::premultiplied(const QImage &image)
+{
+    QImage result = image;
+    makePremultiplied(result);
+    return result;
+}
+
+void ImageOps::makePremultiplied(QImage &image)
+{
+    if (image.isNull() || image.format() == FORMAT) return;
+    image.convertTo(FORMAT);
+    RenderStats::countConversion(RenderStats::Conversion::FORMAT);
+}
+
+QImage ImageOps::toImage(const QPixmap &pixmap)
+{
+    if (pixmap.isNull()) return QImage();
+    RenderStats::countConversion(RenderStats::Conversion::PIXMAPTOIMAGE);
+    QImage image = pixmap.toImage();
+    makePremultiplied(image);
+    return image;
+}
+
+QPixmap ImageOps::toPixmap(const QImage &image)
+{
+    if (image.isNull()) return QPixmap();
+    RenderStats::countConversion(RenderStats::Conversion::IMAGETOPIXMAP);
+    return QPixmap::fromImage(premultiplied(image));
+}
+
+QImage ImageOps::lightened(const QImage &image, int amount)
+{
+    QImage result = image;
+    lighten(result, amount);
+    return result;
+}
+
+QImage ImageOps::darkened(const QImage &image, int amount)
+{
+    QImage result = image;
+    darken(result, amount);
+    return result;
+}
+
+QImage ImageOps::tinted(const QImage &image, const QColor &color, int amount)
+{
+    QImage result = image;
+    tint(result, color, amount);
+    return result;
+}
+
+const char *ImageOps::instructionSet()
+{
+#if defined(IMAGE_OPS_AVX2)
+    return "AVX2";
+#elif defined(IMAGE_OPS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void ImageOps::blend(QImage &image, Target target, const QColor &color, int amount)
+{
+    if (image.isNull()) return;
+    makePremultiplied(image);
+
+    amount = qBound(0, amount, 256);
+    if (amount == 0) return;
+
+    // 与 ARGB32 像素在内存中的顺序相同：B, G, R, A
+    const uint16_t channels[4] = {static_cast<uint16_t>(color.blue()), static_cast<uint16_t>(color.green()),
+                                  static_cast<uint16_t>(color.red()), 255};
+
+    for (int y = 0; y < image.height(); ++y) {
+        blendScanline(reinterpret_cast<uint32_t*>(image.scanLine(y)), image.width(), target, channels, amount);
+    }
+}
+
+void ImageOps::blendScanline(uint32_t *line, int width, Target target, const uint16_t color[4], int amount)
+{
+    int x = 0;
+    const short keep = static_cast<short>(256 - amount);
+    const short take = static_cast<short>(amount);
+
+#ifdef IMAGE_OPS_AVX2
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i weightPixel = _mm256_setr_epi16(keep, keep, keep, 256, keep, keep, keep, 256,
+                                                      keep, keep, keep, 256, keep, keep, keep, 256);
+        const __m256i weightTarget = _mm256_setr_epi16(take, take, take, 0, take, take, take, 0,
+                                                       take, take, take, 0, take, take, take, 0);
+        const __m256i colorVector = _mm256_setr_epi16(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3],
+                                                      color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+
+        auto blendHalf = [&](__m256i pixels) {
+            __m256i targetPixels;
+            switch (target) {
+            case Target::ALPHA:
+                targetPixels = broadcastAlpha(pixels);
+                break;
+            case Target::ZERO:
+                targetPixels = zero;
+                break;
+            case Target::COLOR:
+            default:
+                targetPixels = div255(_mm256_mullo_epi16(colorVector, broadcastAlpha(pixels)));
+                break;
+            }
+            return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(pixels, weightPixel),
+                                                      _mm256_mullo_epi16(targetPixels, weightTarget)), 8);
+        };
+
+        for (; x + 8 <= width; x += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + x));
+            __m256i low = blendHalf(_mm256_unpacklo_epi8(pixels, zero));
+            __m256i high = blendHalf(_mm256_unpackhi_epi8(pixels, zero));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x), _mm256_packus_epi16(low, high));
+        }
+    }
+#endif
+
+#ifdef IMAGE_OPS_SSE2
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weightPixel = _mm_setr_epi16(keep, keep, keep, 256, keep, keep, keep, 256);
+        const __m128i weightTarget = _mm_setr_epi16(take, take, take, 0, take, take, take, 0);
+        const __m128i colorVector = _mm_setr_epi16(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+
+        auto blendHalf = [&](__m128i pixels) {
+            __m128i targetPixels;
+            switch (target) {
+            case Target::ALPHA:
+                targetPixels = broadcastAlpha(pixels);
+                break;
+            case Target::ZERO:
+                targetPixels = zero;
+                break;
+            case Target::COLOR:
+            default:
+                targetPixels = div255(_mm_mullo_epi16(colorVector, broadcastAlpha(pixels)));
+                break;
+            }
+            return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(pixels, weightPixel),
+                                                _mm_mullo_epi16(targetPixels, weightTarget)), 8);
+        };
+
+        for (; x + 4 <= width; x += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+            __m128i low = blendHalf(_mm_unpacklo_epi8(pixels, zero));
+            __m128i high = blendHalf(_mm_unpackhi_epi8(pixels, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x), _mm_packus_epi16(low, high));
+        }
+    }
+#endif
+
+    blendScanlineScalar(line + x, width - x, target, color, amount);
+}
+
+void ImageOps::blendScanlineScalar(uint32_t *line, int width, Target target, const uint16_t color[4], int amount)
+{
+    const uint32_t keep = 256 - amount;
+    const uint32_t take = amount;
+
+    for (int x = 0; x < width; ++x) {
+        uint32_t pixel = line[x];
+        uint32_t alpha = pixel >> 24;
+        uint32_t result = alpha << 24;
+
+        for (int channel = 0; channel < 3; ++channel) {
+            int shift = channel * 8;
+            uint32_t value = (pixel >> shift) & 0xff;
+            uint32_t targetValue = 0;
+            switch (target) {
+            case Target::ALPHA:
+                targetValue = alpha;
+                break;
+            case Target::ZERO:
+                targetValue = 0;
+                break;
+            case Target::COLOR:
+                targetValue = div255(color[channel] * alpha);
+                break;
+            }
+            result |= ((value * keep + targetValue * take) >> 8) << shift;
+        }
+        line[x] = result;
+    }
+}
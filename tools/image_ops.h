@@ -0,0 +1,75 @@
+#ifndef IMAGE_OPS_H
+#define IMAGE_OPS_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QColor>
+#include <cstdint>
+
+/*
+ * ImageOps contains simple per pixel operations on whole images: lighten(), darken() and tint(). They replace loops
+ * over pixelColor() and setPixelColor(), which convert every pixel into a QColor and back.
+ *
+ * All operations blend every pixel with a target color:
+ *
+ * lighten  blends towards white
+ * darken   blends towards black
+ * tint     blends towards the given color
+ *
+ * amount is between 0 (unchanged) and 256 (the target color). The alpha channel is never changed, so transparent parts
+ * of an image stay transparent and the mask of a PuzzleLabel stays the same.
+ *
+ * The images are converted to QImage::Format_ARGB32_Premultiplied if necessary. In this format blending towards a
+ * color premultiplied by the alpha of the pixel can be done with integer math on each channel. The scanlines are
+ * processed with AVX2 if the compiler targets it, otherwise with SSE2 on x86 and with plain C++ everywhere else.
+ *
+ * QImage::Format_ARGB32_Premultiplied (FORMAT) is also the format of every image in the game: decoded images, the
+ * overlay image and the fragments of the pieces, frames of the ImageEffects and the hover images of the PuzzleButtons.
+ * It is the format the raster paint engine draws with and the one raster QPixmaps with alpha use, so images in this
+ * format can be drawn and turned into pixmaps without being converted. Conversions should only be done with the
+ * functions below, which count them in RenderStats:
+ *
+ * premultiplied()  converts an image into FORMAT, if it isn't already
+ * toImage()        reads a pixmap back into an image in FORMAT
+ * toPixmap()       turns an image into a pixmap
+ */
+
+class ImageOps
+{
+public:
+    static void lighten(QImage &image, int amount = DEFAULTAMOUNT);
+    static void darken(QImage &image, int amount = DEFAULTAMOUNT);
+    static void tint(QImage &image, const QColor &color, int amount = DEFAULTAMOUNT);
+
+    static QImage lightened(const QImage &image, int amount = DEFAULTAMOUNT);
+    static QImage darkened(const QImage &image, int amount = DEFAULTAMOUNT);
+    static QImage tinted(const QImage &image, const QColor &color, int amount = DEFAULTAMOUNT);
+
+    static constexpr QImage::Format FORMAT = QImage::Format_ARGB32_Premultiplied;
+
+    static QImage premultiplied(const QImage &image);
+    static void makePremultiplied(QImage &image);
+    static QImage toImage(const QPixmap &pixmap);
+    static QPixmap toPixmap(const QImage &image);
+
+    // Name of the scanline implementation that was compiled in, e.g. for debug output.
+    static const char* instructionSet();
+
+private:
+    ImageOps() = delete;
+
+    static constexpr int DEFAULTAMOUNT = 128;
+
+    // How the target color of a pixel is calculated.
+    enum class Target {
+        ALPHA,  // white premultiplied by the alpha of the pixel
+        ZERO,   // black
+        COLOR   // the given color premultiplied by the alpha of the pixel
+    };
+
+    static void blend(QImage &image, Target target, const QColor &color, int amount);
+    static void blendScanline(uint32_t* line, int width, Target target, const uint16_t color[4], int amount);
+    static void blendScanlineScalar(uint32_t* line, int width, Target target, const uint16_t color[4], int amount);
+};
+
+#endif // IMAGE_OPS_H
@@ -0,0 +1,179 @@
+#include "image_pyramid.h"
+#include "image_ops.h"
+#include <QCoreApplication>
+#include <QImageReader>
+#include <QDebug>
+
+ImagePyramid::ImagePyramid(const QImage &image)
+{
+    if (image.isNull()) return;
+
+    m_levels.push_back(ImageOps::premultiplied(image));
+    while (m_levels.last().width() / 2 >= MINLEVELSIZE && m_levels.last().height() / 2 >= MINLEVELSIZE) {
+        const QImage &last = m_levels.last();
+        m_levels.push_back(last.scaled(last.size() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+
+    qint64 bytes = 0;
+    for (const auto &level : m_levels) {
+        bytes += MemoryBudget::imageBytes(level);
+    }
+    m_memory.set(bytes);
+}
+
+std::shared_ptr<const ImagePyramid> ImagePyramid::load(const QString &filename, const QSize &maxSize)
+{
+    QImageReader reader(filename);
+    QSize imageSize = reader.size();
+    if (maxSize.isValid() && imageSize.isValid() && (imageSize.width() > maxSize.width() || imageSize.height() > maxSize.height())) {
+        // 解码时直接缩小，不需要先解码完整的图片
+        reader.setScaledSize(imageSize.scaled(maxSize, Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qDebug() << "图片加载失败:" << filename << reader.errorString();
+        return nullptr;
+    }
+    return std::make_shared<ImagePyramid>(image);
+}
+
+bool ImagePyramid::isNull() const
+{
+    return m_levels.isEmpty();
+}
+
+QSize ImagePyramid::size() const
+{
+    return isNull() ? QSize() : m_levels.first().size();
+}
+
+int ImagePyramid::levels() const
+{
+    return m_levels.size();
+}
+
+const QImage &ImagePyramid::level(int index) const
+{
+    return m_levels[index];
+}
+
+const QImage &ImagePyramid::levelFor(const QSize &size) const
+{
+    for (int i = m_levels.size() - 1; i > 0; --i) {
+        if (m_levels[i].width() >= size.width() && m_levels[i].height() >= size.height()) return m_levels[i];
+    }
+    return m_levels.first();
+}
+
+QImage ImagePyramid::scaled(const QSize &size, Qt::AspectRatioMode aspectRatioMode) const
+{
+    if (isNull()) return QImage();
+
+    QSize targetSize = this->size().scaled(size, aspectRatioMode);
+    if (targetSize.isEmpty()) return QImage();
+
+    const QImage &level = levelFor(targetSize);
+    if (level.size() == targetSize) return level;
+    return level.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
+
+ImagePyramidLoader::ImagePyramidLoader(const QString &filename, const QSize &maxSize, QObject *parent)
+    : QObject{parent}
+    , m_filename(filename)
+    , m_maxSize(maxSize)
+{
+
+}
+
+void ImagePyramidLoader::run()
+{
+    emit finished(m_filename, ImagePyramid::load(m_filename, m_maxSize));
+}
+
+ImagePyramidCache::ImagePyramidCache(QObject *parent)
+    : QObject{parent}
+{
+
+}
+
+ImagePyramidCache::~ImagePyramidCache()
+{
+    // 解码无法中断，等待还在运行的线程结束
+    for (const auto &thread : m_loading) {
+        if (!thread) continue;
+        thread->quit();
+        thread->wait();
+    }
+}
+
+ImagePyramidCache *ImagePyramidCache::instance()
+{
+    // 随应用程序一起销毁
+    static QPointer<ImagePyramidCache> cache;
+    if (!cache) cache = new ImagePyramidCache(QCoreApplication::instance());
+    return cache;
+}
+
+ImagePyramidPointer ImagePyramidCache::find(const QString &filename)
+{
+    auto it = m_pyramids.constFind(filename);
+    if (it == m_pyramids.constEnd()) return nullptr;
+    touch(filename);
+    return it.value();
+}
+
+ImagePyramidPointer ImagePyramidCache::request(const QString &filename)
+{
+    ImagePyramidPointer pyramid = find(filename);
+    if (pyramid || m_loading.contains(filename)) return pyramid;
+
+    ImagePyramidLoader* loader = new ImagePyramidLoader(filename, m_maxSize);
+    QThread* thread = new QThread();
+    loader->moveToThread(thread);
+    m_loading.insert(filename, thread);
+
+    QObject::connect(thread, &QThread::started, loader, &ImagePyramidLoader::run);
+    QObject::connect(loader, &ImagePyramidLoader::finished, thread, &QThread::quit);
+    QObject::connect(thread, &QThread::finished, loader, &QObject::deleteLater);
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    QObject::connect(loader, &ImagePyramidLoader::finished, this, [this](const QString &filename, ImagePyramidPointer pyramid) {
+        m_loading.remove(filename);
+        if (pyramid) insert(filename, pyramid);
+        emit pyramidReady(filename);
+    });
+
+    thread->start();
+    return nullptr;
+}
+
+void ImagePyramidCache::insert(const QString &filename, ImagePyramidPointer pyramid)
+{
+    if (!pyramid || pyramid->isNull()) return;
+    m_pyramids.insert(filename, pyramid);
+    touch(filename);
+    trim(MAXPYRAMIDS);
+}
+
+void ImagePyramidCache::trim(int maxPyramids)
+{
+    while (m_recentlyUsed.size() > qMax(0, maxPyramids)) {
+        m_pyramids.remove(m_recentlyUsed.takeFirst());
+    }
+}
+
+QSize ImagePyramidCache::maxSize() const
+{
+    return m_maxSize;
+}
+
+void ImagePyramidCache::setMaxSize(const QSize &newMaxSize)
+{
+    m_maxSize = newMaxSize;
+}
+
+void ImagePyramidCache::touch(const QString &filename)
+{
+    m_recentlyUsed.removeAll(filename);
+    m_recentlyUsed.append(filename);
+}
@@ -0,0 +1,120 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include "core/memory_budget.h"
+#include <QObject>
+#include <QImage>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QPointer>
+#include <QThread>
+#include <memory>
+
+/*
+ * An ImagePyramid keeps an image in several resolutions (mip levels). Level 0 is the image itself, every further
+ * level is half the size of the previous one, down to MINLEVELSIZE. Each level is smoothly scaled from the previous
+ * one, so all of them are filtered well, and building the whole pyramid costs about as much as scaling the image once.
+ *
+ * scaled() starts from the smallest level that is still at least as big as the requested size, so it never scales
+ * down by more than a factor of two and doesn't touch the full resolution image for small sizes like previews.
+ *
+ * load() decodes an image file and builds its pyramid. If the image is bigger than maxSize, it is decoded at a lower
+ * resolution right away, which many image decoders (e.g. JPEG) can do much faster than decoding the full image. An
+ * ImagePyramid never changes after it was built, so it can be shared between threads. All levels are in
+ * ImageOps::FORMAT and counted as SOURCEIMAGE in the MemoryBudget.
+ */
+
+class ImagePyramid
+{
+public:
+    explicit ImagePyramid(const QImage &image);
+
+    ImagePyramid(const ImagePyramid &) = delete;
+    ImagePyramid &operator=(const ImagePyramid &) = delete;
+
+    static std::shared_ptr<const ImagePyramid> load(const QString &filename, const QSize &maxSize = QSize());
+
+    bool isNull() const;
+    QSize size() const;
+    int levels() const;
+    const QImage &level(int index) const;
+    const QImage &levelFor(const QSize &size) const;
+    QImage scaled(const QSize &size, Qt::AspectRatioMode aspectRatioMode = Qt::IgnoreAspectRatio) const;
+
+private:
+    static constexpr int MINLEVELSIZE = 16;
+
+    QVector<QImage> m_levels;
+    MemoryUsage m_memory{MemoryBudget::Category::SOURCEIMAGE};
+};
+
+using ImagePyramidPointer = std::shared_ptr<const ImagePyramid>;
+Q_DECLARE_METATYPE(ImagePyramidPointer)
+
+/*
+ * The ImagePyramidLoader calls ImagePyramid::load() on its own thread. It is used by the ImagePyramidCache.
+ */
+
+class ImagePyramidLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ImagePyramidLoader(const QString &filename, const QSize &maxSize, QObject *parent = nullptr);
+
+public slots:
+    void run();
+
+signals:
+    void finished(const QString &filename, ImagePyramidPointer pyramid);
+
+private:
+    QString m_filename;
+    QSize m_maxSize;
+};
+
+/*
+ * The ImagePyramidCache keeps the pyramids of the last MAXPYRAMIDS images, usually the image of the current puzzle and
+ * the image chosen in the new game widget. It must only be used from the GUI thread.
+ *
+ * find() returns the pyramid of an image, or nullptr if it isn't cached. request() returns it as well, but if it isn't
+ * cached, it is loaded on a worker thread and pyramidReady() is emitted when it is done. The pyramid is null if the
+ * image couldn't be loaded. insert() adds a pyramid that was loaded somewhere else, e.g. by the PuzzleSetupWorker.
+ *
+ * All images are loaded with the maxSize given to setMaxSize(). trim() drops all but the most recently used pyramids,
+ * it is called when the MemoryBudget runs low.
+ */
+
+class ImagePyramidCache : public QObject
+{
+    Q_OBJECT
+public:
+    static ImagePyramidCache* instance();
+
+    ImagePyramidPointer find(const QString &filename);
+    ImagePyramidPointer request(const QString &filename);
+    void insert(const QString &filename, ImagePyramidPointer pyramid);
+    void trim(int maxPyramids);
+
+    QSize maxSize() const;
+    void setMaxSize(const QSize &newMaxSize);
+
+signals:
+    void pyramidReady(const QString &filename);
+
+private:
+    static constexpr int MAXPYRAMIDS = 3;
+
+    explicit ImagePyramidCache(QObject* parent = nullptr);
+    ~ImagePyramidCache();
+
+    QHash<QString, ImagePyramidPointer> m_pyramids;
+    QStringList m_recentlyUsed;
+    QHash<QString, QPointer<QThread>> m_loading;
+    QSize m_maxSize;
+
+    void touch(const QString &filename);
+};
+
+#endif // IMAGE_PYRAMID_H
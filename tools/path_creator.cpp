@@ -1,9 +1,16 @@
 #include "path_creator.h"
+#include "core/shape_library.h"
+#include <QApplication>
+#include <QInputDialog>
+#include <QMessageBox>
 
 PathCreator::PathCreator(QWidget *parent)
     : QWidget{parent}
     , m_selectedPathPoint(-1)
     , m_selectedControlPoint(-1)
+    , m_validator(new PathValidator(this))
+    , m_validationTimer(new QTimer(this))
+    , m_liveValidation(false)
     , m_mainLayout(new QHBoxLayout(this))
     , m_leftSideWidget(new QWidget(this))
     , m_leftSideLayout(new QVBoxLayout(m_leftSideWidget))
@@ -85,7 +92,7 @@ PathCreator::PathCreator(QWidget *parent)
             m_testLabel1->setFixedSize(80, 80);
             m_testLabel2->setFixedSize(80, 80);
             m_testLabel3->setFixedSize(80, 80);
-            QPixmap pixmap(80, 80);
+            QPixmap pixmap(TESTSIZE);
             pixmap.fill();
             m_testLabel1->setPixmap(pixmap);
             m_testLabel2->setPixmap(pixmap);
@@ -104,9 +111,7 @@ PathCreator::PathCreator(QWidget *parent)
         m_leftSideLayout->addWidget(m_menuButtonsWidget2);
             m_menuButtonsLayout2->addWidget(m_menuButtonApply);
             m_menuButtonsLayout2->addWidget(m_menuButtonOpen);
-            m_menuButtonOpen->setEnabled(false);
             m_menuButtonsLayout2->addWidget(m_menuButtonSave);
-            m_menuButtonSave->setEnabled(false);
     m_mainLayout->addWidget(m_rightSideScrollArea);
         m_rightSideScrollArea->setWidget(m_rightSideWidget);
         m_rightSideScrollArea->setWidgetResizable(true);
@@ -143,6 +148,13 @@ PathCreator::PathCreator(QWidget *parent)
     QObject::connect(m_testButton, &QPushButton::clicked, this, &PathCreator::testButtonClicked);
 
     QObject::connect(m_menuButtonApply, &QPushButton::clicked, this, &PathCreator::applyButtonClicked);
+    QObject::connect(m_menuButtonOpen, &QPushButton::clicked, this, &PathCreator::openButtonClicked);
+    QObject::connect(m_menuButtonSave, &QPushButton::clicked, this, &PathCreator::saveButtonClicked);
+
+    m_validationTimer->setSingleShot(true);
+    m_validationTimer->setInterval(VALIDATIONDELAYMSECS);
+    QObject::connect(m_validationTimer, &QTimer::timeout, this, &PathCreator::startValidation);
+    QObject::connect(m_validator, &PathValidator::statisticsChanged, this, &PathCreator::validationStatisticsChanged);
 }
 
 PathCreator::~PathCreator()
@@ -162,12 +174,21 @@ void PathCreator::clicked(const QPoint &position)
             break;
         }
     }
+    if (m_selectedPathPoint == -1 && m_selectedControlPoint == -1) return;
+
+    // 拖动时只重绘受影响的部分，其余的部分缓存在背景中
+    selectDynamicPoints();
+    repaintCanvas();
 }
 
 void PathCreator::released()
 {
+    if (m_selectedPathPoint == -1 && m_selectedControlPoint == -1) return;
+
     m_selectedPathPoint = -1;
     m_selectedControlPoint = -1;
+    m_dynamicPoints.clear();
+    repaintCanvas();
 }
 
 void PathCreator::dragged(const QPoint &position)
@@ -178,13 +199,15 @@ void PathCreator::dragged(const QPoint &position)
 
     if (m_selectedPathPoint != -1) {
         m_customJigsawPath.setPositionPathPoint(m_selectedPathPoint, newPosition);
-        repaintCanvas();
-        updateWidgetsValue();
+        repaintDynamicLayer();
+        restartValidation();
+        updatePointWidgetsValue(m_selectedPathPoint);
     }
     if (m_selectedControlPoint != -1) {
         m_customJigsawPath.setPositionControlPoint(m_selectedControlPoint, newPosition);
-        repaintCanvas();
-        updateWidgetsValue();
+        repaintDynamicLayer();
+        restartValidation();
+        updateControlPointWidgetsValue(m_selectedControlPoint);
     }
 }
 
@@ -268,6 +291,7 @@ void PathCreator::inputFromWidgets()
     }
     synchronizeWidgetsWithCustomPuzzlePath();
     repaintCanvas();
+    restartValidation();
 }
 
 void PathCreator::insert()
@@ -282,23 +306,39 @@ void PathCreator::remove()
 
 void PathCreator::testButtonClicked()
 {
-    m_testResultLabel->setText("测试中...");
+    m_testQuality.clear();
+
+    if (m_testCheckBox->isChecked()) {
+        calculateRecommendedInnerBounds();
+        m_testQuality = " (质量: " + QString::number(m_customJigsawPath.recommendedInnerBoundsPercentage()) + ")";
+    }
 
-    QSize size(80, 80);
+    // 之后每次修改路径都会自动重新测试
+    m_liveValidation = true;
+    m_validationTimer->stop();
+    startValidation();
+}
 
-    QPixmap pixmap1(size);
-    pixmap1.fill();
-    QPainter painter1(&pixmap1);
-    QPixmap pixmap2(size);
-    pixmap2.fill();
-    QPainter painter2(&pixmap2);
-    QPixmap pixmap3(size);
-    pixmap3.fill();
-    QPainter painter3(&pixmap3);
+void PathCreator::calculateRecommendedInnerBounds()
+{
+    // 结果保存在路径中，修改路径之前不需要再计算
+    if (m_customJigsawPath.recommendedInnerBoundsPercentage() > 0) return;
 
-    QPoint outerBoundsTopLeft(0, 0);
-    QSize outerBoundsSize(size);
-    QRect outerBounds(outerBoundsTopLeft, outerBoundsSize);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    PuzzlePath jigsawPath(m_customJigsawPath.pathPoint(0).position.toPoint(),
+                          m_customJigsawPath.pathPoint(m_customJigsawPath.numberOfPoints() - 1).position.toPoint(),
+                          m_canvas->rect(), Jigsaw::TypeOfPiece::CUSTOM, m_customJigsawPath, true);
+    double ratio = jigsawPath.path().boundingRect().height() / jigsawPath.path().boundingRect().width();
+    double sizePercentage = 1.0 - 2 * ratio;
+    sizePercentage = sizePercentage <= 0.4 ? 0.4 : sizePercentage;
+    sizePercentage = PuzzlePath::calculateRecommendedInnerBoundsPercentage({Jigsaw::TypeOfPiece::CUSTOM}, QSize(100, 100), round(sizePercentage * 100), 4, m_customJigsawPath).at(0);
+    m_customJigsawPath.setRecommendedInnerBoundsPercentage(sizePercentage);
+    QApplication::restoreOverrideCursor();
+}
+
+void PathCreator::startValidation()
+{
+    m_testResultLabel->setText("测试中...");
 
     PuzzlePath jigsawPath(m_customJigsawPath.pathPoint(0).position.toPoint(),
                           m_customJigsawPath.pathPoint(m_customJigsawPath.numberOfPoints() - 1).position.toPoint(),
@@ -308,42 +348,55 @@ void PathCreator::testButtonClicked()
     double maxWidthPath = jigsawPath.path().boundingRect().width();
     double ratio = maxHeightPath / maxWidthPath;
 
-    double sizePercentage;
+    double sizePercentage = 1.0 - 3 * ratio;
+    sizePercentage = sizePercentage <= 0 ? 0.1 : sizePercentage;
 
-    if (m_testCheckBox->isChecked()) {
-        sizePercentage = 1.0 - 2 * ratio;
-        sizePercentage = sizePercentage <= 0.4 ? 0.4 : sizePercentage;
-        sizePercentage = PuzzlePath::calculateRecommendedInnerBoundsPercentage({Jigsaw::TypeOfPiece::CUSTOM}, QSize(100, 100), round(sizePercentage * 100), 4, m_customJigsawPath).at(0);
-    }
-    else {
-        sizePercentage = 1.0 - 3 * ratio;
-        sizePercentage = sizePercentage <= 0 ? 0.1 : sizePercentage;
-    }
+    QPoint outerBoundsTopLeft(0, 0);
+    QRect outerBounds(outerBoundsTopLeft, TESTSIZE);
 
     QPoint innerBoundsTopLeft = outerBoundsTopLeft + QPoint((1.0 - sizePercentage) / 2 * outerBounds.width(), (1.0 - sizePercentage) / 2 * outerBounds.height());
     QSize innerBoundsSize(sizePercentage * outerBounds.width(), sizePercentage * outerBounds.height());
     QRect innerBounds(innerBoundsTopLeft, innerBoundsSize);
 
-    QPainterPath path1 = PuzzlePath::singleJigsawPiecePath(outerBounds, innerBounds, Jigsaw::TypeOfPiece::CUSTOM, 4, false, m_customJigsawPath);
-    QPainterPath path2 = PuzzlePath::singleJigsawPiecePath(outerBounds, innerBounds, Jigsaw::TypeOfPiece::CUSTOM, 4, false, m_customJigsawPath);
-    QPainterPath path3 = PuzzlePath::singleJigsawPiecePath(outerBounds, innerBounds, Jigsaw::TypeOfPiece::CUSTOM, 4, false, m_customJigsawPath);
+    m_validator->start(m_customJigsawPath, outerBounds, innerBounds);
+}
+
+void PathCreator::restartValidation()
+{
+    if (!m_liveValidation) return;
 
-    painter1.setPen(Qt::black);
-    painter1.setBrush(Qt::gray);
-    painter1.drawPath(path1);
-    m_testLabel1->setPixmap(pixmap1);
+    // 拖动时路径变化很快，停止旧的测试，等路径稳定后再开始
+    m_validator->cancel();
+    m_validationTimer->start();
+}
 
-    painter2.setPen(Qt::black);
-    painter2.setBrush(Qt::gray);
-    painter2.drawPath(path2);
-    m_testLabel2->setPixmap(pixmap2);
+void PathCreator::validationStatisticsChanged(const PathValidator::Statistics &statistics)
+{
+    QVector<QLabel*> labels = {m_testLabel1, m_testLabel2, m_testLabel3};
+    for (int i = 0; i < labels.size() && i < statistics.samples.size(); ++i) {
+        showTestSample(labels[i], statistics.samples[i]);
+    }
 
-    painter3.setPen(Qt::black);
-    painter3.setBrush(Qt::gray);
-    painter3.drawPath(path3);
-    m_testLabel3->setPixmap(pixmap3);
+    if (statistics.pieces == 0 || statistics.attempts == 0 || statistics.edges == 0) return;
 
-    m_testResultLabel->setText(m_testCheckBox->isChecked() ? "完成! (质量: " + QString::number(sizePercentage) + ")" : "完成!");
+    QString text = statistics.finished ? "完成!" + m_testQuality : "测试中... " + QString::number(statistics.pieces) + "/" + QString::number(statistics.totalPieces);
+    text += "\n有效碎片: " + QString::number(100.0 * (statistics.pieces - statistics.invalidPieces) / statistics.pieces, 'f', 1) + "%";
+    text += "  平均尝试: " + QString::number(1.0 * statistics.attempts / statistics.pieces, 'f', 2);
+    text += "\n失败的边: " + QString::number(100.0 * statistics.failedEdges / statistics.edges, 'f', 1) + "%";
+    text += "  碰撞: " + QString::number(100.0 * statistics.collidingAttempts / statistics.attempts, 'f', 1) + "%";
+    m_testResultLabel->setText(text);
+}
+
+void PathCreator::showTestSample(QLabel *label, const QPainterPath &path)
+{
+    QPixmap pixmap(TESTSIZE);
+    pixmap.fill();
+    QPainter painter(&pixmap);
+    painter.setPen(Qt::black);
+    painter.setBrush(Qt::gray);
+    painter.drawPath(path);
+    painter.end();
+    label->setPixmap(pixmap);
 }
 
 void PathCreator::applyButtonClicked()
@@ -351,112 +404,242 @@ void PathCreator::applyButtonClicked()
     emit apply(m_customJigsawPath);
 }
 
-void PathCreator::repaintCanvas()
+void PathCreator::openButtonClicked()
 {
-    int distanceStartEnd = (m_customJigsawPath.pathPoint(m_customJigsawPath.numberOfPoints() - 1).position - m_customJigsawPath.pathPoint(0).position).manhattanLength();
+    QStringList names = ShapeLibrary::instance()->shapeNames();
+    if (names.isEmpty()) {
+        QMessageBox::information(this, "打开", "还没有保存的形状");
+        return;
+    }
 
-    QPixmap pixmap(m_canvas->size());
-    pixmap.fill();
+    bool ok = false;
+    QString name = QInputDialog::getItem(this, "打开形状", "形状:", names, 0, false, &ok);
+    if (!ok) return;
 
-    PuzzlePath jigsawPath(m_customJigsawPath.pathPoint(0).position.toPoint(),
-                          m_customJigsawPath.pathPoint(m_customJigsawPath.numberOfPoints() - 1).position.toPoint(),
-                          m_canvas->rect(), Jigsaw::TypeOfPiece::CUSTOM, m_customJigsawPath, true);
+    if (!ShapeLibrary::instance()->loadShape(name, m_customJigsawPath)) {
+        QMessageBox::critical(this, "打开失败", "无法读取形状: " + name);
+        return;
+    }
+    m_shapeName = name;
+    m_testQuality.clear();
+    synchronizeWidgetsWithPathPoints();
+}
 
-    QPainter painter(&pixmap);
-    painter.setBrush(Qt::transparent);
+void PathCreator::saveButtonClicked()
+{
+    bool ok = false;
+    QString name = QInputDialog::getText(this, "保存形状", "形状名称:", QLineEdit::Normal, m_shapeName, &ok).trimmed();
+    if (!ok) return;
+    if (!ShapeLibrary::isValidName(name)) {
+        QMessageBox::warning(this, "警告", "形状名称无效");
+        return;
+    }
+    if (name != m_shapeName && ShapeLibrary::instance()->shapeExists(name) &&
+        QMessageBox::question(this, "保存形状", "形状 " + name + " 已存在，要覆盖吗?") != QMessageBox::Yes) return;
+
+    // 内边界和形状一起保存，新游戏选择这个形状时不需要再计算
+    calculateRecommendedInnerBounds();
+    if (!ShapeLibrary::instance()->saveShape(name, m_customJigsawPath)) {
+        QMessageBox::critical(this, "保存失败", "无法保存形状: " + name);
+        return;
+    }
+    m_shapeName = name;
+}
+
+void PathCreator::repaintCanvas()
+{
+    double distanceStartEnd = startToEndDistance();
+
+    QPixmap background(m_canvas->size());
+    background.fill();
 
+    QPainter painter(&background);
+    painter.setBrush(Qt::transparent);
     for (int i = 0; i < m_customJigsawPath.numberOfPoints(); ++i) {
-        painter.setPen(QPen(Qt::lightGray, 5));
-        painter.drawPoint(m_customJigsawPath.pathPoint(i).position);
+        if (!isDynamicPoint(i)) drawPointDecorations(painter, i, distanceStartEnd);
+    }
+    for (int i = 1; i < m_customJigsawPath.numberOfPoints(); ++i) {
+        if (!isDynamicPoint(i)) drawSegment(painter, i);
+    }
+    painter.end();
 
-        if (i != 0 && i != m_customJigsawPath.numberOfPoints() - 1) {
-            painter.setPen(Qt::black);
-            painter.drawText(m_customJigsawPath.pathPoint(i).position + QPoint(0, -10), "P" + QString::number(i));
-        }
+    m_canvas->setLayers(background, dynamicLayer());
+}
 
-        switch (m_customJigsawPath.pathPoint(i).randomOffset.type) {
-        case CustomPuzzlePath::TypeOfRandomOffset::NONE: {
-            break;
-        }
-        case CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR: {
-            double value = 1.0 * m_customJigsawPath.pathPoint(i).randomOffset.value * distanceStartEnd / 100;
-            painter.setPen(QPen(Qt::red, 1));
-            painter.drawEllipse(QRectF(m_customJigsawPath.pathPoint(i).position - QPointF(value, value), QSizeF(value * 2, value * 2)));
-            break;
-        }
-        case CustomPuzzlePath::TypeOfRandomOffset::LINE: {
-            double value = 1.0 * m_customJigsawPath.pathPoint(i).randomOffset.value * distanceStartEnd / 100;
-            QLineF restrictionLine(*m_customJigsawPath.pathPoint(i).randomOffset.lineP1, *m_customJigsawPath.pathPoint(i).randomOffset.lineP2);
-            QLineF offsetLine1;
-            offsetLine1.setP1(m_customJigsawPath.pathPoint(i).position);
-            offsetLine1.setAngle(restrictionLine.angle());
-            offsetLine1.setLength(value);
-            QLineF offsetLine2;
-            offsetLine2.setP1(m_customJigsawPath.pathPoint(i).position);
-            offsetLine2.setAngle(restrictionLine.angle() - 180);
-            offsetLine2.setLength(value);
-            painter.setPen(QPen(Qt::red, 3));
-            painter.drawLine(offsetLine1);
-            painter.drawLine(offsetLine2);
-            break;
-        }
-        }
+void PathCreator::repaintDynamicLayer()
+{
+    m_canvas->setForeground(dynamicLayer());
+}
 
-        if (i == 0 || m_customJigsawPath.pathPoint(i).typeOfLine == CustomPuzzlePath::TypeOfLine::STRAIGHT) continue;
+QPicture PathCreator::dynamicLayer()
+{
+    double distanceStartEnd = startToEndDistance();
 
-        painter.setPen(QPen(Qt::lightGray, 5));
-        painter.drawPoint(m_customJigsawPath.pathPoint(i).positionControlPoint);
+    QPicture picture;
+    QPainter painter(&picture);
+    painter.setBrush(Qt::transparent);
+    for (int i = 0; i < m_dynamicPoints.size(); ++i) {
+        if (m_dynamicPoints[i]) drawPointDecorations(painter, i, distanceStartEnd);
+    }
+    for (int i = 1; i < m_dynamicPoints.size(); ++i) {
+        if (m_dynamicPoints[i]) drawSegment(painter, i);
+    }
+    painter.end();
+    return picture;
+}
+
+void PathCreator::drawPointDecorations(QPainter &painter, int index, double distanceStartEnd)
+{
+    const CustomPuzzlePath::PathPoint pathPoint = m_customJigsawPath.pathPoint(index);
+
+    painter.setPen(QPen(Qt::lightGray, 5));
+    painter.drawPoint(pathPoint.position);
+
+    if (index != 0 && index != m_customJigsawPath.numberOfPoints() - 1) {
         painter.setPen(Qt::black);
-        painter.drawText(m_customJigsawPath.pathPoint(i).positionControlPoint + QPoint(0, -10), "C" + QString::number(i));
+        painter.drawText(pathPoint.position + QPoint(0, -10), "P" + QString::number(index));
+    }
 
-        switch (m_customJigsawPath.pathPoint(i).randomOffsetControlPoint.type) {
-        case CustomPuzzlePath::TypeOfRandomOffset::NONE: {
-            break;
-        }
-        case CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR: {
-            double value = 1.0 * m_customJigsawPath.pathPoint(i).randomOffsetControlPoint.value * distanceStartEnd / 100;
-            painter.setPen(QPen(Qt::red, 1));
-            painter.drawEllipse(QRectF(m_customJigsawPath.pathPoint(i).positionControlPoint - QPointF(value, value), QSizeF(value * 2, value * 2)));
-            break;
-        }
-        case CustomPuzzlePath::TypeOfRandomOffset::LINE: {
-            double value = 1.0 * m_customJigsawPath.pathPoint(i).randomOffsetControlPoint.value * distanceStartEnd / 100;
-            QLineF restrictionLine(*m_customJigsawPath.pathPoint(i).randomOffsetControlPoint.lineP1, *m_customJigsawPath.pathPoint(i).randomOffsetControlPoint.lineP2);
-            QLineF offsetLine1;
-            offsetLine1.setP1(m_customJigsawPath.pathPoint(i).positionControlPoint);
-            offsetLine1.setAngle(restrictionLine.angle());
-            offsetLine1.setLength(value);
-            QLineF offsetLine2;
-            offsetLine2.setP1(m_customJigsawPath.pathPoint(i).positionControlPoint);
-            offsetLine2.setAngle(restrictionLine.angle() - 180);
-            offsetLine2.setLength(value);
-            painter.setPen(QPen(Qt::red, 3));
-            painter.drawLine(offsetLine1);
-            painter.drawLine(offsetLine2);
-            break;
-        }
-        }
+    switch (pathPoint.randomOffset.type) {
+    case CustomPuzzlePath::TypeOfRandomOffset::NONE: {
+        break;
+    }
+    case CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR: {
+        double value = 1.0 * pathPoint.randomOffset.value * distanceStartEnd / 100;
+        painter.setPen(QPen(Qt::red, 1));
+        painter.drawEllipse(QRectF(pathPoint.position - QPointF(value, value), QSizeF(value * 2, value * 2)));
+        break;
+    }
+    case CustomPuzzlePath::TypeOfRandomOffset::LINE: {
+        double value = 1.0 * pathPoint.randomOffset.value * distanceStartEnd / 100;
+        QLineF restrictionLine(*pathPoint.randomOffset.lineP1, *pathPoint.randomOffset.lineP2);
+        QLineF offsetLine1;
+        offsetLine1.setP1(pathPoint.position);
+        offsetLine1.setAngle(restrictionLine.angle());
+        offsetLine1.setLength(value);
+        QLineF offsetLine2;
+        offsetLine2.setP1(pathPoint.position);
+        offsetLine2.setAngle(restrictionLine.angle() - 180);
+        offsetLine2.setLength(value);
+        painter.setPen(QPen(Qt::red, 3));
+        painter.drawLine(offsetLine1);
+        painter.drawLine(offsetLine2);
+        break;
+    }
+    }
+
+    if (index == 0 || pathPoint.typeOfLine == CustomPuzzlePath::TypeOfLine::STRAIGHT) return;
 
-        painter.setPen(QPen(Qt::darkGray, 1));
-        painter.drawLine(m_customJigsawPath.pathPoint(i).positionControlPoint, m_customJigsawPath.pathPoint(i).position);
-        painter.drawLine(m_customJigsawPath.pathPoint(i).positionControlPoint, m_customJigsawPath.pathPoint(i - 1).position);
+    painter.setPen(QPen(Qt::lightGray, 5));
+    painter.drawPoint(pathPoint.positionControlPoint);
+    painter.setPen(Qt::black);
+    painter.drawText(pathPoint.positionControlPoint + QPoint(0, -10), "C" + QString::number(index));
+
+    switch (pathPoint.randomOffsetControlPoint.type) {
+    case CustomPuzzlePath::TypeOfRandomOffset::NONE: {
+        break;
+    }
+    case CustomPuzzlePath::TypeOfRandomOffset::CIRCULAR: {
+        double value = 1.0 * pathPoint.randomOffsetControlPoint.value * distanceStartEnd / 100;
+        painter.setPen(QPen(Qt::red, 1));
+        painter.drawEllipse(QRectF(pathPoint.positionControlPoint - QPointF(value, value), QSizeF(value * 2, value * 2)));
+        break;
+    }
+    case CustomPuzzlePath::TypeOfRandomOffset::LINE: {
+        double value = 1.0 * pathPoint.randomOffsetControlPoint.value * distanceStartEnd / 100;
+        QLineF restrictionLine(*pathPoint.randomOffsetControlPoint.lineP1, *pathPoint.randomOffsetControlPoint.lineP2);
+        QLineF offsetLine1;
+        offsetLine1.setP1(pathPoint.positionControlPoint);
+        offsetLine1.setAngle(restrictionLine.angle());
+        offsetLine1.setLength(value);
+        QLineF offsetLine2;
+        offsetLine2.setP1(pathPoint.positionControlPoint);
+        offsetLine2.setAngle(restrictionLine.angle() - 180);
+        offsetLine2.setLength(value);
+        painter.setPen(QPen(Qt::red, 3));
+        painter.drawLine(offsetLine1);
+        painter.drawLine(offsetLine2);
+        break;
+    }
     }
 
+    painter.setPen(QPen(Qt::darkGray, 1));
+    painter.drawLine(pathPoint.positionControlPoint, pathPoint.position);
+    painter.drawLine(pathPoint.positionControlPoint, m_customJigsawPath.pathPoint(index - 1).position);
+}
+
+void PathCreator::drawSegment(QPainter &painter, int index)
+{
+    const CustomPuzzlePath::PathPoint pathPoint = m_customJigsawPath.pathPoint(index);
+
+    QPainterPath segment(m_customJigsawPath.pathPoint(index - 1).position);
+    pathPoint.typeOfLine == CustomPuzzlePath::TypeOfLine::STRAIGHT
+            ? segment.lineTo(pathPoint.position)
+            : segment.quadTo(pathPoint.positionControlPoint, pathPoint.position);
     painter.setPen(QPen(Qt::black, 3));
-    painter.drawPath(jigsawPath.path());
-    m_canvas->setPixmap(pixmap);
+    painter.drawPath(segment);
 }
 
-void PathCreator::updateWidgetsValue()
+double PathCreator::startToEndDistance() const
 {
-    for (int i = 0; i < m_customJigsawPath.numberOfPoints(); ++i) {
-        m_pointsXSpinBox[i]->setValue(m_customJigsawPath.pathPoint(i).position.x());
-        m_pointsYSpinBox[i]->setValue(m_customJigsawPath.pathPoint(i).position.y());
-        if (i == 0) continue;
+    return (m_customJigsawPath.pathPoint(m_customJigsawPath.numberOfPoints() - 1).position - m_customJigsawPath.pathPoint(0).position).manhattanLength();
+}
 
-        m_controlPointsXSpinBox[i - 1]->setValue(m_customJigsawPath.pathPoint(i).positionControlPoint.x());
-        m_controlPointsYSpinBox[i - 1]->setValue(m_customJigsawPath.pathPoint(i).positionControlPoint.y());
+bool PathCreator::isDynamicPoint(int index) const
+{
+    return index < m_dynamicPoints.size() && m_dynamicPoints[index];
+}
+
+void PathCreator::selectDynamicPoints()
+{
+    m_dynamicPoints.fill(false, m_customJigsawPath.numberOfPoints());
+
+    int index = m_selectedPathPoint != -1 ? m_selectedPathPoint : m_selectedControlPoint;
+    if (index < 0 || index >= m_dynamicPoints.size()) {
+        m_dynamicPoints.clear();
+        return;
     }
+
+    // 起点和终点决定了所有随机偏移的大小
+    if (m_selectedPathPoint == 0 || m_selectedPathPoint == m_dynamicPoints.size() - 1) {
+        m_dynamicPoints.fill(true);
+        return;
+    }
+
+    // 拖动的点，以及画线用到这个点的其他点
+    QPointF* movedPoint = m_selectedPathPoint != -1 ? m_customJigsawPath.positionPathPoint(index) : m_customJigsawPath.positionControlPoint(index);
+    m_dynamicPoints[index] = true;
+    if (m_selectedPathPoint != -1 && index + 1 < m_dynamicPoints.size()) m_dynamicPoints[index + 1] = true;
+    for (int i = 0; i < m_dynamicPoints.size(); ++i) {
+        const CustomPuzzlePath::PathPoint pathPoint = m_customJigsawPath.pathPoint(i);
+        if ((pathPoint.randomOffset.type == CustomPuzzlePath::TypeOfRandomOffset::LINE &&
+             (pathPoint.randomOffset.lineP1 == movedPoint || pathPoint.randomOffset.lineP2 == movedPoint)) ||
+            (pathPoint.randomOffsetControlPoint.type == CustomPuzzlePath::TypeOfRandomOffset::LINE &&
+             (pathPoint.randomOffsetControlPoint.lineP1 == movedPoint || pathPoint.randomOffsetControlPoint.lineP2 == movedPoint))) {
+            m_dynamicPoints[i] = true;
+        }
+    }
+}
+
+void PathCreator::updatePointWidgetsValue(int index)
+{
+    if (index < 0 || index >= m_pointsXSpinBox.size()) return;
+
+    // 只更新拖动的点，不触发 inputFromWidgets()
+    QSignalBlocker blockerX(m_pointsXSpinBox[index]);
+    QSignalBlocker blockerY(m_pointsYSpinBox[index]);
+    m_pointsXSpinBox[index]->setValue(m_customJigsawPath.pathPoint(index).position.x());
+    m_pointsYSpinBox[index]->setValue(m_customJigsawPath.pathPoint(index).position.y());
+}
+
+void PathCreator::updateControlPointWidgetsValue(int index)
+{
+    if (index <= 0 || index > m_controlPointsXSpinBox.size()) return;
+
+    QSignalBlocker blockerX(m_controlPointsXSpinBox[index - 1]);
+    QSignalBlocker blockerY(m_controlPointsYSpinBox[index - 1]);
+    m_controlPointsXSpinBox[index - 1]->setValue(m_customJigsawPath.pathPoint(index).positionControlPoint.x());
+    m_controlPointsYSpinBox[index - 1]->setValue(m_customJigsawPath.pathPoint(index).positionControlPoint.y());
 }
 
 void PathCreator::synchronizeWidgetsWithCustomPuzzlePath()
@@ -701,6 +884,7 @@ void PathCreator::addPathPoint(int index, bool calculateValues, bool isStartingP
         synchronizeWidgetsWithCustomPuzzlePath();
         updateInsertRemoveComboBoxes();
         repaintCanvas();
+        restartValidation();
     }
 }
 
@@ -708,16 +892,25 @@ void PathCreator::removePathPoint(int index)
 {
     if (m_customJigsawPath.numberOfPoints() <= 2) return;
 
+    if (index <= 0 || index >= m_customJigsawPath.numberOfPoints() - 1) index = m_customJigsawPath.numberOfPoints() - 2;
+
+    m_customJigsawPath.removePoint(index);
+    removePathPointFromWidget();
+
+    synchronizeWidgetsWithCustomPuzzlePath();
+    updateInsertRemoveComboBoxes();
+    repaintCanvas();
+    restartValidation();
+}
+
+void PathCreator::removePathPointFromWidget()
+{
     if (m_rightSideLayout->count() != 0) {
         QLayoutItem* item = m_rightSideLayout->takeAt(m_rightSideLayout->count() - 1);
         m_rightSideLayout->removeItem(item);
         delete item;
     }
 
-    if (index <= 0 || index >= m_customJigsawPath.numberOfPoints() - 1) index = m_customJigsawPath.numberOfPoints() - 2;
-
-    m_customJigsawPath.removePoint(index);
-
     for (int i = 0; i < WIDGETSPERPATHPOINT; ++i) {
         m_rightSideLayout->removeWidget(m_entriesWidget.last());
         m_entriesWidget.last()->hide();
@@ -764,11 +957,24 @@ void PathCreator::removePathPoint(int index)
     m_controlPointsRestrictionButton.pop_back();
 
     m_rightSideLayout->addStretch();
+}
+
+void PathCreator::synchronizeWidgetsWithPathPoints()
+{
+    m_selectedPathPoint = -1;
+    m_selectedControlPoint = -1;
+    m_dynamicPoints.clear();
 
+    // 只调整行数，点已经在路径中
+    while (m_pointsLabel.size() > m_customJigsawPath.numberOfPoints()) removePathPointFromWidget();
+    while (m_pointsLabel.size() < m_customJigsawPath.numberOfPoints()) addPathPoint(-1, false);
 
+    // 下拉框的内容来自标签，标签来自同步，所以同步两次
     synchronizeWidgetsWithCustomPuzzlePath();
     updateInsertRemoveComboBoxes();
+    synchronizeWidgetsWithCustomPuzzlePath();
     repaintCanvas();
+    restartValidation();
 }
 
 void PathCreator::addPointToWidget()
@@ -2,6 +2,7 @@
 #define PATH_CREATOR_H
 
 #include "creator_canvas.h"
+#include "path_validator.h"
 #include "components/puzzle_path.h"
 #include "components/custom_puzzle_path.h"
 #include <QWidget>
@@ -13,6 +14,8 @@
 #include <QSpinBox>
 #include <QCheckBox>
 #include <QScrollArea>
+#include <QTimer>
+#include <QPicture>
 
 class PathCreator : public QWidget
 {
@@ -25,6 +28,8 @@ class PathCreator : public QWidget
     const QPoint START = QPoint(10, 150);
     const QPoint END = QPoint(290, 150);
     const QPoint MIDDLE = START + (END - START) / 2;
+    const QSize TESTSIZE = QSize(80, 80);
+    const int VALIDATIONDELAYMSECS = 200;
 public:
     explicit PathCreator(QWidget *parent = nullptr);
     ~PathCreator();
@@ -40,6 +45,9 @@ public slots:
     void remove();
     void testButtonClicked();
     void applyButtonClicked();
+    void openButtonClicked();
+    void saveButtonClicked();
+    void validationStatisticsChanged(const PathValidator::Statistics &statistics);
 
 signals:
     void apply(const CustomPuzzlePath &customJigsawPath);
@@ -62,6 +70,13 @@ private:
     CustomPuzzlePath m_customJigsawPath;
     int m_selectedPathPoint;
     int m_selectedControlPoint;
+    QVector<bool> m_dynamicPoints;
+
+    PathValidator* m_validator;
+    QTimer* m_validationTimer;
+    bool m_liveValidation;
+    QString m_testQuality;
+    QString m_shapeName;
 
     QHBoxLayout* m_mainLayout;
         QWidget* m_leftSideWidget;
@@ -132,14 +147,28 @@ private:
                 QVector<QPushButton*> m_controlPointsRestrictionButton;
 
     void repaintCanvas();
-    void updateWidgetsValue();
+    void repaintDynamicLayer();
+    QPicture dynamicLayer();
+    void drawPointDecorations(QPainter &painter, int index, double distanceStartEnd);
+    void drawSegment(QPainter &painter, int index);
+    double startToEndDistance() const;
+    bool isDynamicPoint(int index) const;
+    void selectDynamicPoints();
+    void calculateRecommendedInnerBounds();
+    void startValidation();
+    void restartValidation();
+    void showTestSample(QLabel* label, const QPainterPath &path);
+    void updatePointWidgetsValue(int index);
+    void updateControlPointWidgetsValue(int index);
     void synchronizeWidgetsWithCustomPuzzlePath();
+    void synchronizeWidgetsWithPathPoints();
     void updateInsertRemoveComboBoxes();
     QPointF* qStringToQPointFPointer(const QString &text);
     QString qPointFPointerToQString(QPointF* point);
 
     void addPathPoint(int index = -1, bool calculateValues = true, bool isStartingPoint = false);
     void removePathPoint(int index);
+    void removePathPointFromWidget();
 
     void addPointToWidget();
     void addPointRestrictionToWidget();
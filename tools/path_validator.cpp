@@ -0,0 +1,149 @@
+#include "path_validator.h"
+#include "components/puzzle_path.h"
+#include <QThread>
+#include <QMutexLocker>
+#include <random>
+
+PathValidator::PathValidator(QObject *parent)
+    : QObject{parent}
+    , m_timer(new QTimer(this))
+{
+    // 留一个核心给界面线程
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_timer->setInterval(UPDATEMSECS);
+    QObject::connect(m_timer, &QTimer::timeout, this, &PathValidator::update);
+}
+
+PathValidator::~PathValidator()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void PathValidator::start(const CustomPuzzlePath &customPath, const QRect &outerBounds, const QRect &innerBounds)
+{
+    cancel();
+
+    std::shared_ptr<Run> run = std::make_shared<Run>();
+    m_run = run;
+
+    std::random_device randomDevice;
+    unsigned int seed = randomDevice();
+    for (int i = 0; i < NUMBEROFBATCHES; ++i) {
+        // 每一批都有自己的种子，线程池中的线程不会生成相同的碎片
+        m_pool.start([run, customPath, outerBounds, innerBounds, batchSeed = seed + i]() {
+            runBatch(*run, customPath, outerBounds, innerBounds, batchSeed);
+            run->finishedBatches.fetch_add(1);
+        });
+    }
+    m_timer->start();
+}
+
+void PathValidator::cancel()
+{
+    if (!m_run) return;
+
+    // 还没开始的批次直接移除，正在运行的批次在下一个碎片之前停止
+    m_run->cancelled.store(true);
+    m_pool.clear();
+    m_run.reset();
+    m_timer->stop();
+}
+
+bool PathValidator::isRunning() const
+{
+    return m_run != nullptr;
+}
+
+void PathValidator::runBatch(Run &run, const CustomPuzzlePath &customPath, const QRect &outerBounds, const QRect &innerBounds, unsigned int seed)
+{
+    Jigsaw::setRandomSeed(seed);
+
+    QPoint topLeft, topRight, bottomRight, bottomLeft;
+    QRect topBounds(outerBounds.topLeft(), QPoint(outerBounds.right(), innerBounds.top()));
+    QRect rightBounds(QPoint(innerBounds.right(), outerBounds.top()), outerBounds.bottomRight());
+    QRect bottomBounds(QPoint(outerBounds.left(), innerBounds.bottom()), outerBounds.bottomRight());
+    QRect leftBounds(outerBounds.topLeft(), QPoint(innerBounds.left(), outerBounds.bottom()));
+    QVector<PuzzlePath> jigsawPaths(4);
+
+    for (int piece = 0; piece < PIECESPERBATCH; ++piece) {
+        if (run.cancelled.load(std::memory_order_relaxed)) return;
+
+        int attempts = 0;
+        int unsuccessful = 0;
+        bool collision = false;
+
+        do {
+            topLeft = QPoint(Jigsaw::randomNumber(outerBounds.left(), innerBounds.left()), Jigsaw::randomNumber(outerBounds.top(), innerBounds.top()));
+            topRight = QPoint(Jigsaw::randomNumber(innerBounds.right(), outerBounds.right()), Jigsaw::randomNumber(outerBounds.top(), innerBounds.top()));
+            bottomRight = QPoint(Jigsaw::randomNumber(innerBounds.right(), outerBounds.right()), Jigsaw::randomNumber(innerBounds.bottom(), outerBounds.bottom()));
+            bottomLeft = QPoint(Jigsaw::randomNumber(outerBounds.left(), innerBounds.left()), Jigsaw::randomNumber(innerBounds.bottom(), outerBounds.bottom()));
+
+            jigsawPaths[0] = PuzzlePath(topLeft, topRight, topBounds, Jigsaw::TypeOfPiece::CUSTOM, customPath);
+            jigsawPaths[1] = PuzzlePath(topRight, bottomRight, rightBounds, Jigsaw::TypeOfPiece::CUSTOM, customPath);
+            jigsawPaths[2] = PuzzlePath(bottomRight, bottomLeft, bottomBounds, Jigsaw::TypeOfPiece::CUSTOM, customPath);
+            jigsawPaths[3] = PuzzlePath(bottomLeft, topLeft, leftBounds, Jigsaw::TypeOfPiece::CUSTOM, customPath);
+
+            unsuccessful = 0;
+            collision = false;
+            for (int i = 0; i < jigsawPaths.size(); ++i) {
+                unsuccessful += jigsawPaths[i].creatingPathSuccessful() ? 0 : 1;
+                for (int j = i + 1; j < jigsawPaths.size() && !collision; ++j) {
+                    collision = jigsawPaths[i].path().intersected(jigsawPaths[j].path()).elementCount() > 0;
+                }
+            }
+
+            ++attempts;
+            run.edges.fetch_add(jigsawPaths.size(), std::memory_order_relaxed);
+            run.failedEdges.fetch_add(unsuccessful, std::memory_order_relaxed);
+            if (collision) run.collidingAttempts.fetch_add(1, std::memory_order_relaxed);
+        }
+        while ((unsuccessful > 0 || collision) && attempts < MAXATTEMPTS);
+
+        run.attempts.fetch_add(attempts, std::memory_order_relaxed);
+        if (unsuccessful > 0 || collision) run.invalidPieces.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            QMutexLocker locker(&run.samplesMutex);
+            if (run.samples.size() < NUMBEROFSAMPLES) {
+                QPainterPath path = jigsawPaths[0].path();
+                path.connectPath(jigsawPaths[1].path());
+                path.connectPath(jigsawPaths[2].path());
+                path.connectPath(jigsawPaths[3].path());
+                run.samples.push_back(path);
+            }
+        }
+        run.pieces.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+PathValidator::Statistics PathValidator::statistics() const
+{
+    Statistics statistics;
+    if (!m_run) return statistics;
+
+    statistics.pieces = m_run->pieces.load(std::memory_order_relaxed);
+    statistics.totalPieces = NUMBEROFBATCHES * PIECESPERBATCH;
+    statistics.attempts = m_run->attempts.load(std::memory_order_relaxed);
+    statistics.edges = m_run->edges.load(std::memory_order_relaxed);
+    statistics.failedEdges = m_run->failedEdges.load(std::memory_order_relaxed);
+    statistics.collidingAttempts = m_run->collidingAttempts.load(std::memory_order_relaxed);
+    statistics.invalidPieces = m_run->invalidPieces.load(std::memory_order_relaxed);
+    statistics.finished = m_run->finishedBatches.load() == NUMBEROFBATCHES;
+
+    QMutexLocker locker(&m_run->samplesMutex);
+    statistics.samples = m_run->samples;
+    return statistics;
+}
+
+void PathValidator::update()
+{
+    if (!m_run) return;
+
+    Statistics currentStatistics = statistics();
+    if (currentStatistics.finished) {
+        m_timer->stop();
+        m_run.reset();
+    }
+    emit statisticsChanged(currentStatistics);
+}
@@ -0,0 +1,87 @@
+#ifndef PATH_VALIDATOR_H
+#define PATH_VALIDATOR_H
+
+#include "components/custom_puzzle_path.h"
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QRect>
+#include <QPainterPath>
+#include <QVector>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+
+/*
+ * The PathValidator estimates how well a CustomPuzzlePath works in a real puzzle. It generates thousands of random
+ * pieces from the path on its own QThreadPool, the same way PuzzlePath::singleJigsawPiecePath() does: four random
+ * corners, four edges between outer and inner bounds, and new attempts until no edge had to fall back to a simpler path
+ * and no edges collide, up to MAXATTEMPTS.
+ *
+ * start() cancels the current run and starts a new one. The work is split into NUMBEROFBATCHES batches of PIECESPERBATCH
+ * pieces. Batches that weren't started yet are removed from the pool, running batches check the cancel flag after every
+ * piece, so restarting is cheap and can be done after every edit. The threads only update atomic counters. Every
+ * UPDATEMSECS the counters are read on the GUI thread and statisticsChanged() is emitted, the last time with finished
+ * set. The first pieces are kept as samples to show them to the user.
+ */
+
+class PathValidator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics {
+        int pieces = 0;
+        int totalPieces = 0;
+        int attempts = 0;
+        int edges = 0;
+        int failedEdges = 0;
+        int collidingAttempts = 0;
+        int invalidPieces = 0;
+        bool finished = false;
+        QVector<QPainterPath> samples;
+    };
+
+    explicit PathValidator(QObject *parent = nullptr);
+    ~PathValidator();
+
+    void start(const CustomPuzzlePath &customPath, const QRect &outerBounds, const QRect &innerBounds);
+    void cancel();
+    bool isRunning() const;
+
+    static constexpr int NUMBEROFSAMPLES = 3;
+
+signals:
+    void statisticsChanged(const PathValidator::Statistics &statistics);
+
+private:
+    static constexpr int NUMBEROFBATCHES = 64;
+    static constexpr int PIECESPERBATCH = 64;
+    static constexpr int MAXATTEMPTS = 50;
+    static constexpr int UPDATEMSECS = 100;
+
+    struct Run {
+        std::atomic_bool cancelled{false};
+        std::atomic_int finishedBatches{0};
+        std::atomic_int pieces{0};
+        std::atomic_int attempts{0};
+        std::atomic_int edges{0};
+        std::atomic_int failedEdges{0};
+        std::atomic_int collidingAttempts{0};
+        std::atomic_int invalidPieces{0};
+        QMutex samplesMutex;
+        QVector<QPainterPath> samples;
+    };
+
+    QThreadPool m_pool;
+    QTimer* m_timer;
+    std::shared_ptr<Run> m_run;
+
+    static void runBatch(Run &run, const CustomPuzzlePath &customPath, const QRect &outerBounds, const QRect &innerBounds, unsigned int seed);
+    Statistics statistics() const;
+
+private slots:
+    void update();
+};
+
+#endif // PATH_VALIDATOR_H
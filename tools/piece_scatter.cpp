@@ -0,0 +1,89 @@
+#include "piece_scatter.h"
+#include "core/jigsaw_types.h"
+#include <QtMath>
+#include <utility>
+
+QVector<QPointF> PieceScatter::scatter(int numberOfPieces, const QSize &pieceSize, const QRect &board, const QRect &freeArea)
+{
+    QVector<QPointF> positions(qMax(0, numberOfPieces));
+    if (numberOfPieces <= 0 || pieceSize.isEmpty()) return positions;
+
+    // 开始时每个碎片分到的面积一样大，不够放时逐步缩小格子
+    double boardArea = 1.0 * board.width() * board.height();
+    QRect blockedArea = board.intersected(freeArea);
+    double availableArea = boardArea - 1.0 * blockedArea.width() * blockedArea.height();
+    double scale = qMax(1.0, qSqrt(availableArea / numberOfPieces / pieceSize.width() / pieceSize.height()));
+
+    QSize cellSize;
+    QVector<QRect> cells;
+    for (int step = 0; step <= MAXSHRINKSTEPS; ++step) {
+        if (step == MAXSHRINKSTEPS) scale = 1.0;
+        cellSize = QSize(qCeil(pieceSize.width() * scale), qCeil(pieceSize.height() * scale));
+        cells = availableCells(cellSize, board, freeArea);
+        if (cells.size() >= numberOfPieces || scale == 1.0) break;
+        scale = qMax(1.0, scale * SHRINKFACTOR);
+    }
+
+    // 空闲区域外放不下任何一个碎片时，放在整个棋盘上
+    if (cells.isEmpty()) cells = availableCells(cellSize, board, QRect());
+    if (cells.isEmpty()) cells.push_back(QRect(board.topLeft(), cellSize));
+
+    // 打乱格子，相邻的碎片不会放在一起
+    for (int i = cells.size() - 1; i > 0; --i) {
+        std::swap(cells[i], cells[Jigsaw::randomNumber(0, i)]);
+    }
+
+    for (int i = 0; i < numberOfPieces; ++i) {
+        const QRect &cell = cells[i % cells.size()];
+        int x = cell.left() + Jigsaw::randomNumber(0, cell.width() - pieceSize.width());
+        int y = cell.top() + Jigsaw::randomNumber(0, cell.height() - pieceSize.height());
+        positions[i] = QPointF(x, y);
+    }
+    return positions;
+}
+
+/*
+ * Returns the screen enlarged around its center until there is a cell of pieceSize outside of freeArea for every
+ * piece. The board is estimated from the area the pieces need and then grown by GROWFACTOR until the cells are
+ * enough, which usually takes no more than one or two steps.
+ */
+
+QRect PieceScatter::boardFor(int numberOfPieces, const QSize &pieceSize, const QRect &screen, const QRect &freeArea)
+{
+    if (numberOfPieces <= 0 || pieceSize.isEmpty() || screen.isEmpty()) return screen;
+
+    QRect blockedArea = screen.intersected(freeArea);
+    double neededArea = 1.0 * numberOfPieces * pieceSize.width() * pieceSize.height() + 1.0 * blockedArea.width() * blockedArea.height();
+    double scale = qMax(1.0, qSqrt(neededArea / screen.width() / screen.height()));
+
+    QRect board = screen;
+    while (true) {
+        QSize size(qCeil(screen.width() * scale), qCeil(screen.height() * scale));
+        board = QRect(QPoint(0, 0), size);
+        board.moveCenter(screen.center());
+        if (availableCells(pieceSize, board, freeArea).size() >= numberOfPieces) break;
+        scale *= GROWFACTOR;
+    }
+    return board;
+}
+
+/*
+ * Returns the cells of a grid over the board that lie completely on the board and don't intersect freeArea.
+ */
+
+QVector<QRect> PieceScatter::availableCells(const QSize &cellSize, const QRect &board, const QRect &freeArea)
+{
+    QVector<QRect> cells;
+    int cols = board.width() / cellSize.width();
+    int rows = board.height() / cellSize.height();
+    if (cols <= 0 || rows <= 0) return cells;
+
+    cells.reserve(cols * rows);
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            QRect cell(board.topLeft() + QPoint(col * cellSize.width(), row * cellSize.height()), cellSize);
+            if (!cell.intersects(freeArea)) cells.push_back(cell);
+        }
+    }
+    return cells;
+}
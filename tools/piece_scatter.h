@@ -0,0 +1,44 @@
+#ifndef PIECE_SCATTER_H
+#define PIECE_SCATTER_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRect>
+#include <QSize>
+
+/*
+ * PieceScatter spreads the pieces of a new puzzle over the board, outside of the free area that is kept for putting
+ * the puzzle together. The board is divided into a grid of cells that are at least as large as a piece. Every piece
+ * gets its own cell and is put at a random position inside of it (jittered stratified placement), so pieces neither
+ * overlap nor pile up, but still don't look lined up.
+ *
+ * The cells start as large as the area outside of the free area allows for the number of pieces and are shrunk until
+ * there are enough cells that don't touch the free area. This takes at most MAXSHRINKSTEPS steps, after that the cells
+ * have the size of a piece. Only if the board is too small even then, several pieces share a cell. If no cell is
+ * left outside of the free area, the free area is ignored.
+ *
+ * boardFor() returns a board that is large enough for a cell of the size of a piece for every piece. It is the screen,
+ * enlarged around its center with the same aspect ratio, so large puzzles are scattered around the free area instead
+ * of piling up on the screen. The board is zoomed out until it fits into the window after the puzzle was set up.
+ *
+ * The cells are shuffled before they are handed out, so neighbors in the puzzle don't end up next to each other. All
+ * random numbers come from Jigsaw::randomNumber(), so the positions only depend on the seed of the thread.
+ */
+
+class PieceScatter
+{
+public:
+    static QVector<QPointF> scatter(int numberOfPieces, const QSize &pieceSize, const QRect &board, const QRect &freeArea);
+    static QRect boardFor(int numberOfPieces, const QSize &pieceSize, const QRect &screen, const QRect &freeArea);
+
+private:
+    static constexpr int MAXSHRINKSTEPS = 32;
+    static constexpr double SHRINKFACTOR = 0.9;
+    static constexpr double GROWFACTOR = 1.1;
+
+    PieceScatter() = delete;
+
+    static QVector<QRect> availableCells(const QSize &cellSize, const QRect &board, const QRect &freeArea);
+};
+
+#endif // PIECE_SCATTER_H
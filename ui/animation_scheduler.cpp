@@ -0,0 +1,134 @@
+#include "animation_scheduler.h"
+#include <QCoreApplication>
+
+AnimationScheduler::AnimationScheduler(QObject *parent)
+    : QObject{parent}
+    , m_timer(new QTimer(this))
+    , m_nextID(1)
+{
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(FRAMEMSECS);
+    m_clock.start();
+    QObject::connect(m_timer, &QTimer::timeout, this, &AnimationScheduler::tick);
+}
+
+AnimationScheduler *AnimationScheduler::instance()
+{
+    // 随应用程序一起销毁
+    static QPointer<AnimationScheduler> scheduler;
+    if (!scheduler) scheduler = new AnimationScheduler(QCoreApplication::instance());
+    return scheduler;
+}
+
+int AnimationScheduler::animate(QObject *owner, double from, double to, int durationMSecs, const std::function<void (double)> &update,
+                                Easing easing, const std::function<void ()> &finished)
+{
+    if (durationMSecs <= 0) {
+        if (update) update(to);
+        if (finished) finished();
+        return 0;
+    }
+
+    Animation animation;
+    animation.owner = owner;
+    animation.from = from;
+    animation.to = to;
+    animation.startMSecs = m_clock.elapsed();
+    animation.durationMSecs = durationMSecs;
+    animation.easing = easing;
+    animation.update = update;
+    animation.finished = finished;
+    return add(animation);
+}
+
+int AnimationScheduler::onFrame(QObject *owner, const std::function<bool ()> &frame)
+{
+    Animation animation;
+    animation.owner = owner;
+    animation.startMSecs = m_clock.elapsed();
+    animation.frame = frame;
+    return add(animation);
+}
+
+void AnimationScheduler::stop(int id)
+{
+    int index = indexOf(id);
+    if (index >= 0) m_animations.removeAt(index);
+    if (m_animations.isEmpty()) m_timer->stop();
+}
+
+bool AnimationScheduler::isRunning(int id) const
+{
+    return indexOf(id) >= 0;
+}
+
+double AnimationScheduler::ease(Easing easing, double progress)
+{
+    progress = qBound(0.0, progress, 1.0);
+    switch (easing) {
+    case Easing::LINEAR:
+        return progress;
+    case Easing::INOUTQUAD:
+        return progress < 0.5 ? 2 * progress * progress : 1 - 2 * (1 - progress) * (1 - progress);
+    case Easing::OUTCUBIC:
+        return 1 - (1 - progress) * (1 - progress) * (1 - progress);
+    }
+    return progress;
+}
+
+int AnimationScheduler::add(Animation animation)
+{
+    animation.id = m_nextID++;
+    m_animations.push_back(animation);
+    if (!m_timer->isActive()) m_timer->start();
+    return animation.id;
+}
+
+int AnimationScheduler::indexOf(int id) const
+{
+    for (int i = 0; i < m_animations.size(); ++i) {
+        if (m_animations[i].id == id) return i;
+    }
+    return -1;
+}
+
+void AnimationScheduler::tick()
+{
+    qint64 now = m_clock.elapsed();
+
+    // 回调函数可能会启动或停止动画，所以先记下这一帧要处理的动画
+    QVector<int> ids;
+    ids.reserve(m_animations.size());
+    for (const auto &animation : m_animations) {
+        ids.push_back(animation.id);
+    }
+
+    for (int id : ids) {
+        int index = indexOf(id);
+        if (index < 0) continue;
+
+        Animation animation = m_animations[index];
+        if (!animation.owner) {
+            m_animations.removeAt(index);
+            continue;
+        }
+
+        if (animation.frame) {
+            if (!animation.frame()) stop(id);
+            continue;
+        }
+
+        double progress = 1.0 * (now - animation.startMSecs) / animation.durationMSecs;
+        double value = animation.from + (animation.to - animation.from) * ease(animation.easing, progress);
+        if (progress >= 1.0) {
+            stop(id);
+            if (animation.update) animation.update(animation.to);
+            if (animation.finished) animation.finished();
+        }
+        else if (animation.update) {
+            animation.update(value);
+        }
+    }
+
+    if (m_animations.isEmpty()) m_timer->stop();
+}
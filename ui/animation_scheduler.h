@@ -0,0 +1,75 @@
+#ifndef ANIMATION_SCHEDULER_H
+#define ANIMATION_SCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <functional>
+
+/*
+ * The AnimationScheduler drives all animations of the GUI with a single timer. Its timer only runs while there are
+ * active animations, so an idle game doesn't wake up for nothing. It must only be used from the GUI thread.
+ *
+ * animate() starts a tween from one value to another. The value is calculated from the time elapsed since the tween
+ * was started, so the duration doesn't depend on how often the timer fires. update is called once per frame with the
+ * eased value, the last call always gets the end value. After that finished is called.
+ *
+ * onFrame() calls frame once per frame, until it returns false. Use it for animations without a fixed duration.
+ *
+ * Every animation belongs to an owner. If the owner is destroyed, its animations are stopped without calling any
+ * callbacks. Both functions return an id, which can be used with stop() and isRunning(). Ids are never 0.
+ */
+
+class AnimationScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Easing {
+        LINEAR,
+        INOUTQUAD,
+        OUTCUBIC
+    };
+
+    static AnimationScheduler* instance();
+
+    int animate(QObject* owner, double from, double to, int durationMSecs, const std::function<void(double)> &update,
+                Easing easing = Easing::INOUTQUAD, const std::function<void()> &finished = nullptr);
+    int onFrame(QObject* owner, const std::function<bool()> &frame);
+    void stop(int id);
+    bool isRunning(int id) const;
+
+    static double ease(Easing easing, double progress);
+
+private:
+    static constexpr int FRAMEMSECS = 16;
+
+    struct Animation {
+        int id = 0;
+        QPointer<QObject> owner;
+        double from = 0.0;
+        double to = 1.0;
+        qint64 startMSecs = 0;
+        int durationMSecs = 0;
+        Easing easing = Easing::LINEAR;
+        std::function<void(double)> update;
+        std::function<bool()> frame;
+        std::function<void()> finished;
+    };
+
+    explicit AnimationScheduler(QObject* parent = nullptr);
+
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    QVector<Animation> m_animations;
+    int m_nextID;
+
+    int add(Animation animation);
+    int indexOf(int id) const;
+
+private slots:
+    void tick();
+};
+
+#endif // ANIMATION_SCHEDULER_H
@@ -1,4 +1,5 @@
 #include "game_menu.h"
+#include "shape_cache.h"
 
 PuzzleButton *GameMenu::newPuzzleButton() const
 {
@@ -29,8 +30,8 @@ void GameMenu::leaveEvent(QEvent *event)
 GameMenu::GameMenu(QSize size, QWidget *parent)
     : QWidget{parent}
 {
-    QPixmap backgroundMenu(":/backgrounds/back3");
-    QPixmap backgroundButtons(":/backgrounds/back2");
+    QPixmap backgroundMenu = ShapeCache::pixmap(":/backgrounds/back3");
+    QPixmap backgroundButtons = ShapeCache::pixmap(":/backgrounds/back2");
 
     QLabel* backgroundLabel = new QLabel(this);
     backgroundLabel->setGeometry(QRect(QPoint(0, 0), size));
@@ -40,9 +41,9 @@ GameMenu::GameMenu(QSize size, QWidget *parent)
     QSize sizeInnerBounds(70, 60);
     QSize sizeOuterBounds(130, 100);
 
-    QPainterPath pathNewButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    QPainterPath pathQuitButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
-    QPainterPath pathSaveButton = PuzzlePath::singleJigsawPiecePath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true);
+    QPainterPath pathNewButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 4);
+    QPainterPath pathQuitButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 5);
+    QPainterPath pathSaveButton = ShapeCache::jigsawPath(QRect(QPoint(0, 0), sizeOuterBounds), QRect(), Jigsaw::TypeOfPiece::TRAPEZOID, 4, true, 6);
 
     // 将按钮放置在底边栏中，水平排列
     m_newPuzzleButton = new PuzzleButton(sizeOuterBounds, QBrush(backgroundButtons), pathNewButton, this, "新建");
@@ -1,7 +1,9 @@
 #include "main_window.h"
 #include "ui_main_window.h"
+#include "core/render_stats.h"
 #include <QApplication>
 #include <QScreen>
+#include <QElapsedTimer>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -30,3 +32,15 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+bool MainWindow::event(QEvent *event)
+{
+    // 一次 UpdateRequest 绘制整个窗口的一帧
+    if (event->type() != QEvent::UpdateRequest) return QMainWindow::event(event);
+
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    bool result = QMainWindow::event(event);
+    RenderStats::recordFrame(frameTimer.nsecsElapsed());
+    return result;
+}
+
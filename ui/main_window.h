@@ -20,6 +20,9 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool event(QEvent *event) override;
+
 private:
     Ui::MainWindow *ui;
     PuzzleGame* m_puzzleWidget;
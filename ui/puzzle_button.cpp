@@ -1,4 +1,7 @@
 #include "puzzle_button.h"
+#include "tools/image_ops.h"
+#include "animation_scheduler.h"
+#include "core/memory_budget.h"
 
 PuzzleButton::PuzzleButton(QWidget *parent)
     : PuzzleLabel{parent}
@@ -6,6 +9,10 @@ PuzzleButton::PuzzleButton(QWidget *parent)
     , m_animationTypes{AnimationType::LIGHTERONENTER, AnimationType::CUSTOMCOLORTEXTONENTER}
     , m_customTextColor(Qt::darkGray)
     , m_pixmapTemp(QPixmap())
+    , m_hoverPixmapKey(0)
+    , m_hoverAnimation(0)
+    , m_hoverLevel(0.0)
+    , m_hoverLighter(true)
 {
 
 }
@@ -16,6 +23,10 @@ PuzzleButton::PuzzleButton(const QPixmap &background, QWidget *parent, const QSt
     , m_animationTypes{AnimationType::LIGHTERONENTER, AnimationType::CUSTOMCOLORTEXTONENTER}
     , m_customTextColor(Qt::darkGray)
     , m_pixmapTemp(QPixmap())
+    , m_hoverPixmapKey(0)
+    , m_hoverAnimation(0)
+    , m_hoverLevel(0.0)
+    , m_hoverLighter(true)
 {
 
 }
@@ -26,6 +37,10 @@ PuzzleButton::PuzzleButton(const QSize &size, const QBrush &background, const QP
     , m_animationTypes{AnimationType::LIGHTERONENTER, AnimationType::CUSTOMCOLORTEXTONENTER}
     , m_customTextColor(Qt::darkGray)
     , m_pixmapTemp(QPixmap())
+    , m_hoverPixmapKey(0)
+    , m_hoverAnimation(0)
+    , m_hoverLevel(0.0)
+    , m_hoverLighter(true)
 {
 
 }
@@ -86,73 +101,17 @@ void PuzzleButton::resetTextColor()
 void PuzzleButton::setPixmapLighter()
 {
     m_modeTemp = m_mode;
-    QImage image;
-    switch (m_mode) {
-    case PuzzleLabel::Mode::PIXMAP: {
-        if (PuzzleLabel::pixmap().isNull()) return;
-
-        m_pixmapTemp = PuzzleLabel::pixmap();
-        image = m_pixmapTemp.toImage();
-        break;
-    }
-    case PuzzleLabel::Mode::BRUSH: {
-        if (PuzzleLabel::jigsawPath().isEmpty()) return;
-        QPixmap pixmap(QLabel::pixmap().size());
-        pixmap.fill(Qt::transparent);
-        QPainter painter(&pixmap);
-        painter.setPen(borderPen());
-        painter.setBrush(m_brush);
-        painter.drawPath(jigsawPath());
-
-        image = pixmap.toImage();
-        break;
-    }
-    }
-    for (int i = 0; i < image.height(); ++i) {
-        for (int j = 0; j < image.width(); ++j) {
-            QColor color = image.pixelColor(j, i);
-            if (color == Qt::transparent) continue;
-            color = color.lighter();
-            image.setPixelColor(j, i, color);
-        }
-    }
-    PuzzleLabel::setPixmap(QPixmap::fromImage(image), true);
+    if (m_mode == PuzzleLabel::Mode::PIXMAP) m_pixmapTemp = PuzzleLabel::pixmap();
+    if (!updateHoverPixmaps()) return;
+    PuzzleLabel::setPixmap(m_pixmapLighter, true);
 }
 
 void PuzzleButton::setPixmapDarker()
 {
     m_modeTemp = m_mode;
-    QImage image;
-    switch (m_mode) {
-    case PuzzleLabel::Mode::PIXMAP: {
-        if (PuzzleLabel::pixmap().isNull()) return;
-
-        m_pixmapTemp = PuzzleLabel::pixmap();
-        image = m_pixmapTemp.toImage();
-        break;
-    }
-    case PuzzleLabel::Mode::BRUSH: {
-        if (PuzzleLabel::jigsawPath().isEmpty()) return;
-        QPixmap pixmap(QLabel::pixmap().size());
-        pixmap.fill(Qt::transparent);
-        QPainter painter(&pixmap);
-        painter.setPen(borderPen());
-        painter.setBrush(m_brush);
-        painter.drawPath(jigsawPath());
-
-        image = pixmap.toImage();
-        break;
-    }
-    }
-    for (int i = 0; i < image.height(); ++i) {
-        for (int j = 0; j < image.width(); ++j) {
-            QColor color = image.pixelColor(j, i);
-            if (color == Qt::transparent) continue;
-            color = color.darker();
-            image.setPixelColor(j, i, color);
-        }
-    }
-    PuzzleLabel::setPixmap(QPixmap::fromImage(image), false);
+    if (m_mode == PuzzleLabel::Mode::PIXMAP) m_pixmapTemp = PuzzleLabel::pixmap();
+    if (!updateHoverPixmaps()) return;
+    PuzzleLabel::setPixmap(m_pixmapDarker, false);
 }
 
 void PuzzleButton::resetPixmap()
@@ -166,6 +125,58 @@ void PuzzleButton::resetPixmap()
         PuzzleLabel::setJigsawPath(jigsawPath());
         break;
     }
+    if (MemoryBudget::tier() != MemoryBudget::Tier::FULL) releaseHoverPixmaps();
+}
+
+void PuzzleButton::fadeHoverPixmap(bool lighter, double level)
+{
+    AnimationScheduler::instance()->stop(m_hoverAnimation);
+    m_hoverAnimation = 0;
+    if (m_hoverLevel == level) return;
+
+    if (m_hoverLevel <= 0.0) {
+        // 开始淡入之前保存原来的图片
+        m_modeTemp = m_mode;
+        if (m_mode == PuzzleLabel::Mode::PIXMAP) m_pixmapTemp = PuzzleLabel::pixmap();
+        if (!updateHoverPixmaps()) return;
+        m_hoverLighter = lighter;
+    }
+
+    int duration = qRound(HOVERMSECS * qAbs(level - m_hoverLevel));
+    m_hoverAnimation = AnimationScheduler::instance()->animate(this, m_hoverLevel, level, duration, [this](double hoverLevel) {
+        setHoverLevel(hoverLevel);
+    }, AnimationScheduler::Easing::LINEAR);
+}
+
+void PuzzleButton::setHoverLevel(double level)
+{
+    // 淡入淡出不改变按钮的形状，只重绘控件，不重新生成图片和遮罩
+    m_hoverLevel = level;
+    update();
+    if (m_hoverLevel <= 0.0 && MemoryBudget::tier() != MemoryBudget::Tier::FULL) releaseHoverPixmaps();
+}
+
+/*
+ * While the button is faded, the cached normal pixmap is painted with the lighter or darker one on top at the current
+ * hover level, and the text is painted again over both of them, like redraw() does.
+ */
+
+void PuzzleButton::paintEvent(QPaintEvent *event)
+{
+    const QPixmap &hoverPixmap = m_hoverLighter ? m_pixmapLighter : m_pixmapDarker;
+    if (m_hoverLevel <= 0.0 || m_pixmapNormal.isNull() || hoverPixmap.isNull()) {
+        PuzzleLabel::paintEvent(event);
+        return;
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_pixmapNormal);
+    painter.setOpacity(m_hoverLevel);
+    painter.drawPixmap(0, 0, hoverPixmap);
+    painter.setOpacity(1.0);
+    painter.setPen(textColor());
+    painter.setFont(font());
+    painter.drawText(textArea(), alignment(), text());
 }
 
 void PuzzleButton::mousePressEvent(QMouseEvent *event)
@@ -197,7 +208,7 @@ void PuzzleButton::leaveEvent(QEvent *event)
     emit left();
     if (!m_animate) return;
     resetTextColor();
-    resetPixmap();
+    fadeHoverPixmap(m_hoverLighter, 0.0);
 }
 
 /*
@@ -246,10 +257,75 @@ void PuzzleButton::solveAnimationConflicts()
     }
 }
 
+bool PuzzleButton::hoverPixmapsValid() const
+{
+    if (m_pixmapLighter.isNull()) return false;
+    switch (m_mode) {
+    case PuzzleLabel::Mode::PIXMAP:
+        return m_hoverPath.isEmpty() && m_hoverPixmapKey == m_pixmapTemp.cacheKey();
+    case PuzzleLabel::Mode::BRUSH:
+        return m_hoverPixmapKey == 0 && m_hoverSize == QLabel::pixmap().size() && m_hoverPath == jigsawPath()
+                && m_hoverBrush == m_brush && m_hoverPen == borderPen();
+    }
+    return false;
+}
+
+/*
+ * Calculates the lighter and darker pixmap used when the cursor enters the button. This is only done if the pixmap, or the
+ * path, brush, border pen or size in Mode::BRUSH, changed since the last call. Returns false if there is nothing to draw.
+ */
+
+bool PuzzleButton::updateHoverPixmaps()
+{
+    if (hoverPixmapsValid()) return true;
+
+    QImage image;
+    switch (m_mode) {
+    case PuzzleLabel::Mode::PIXMAP: {
+        if (m_pixmapTemp.isNull()) return false;
+
+        image = ImageOps::toImage(m_pixmapTemp);
+        m_pixmapNormal = m_pixmapTemp;
+        m_hoverPixmapKey = m_pixmapTemp.cacheKey();
+        m_hoverPath = QPainterPath();
+        break;
+    }
+    case PuzzleLabel::Mode::BRUSH: {
+        if (PuzzleLabel::jigsawPath().isEmpty()) return false;
+        // 直接画到 QImage 上，不需要再从 QPixmap 读回
+        image = QImage(QLabel::pixmap().size(), ImageOps::FORMAT);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setPen(borderPen());
+        painter.setBrush(m_brush);
+        painter.drawPath(jigsawPath());
+        painter.end();
+
+        m_pixmapNormal = ImageOps::toPixmap(image);
+        m_hoverPixmapKey = 0;
+        m_hoverPath = jigsawPath();
+        m_hoverBrush = m_brush;
+        m_hoverPen = borderPen();
+        m_hoverSize = image.size();
+        break;
+    }
+    }
+    m_pixmapLighter = ImageOps::toPixmap(ImageOps::lightened(image));
+    m_pixmapDarker = ImageOps::toPixmap(ImageOps::darkened(image));
+    return true;
+}
+
+void PuzzleButton::releaseHoverPixmaps()
+{
+    m_pixmapNormal = QPixmap();
+    m_pixmapLighter = QPixmap();
+    m_pixmapDarker = QPixmap();
+}
+
 void PuzzleButton::applyAnimation()
 {
-    if (m_animationTypes.contains(AnimationType::LIGHTERONENTER)) setPixmapLighter();
-    if (m_animationTypes.contains(AnimationType::DARKERONENTER)) setPixmapDarker();
+    if (m_animationTypes.contains(AnimationType::LIGHTERONENTER)) fadeHoverPixmap(true, 1.0);
+    if (m_animationTypes.contains(AnimationType::DARKERONENTER)) fadeHoverPixmap(false, 1.0);
     if (m_animationTypes.contains(AnimationType::BLACKTEXTONENTER)) setTextColorToBlack();
     if (m_animationTypes.contains(AnimationType::WHITETEXTONENTER)) setTextColorToWhite();
     if (m_animationTypes.contains(AnimationType::LIGHTERTEXTONENTER)) setTextColorLighter();
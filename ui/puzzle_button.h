@@ -59,8 +59,11 @@ protected:
     virtual void mouseDoubleClickEvent(QMouseEvent *event) override;
     virtual void enterEvent(QEnterEvent *event) override;
     virtual void leaveEvent(QEvent *event) override;
+    virtual void paintEvent(QPaintEvent *event) override;
 
 private:
+    static constexpr int HOVERMSECS = 120;
+
     QColor m_textColorTemp;
     QColor m_customTextColor;
     QPixmap m_pixmapTemp;
@@ -68,8 +71,31 @@ private:
     bool m_animate;
     QSet<PuzzleButton::AnimationType> m_animationTypes;
 
+    // The lighter and darker pixmaps are calculated once and reused until the pixmap, path, brush or size changes.
+    // If memory is low (MemoryBudget tier below FULL), they are released when the cursor leaves the button.
+    QPixmap m_pixmapNormal;
+    QPixmap m_pixmapLighter;
+    QPixmap m_pixmapDarker;
+    qint64 m_hoverPixmapKey;
+    QPainterPath m_hoverPath;
+    QBrush m_hoverBrush;
+    QPen m_hoverPen;
+    QSize m_hoverSize;
+
     void solveAnimationConflicts();
     void applyAnimation();
+    bool hoverPixmapsValid() const;
+    bool updateHoverPixmaps();
+    void releaseHoverPixmaps();
+
+    // The lighter or darker pixmap is faded in when the cursor enters the button and faded out when it leaves. It is
+    // painted over the label in paintEvent(), so the label isn't redrawn and its mask isn't rebuilt while fading.
+    int m_hoverAnimation;
+    double m_hoverLevel;
+    bool m_hoverLighter;
+
+    void fadeHoverPixmap(bool lighter, double level);
+    void setHoverLevel(double level);
 };
 
 #endif // PUZZLE_BUTTON_H
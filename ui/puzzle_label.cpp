@@ -1,4 +1,6 @@
 #include "puzzle_label.h"
+#include "core/render_stats.h"
+#include "core/memory_budget.h"
 
 const QString &PuzzleLabel::text() const
 {
@@ -130,6 +132,11 @@ QPointF PuzzleLabel::originalPosition() const
     return m_originalPosition;
 }
 
+QSizeF PuzzleLabel::originalSize() const
+{
+    return m_originalSize;
+}
+
 void PuzzleLabel::redraw()
 {
     setGeometry(QRectF(m_originalPosition, m_originalSize).toRect());
@@ -158,11 +165,59 @@ void PuzzleLabel::redraw()
     painter.drawText(m_textArea, m_alignment, m_text);
 
     QLabel::setPixmap(pixmap);
-    setMask(pixmap.mask());
+    RenderStats::countRedraw();
+    if (m_widgetMask) {
+        setMask(pixmap.mask());
+        RenderStats::countSetMask();
+    }
+    updateMemoryUsage();
+}
+
+/*
+ * Sets the path, size and brush like setJigsawPath(), but neither moves nor redraws the label. Subclasses that draw
+ * the label themselves use it to avoid drawing the same label twice.
+ */
+
+void PuzzleLabel::assignJigsawPath(const QPainterPath &newJigsawPath, const QSize &newSize, const QBrush &newBrush)
+{
+    m_pixmap = QPixmap();
+    m_brush = newBrush;
+    m_jigsawPath = newJigsawPath;
+    m_originalSize = newSize;
+    m_textArea = QRect(QPoint(0, 0), newSize);
+    m_mode = PuzzleLabel::Mode::BRUSH;
 }
 
-PuzzleLabel::PuzzleLabel(QWidget *parent)
+void PuzzleLabel::updateMemoryUsage()
+{
+    qint64 fragmentBytes = MemoryBudget::pixmapBytes(m_pixmap) + MemoryBudget::pixmapBytes(m_brush.texture());
+    qint64 spriteBytes = MemoryBudget::pixmapBytes(QLabel::pixmap());
+    qint64 maskBytes = MemoryBudget::regionBytes(mask());
+    qint64 pathBytes = MemoryBudget::pathBytes(m_jigsawPath);
+
+    if (!m_countedAsPiece) {
+        // 菜单按钮等界面上的标签不算作碎片
+        m_interfaceMemory.set(fragmentBytes + spriteBytes + maskBytes + pathBytes);
+        return;
+    }
+    m_fragmentMemory.set(fragmentBytes);
+    m_spriteMemory.set(spriteBytes);
+    m_maskMemory.set(maskBytes);
+    m_pathMemory.set(pathBytes);
+}
+
+void PuzzleLabel::countMemoryAsPiece()
+{
+    if (m_countedAsPiece) return;
+    m_countedAsPiece = true;
+    m_interfaceMemory.set(0);
+    updateMemoryUsage();
+}
+
+PuzzleLabel::PuzzleLabel(QWidget *parent, bool widgetMask)
     : QLabel{parent}
+    , m_widgetMask(widgetMask)
+    , m_countedAsPiece(false)
 {
     m_originalPosition = QPointF(0.0, 0.0);
     m_originalSize = QSizeF(DEFAULTWIDTH, DEFAULTHEIGHT);
@@ -181,8 +236,10 @@ PuzzleLabel::PuzzleLabel(QWidget *parent)
     redraw();
 }
 
-PuzzleLabel::PuzzleLabel(const QPixmap &background, QWidget *parent, const QString &text, QRect textarea)
+PuzzleLabel::PuzzleLabel(const QPixmap &background, QWidget *parent, const QString &text, QRect textarea, bool widgetMask)
     : QLabel{parent}
+    , m_widgetMask(widgetMask)
+    , m_countedAsPiece(false)
 {
     m_originalPosition = QPointF(0.0, 0.0);
     m_originalSize = QSizeF(background.size());
@@ -200,18 +257,21 @@ PuzzleLabel::PuzzleLabel(const QPixmap &background, QWidget *parent, const QStri
     redraw();
 }
 
-PuzzleLabel::PuzzleLabel(const QSize &size, const QBrush &background, const QPainterPath &jigsawPath, QWidget *parent, const QString &text, QRect textarea)
+PuzzleLabel::PuzzleLabel(const QSize &size, const QBrush &background, const QPainterPath &jigsawPath, QWidget *parent, const QString &text, QRect textarea, bool widgetMask)
     : QLabel{parent}
+    , m_widgetMask(widgetMask)
+    , m_countedAsPiece(false)
 {
     m_originalPosition = QPointF(0.0, 0.0);
     m_originalSize = size;
     setGeometry(QRectF(m_originalPosition, m_originalSize).toRect());
     m_text = text;
-    m_pixmap = QPixmap(size);
+    // 画刷模式直接用路径和画刷绘制，不需要额外的图片
+    m_pixmap = QPixmap();
     m_brush = background;
     m_jigsawPath = jigsawPath;
     m_mode = PuzzleLabel::Mode::BRUSH;
-    m_textArea = textarea == QRect() ? QRect(QPoint(0, 0), m_pixmap.size()) : textarea;
+    m_textArea = textarea == QRect() ? QRect(QPoint(0, 0), size) : textarea;
     m_borderPen = QPen();
     m_font = QFont();
     m_textColor = Qt::black;
@@ -7,6 +7,7 @@
 #include <QBrush>
 #include <QFont>
 #include <QPainter>
+#include "core/memory_budget.h"
 
 /*
  * The JigsawLabel class can be used to display Pixmaps on QLabels with individual shapes (e.g. jigsaw pieces shapes).
@@ -27,6 +28,12 @@
  * font()
  * setFont()
  *
+ * The shape of the label is set as its widget mask, so clicks only hit the visible part. Pass widgetMask = false if
+ * hit testing is done differently, like for PuzzlePieces, to skip building the mask on every redraw.
+ *
+ * The memory of a label is counted as INTERFACE in the MemoryBudget. Pieces call countMemoryAsPiece(), so their
+ * fragments, sprites, masks and paths are counted in their own categories, which the memory tiers are tuned for.
+ *
  * JigsawLabel is the base class for JigsawPiece and JigsawButton.
  */
 
@@ -45,6 +52,13 @@ private:
     QFont m_font;
     QColor m_textColor;
     QFlags<Qt::AlignmentFlag> m_alignment;
+    MemoryUsage m_fragmentMemory{MemoryBudget::Category::FRAGMENTS};
+    MemoryUsage m_spriteMemory{MemoryBudget::Category::ROTATEDSPRITES};
+    MemoryUsage m_maskMemory{MemoryBudget::Category::MASKS};
+    MemoryUsage m_pathMemory{MemoryBudget::Category::PATHS};
+    MemoryUsage m_interfaceMemory{MemoryBudget::Category::INTERFACE};
+    bool m_widgetMask;
+    bool m_countedAsPiece;
 
 protected:
     enum class Mode {PIXMAP, BRUSH} m_mode;
@@ -53,11 +67,14 @@ protected:
     QPointF m_originalPosition;
     QSizeF m_originalSize;
     void redraw();
+    void updateMemoryUsage();
+    void countMemoryAsPiece();
+    void assignJigsawPath(const QPainterPath &newJigsawPath, const QSize &newSize, const QBrush &newBrush);
 
 public:
-    explicit PuzzleLabel(QWidget* parent = nullptr);
-    explicit PuzzleLabel(const QPixmap &background, QWidget* parent = nullptr, const QString &text = "", QRect textarea = QRect());
-    explicit PuzzleLabel(const QSize &size, const QBrush &background, const QPainterPath &jigsawPath, QWidget* parent = nullptr, const QString &text = "", QRect textarea = QRect());
+    explicit PuzzleLabel(QWidget* parent = nullptr, bool widgetMask = true);
+    explicit PuzzleLabel(const QPixmap &background, QWidget* parent = nullptr, const QString &text = "", QRect textarea = QRect(), bool widgetMask = true);
+    explicit PuzzleLabel(const QSize &size, const QBrush &background, const QPainterPath &jigsawPath, QWidget* parent = nullptr, const QString &text = "", QRect textarea = QRect(), bool widgetMask = true);
     ~ PuzzleLabel();
 
     const QString &text() const;
@@ -82,6 +99,7 @@ public:
     void move(const QPointF &pos);
     void move(double x, double y);
     QPointF originalPosition() const;
+    QSizeF originalSize() const;
 };
 
 #endif // PUZZLE_LABEL_H
@@ -0,0 +1,89 @@
+#include "render_stats_overlay.h"
+#include "core/render_stats.h"
+#include "core/memory_budget.h"
+
+RenderStatsOverlay::RenderStatsOverlay(QWidget *parent)
+    : QLabel{parent}
+    , m_timer(new QTimer(this))
+    , m_pieces(0)
+    , m_mergedGroups(0)
+    , m_largestGroup(0)
+{
+    setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 0.7); border-radius: 10px; color: white; font-family: monospace; font-size: 14px; padding: 8px; }");
+
+    setText("...");
+
+    m_timer->setInterval(REFRESHMSECS);
+    QObject::connect(m_timer, &QTimer::timeout, this, &RenderStatsOverlay::refresh);
+    hide();
+}
+
+void RenderStatsOverlay::setBoardStats(int pieces, int mergedGroups, int largestGroup)
+{
+    m_pieces = pieces;
+    m_mergedGroups = mergedGroups;
+    m_largestGroup = largestGroup;
+}
+
+bool RenderStatsOverlay::enabledByEnvironment()
+{
+    QByteArray value = qgetenv("JIGSAW_RENDER_STATS");
+    return !value.isEmpty() && value != "0";
+}
+
+void RenderStatsOverlay::toggle()
+{
+    setVisible(!isVisible());
+    if (isVisible()) raise();
+}
+
+void RenderStatsOverlay::showEvent(QShowEvent *event)
+{
+    QLabel::showEvent(event);
+    // 丢弃隐藏期间的计数
+    RenderStats::takeSnapshot();
+    m_timer->start();
+}
+
+void RenderStatsOverlay::hideEvent(QHideEvent *event)
+{
+    QLabel::hideEvent(event);
+    m_timer->stop();
+}
+
+void RenderStatsOverlay::refresh()
+{
+    emit refreshRequested();
+    RenderStats::Snapshot snapshot = RenderStats::takeSnapshot();
+
+    QStringList lines;
+    lines << QString("帧时间 p50/p90/p99: %1 / %2 / %3 ms").arg(snapshot.frameMSecsP50, 0, 'f', 1)
+                                                           .arg(snapshot.frameMSecsP90, 0, 'f', 1)
+                                                           .arg(snapshot.frameMSecsP99, 0, 'f', 1);
+    lines << QString("重绘: %1 /s   setMask: %2 /s").arg(snapshot.redrawsPerSecond, 0, 'f', 0)
+                                                   .arg(snapshot.setMasksPerSecond, 0, 'f', 0);
+    auto conversions = [&snapshot](RenderStats::Conversion conversion) {
+        int index = static_cast<int>(conversion);
+        return QString("%1 /s (%2)").arg(snapshot.conversionsPerSecond[index], 0, 'f', 0).arg(snapshot.conversions[index]);
+    };
+    lines << QString("格式转换: %1   读回: %2   上传: %3").arg(conversions(RenderStats::Conversion::FORMAT))
+                                                       .arg(conversions(RenderStats::Conversion::PIXMAPTOIMAGE))
+                                                       .arg(conversions(RenderStats::Conversion::IMAGETOPIXMAP));
+    MemoryBudget::Usage usage = MemoryBudget::usage();
+    auto megabytes = [](qint64 bytes) {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    };
+    lines << QString("内存: %1 / %2 MB   等级: %3").arg(megabytes(usage.totalBytes))
+                                                  .arg(usage.budgetBytes > 0 ? megabytes(usage.budgetBytes) : QString("∞"))
+                                                  .arg(MemoryBudget::tierName(usage.tier));
+    for (int i = 0; i < MemoryBudget::NUMBEROFCATEGORIES; ++i) {
+        lines << QString("  %1: %2 MB (峰值 %3 MB)").arg(MemoryBudget::categoryName(static_cast<MemoryBudget::Category>(i)))
+                                                  .arg(megabytes(usage.bytes[i]))
+                                                  .arg(megabytes(usage.peakBytes[i]));
+    }
+    lines << QString("碎片: %1   合并组: %2   最大组: %3").arg(m_pieces).arg(m_mergedGroups).arg(m_largestGroup);
+    setText(lines.join('\n'));
+    adjustSize();
+}
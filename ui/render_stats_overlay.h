@@ -0,0 +1,48 @@
+#ifndef RENDER_STATS_OVERLAY_H
+#define RENDER_STATS_OVERLAY_H
+
+#include <QLabel>
+#include <QTimer>
+
+/*
+ * The RenderStatsOverlay shows the counters of RenderStats and a few numbers about the board: frame time percentiles,
+ * redraws and mask updates per second, memory used per category of the MemoryBudget, number of pieces, merged groups
+ * and the size of the largest group. It is hidden by default and only refreshes while it is visible.
+ *
+ * Before each refresh refreshRequested() is emitted, so the owner of the board can call setBoardStats(). It is shown
+ * at startup if the environment variable JIGSAW_RENDER_STATS is set to anything but 0.
+ */
+
+class RenderStatsOverlay : public QLabel
+{
+    Q_OBJECT
+public:
+    explicit RenderStatsOverlay(QWidget *parent = nullptr);
+
+    void setBoardStats(int pieces, int mergedGroups, int largestGroup);
+
+    static bool enabledByEnvironment();
+
+public slots:
+    void toggle();
+
+signals:
+    void refreshRequested();
+
+protected:
+    virtual void showEvent(QShowEvent *event) override;
+    virtual void hideEvent(QHideEvent *event) override;
+
+private:
+    static constexpr int REFRESHMSECS = 500;
+
+    QTimer* m_timer;
+    int m_pieces;
+    int m_mergedGroups;
+    int m_largestGroup;
+
+private slots:
+    void refresh();
+};
+
+#endif // RENDER_STATS_OVERLAY_H
@@ -0,0 +1,71 @@
+#include "shape_cache.h"
+#include "components/puzzle_path.h"
+#include "core/memory_budget.h"
+#include <QCoreApplication>
+
+QHash<QString, QPainterPath> ShapeCache::s_paths;
+QHash<QString, QPixmap> ShapeCache::s_pixmaps;
+
+QString ShapeCache::pathKey(const QRect &outerBounds, const QRect &innerBounds, Jigsaw::TypeOfPiece typeOfPiece,
+                            int minForcedPaths, bool useRecommendedInnerBounds, unsigned int seed)
+{
+    return QString("%1,%2,%3,%4/%5,%6,%7,%8/%9/%10/%11/%12")
+        .arg(outerBounds.x()).arg(outerBounds.y()).arg(outerBounds.width()).arg(outerBounds.height())
+        .arg(innerBounds.x()).arg(innerBounds.y()).arg(innerBounds.width()).arg(innerBounds.height())
+        .arg(PuzzlePath::typeOfPieceToInt(typeOfPiece)).arg(minForcedPaths).arg(useRecommendedInnerBounds).arg(seed);
+}
+
+QPainterPath ShapeCache::jigsawPath(const QRect &outerBounds, const QRect &innerBounds, Jigsaw::TypeOfPiece typeOfPiece,
+                                    int minForcedPaths, bool useRecommendedInnerBounds, unsigned int seed)
+{
+    if (typeOfPiece == Jigsaw::TypeOfPiece::CUSTOM) {
+        return PuzzlePath::singleJigsawPiecePath(outerBounds, innerBounds, typeOfPiece, minForcedPaths, useRecommendedInnerBounds);
+    }
+
+    QString key = pathKey(outerBounds, innerBounds, typeOfPiece, minForcedPaths, useRecommendedInnerBounds, seed);
+    auto it = s_paths.constFind(key);
+    if (it != s_paths.constEnd()) return it.value();
+
+    // 使用独立的随机序列生成形状，之后恢复游戏的随机数生成器
+    std::mt19937 savedGenerator = Jigsaw::g_randomGenerator;
+    Jigsaw::setRandomSeed(seed);
+    QPainterPath path = PuzzlePath::singleJigsawPiecePath(outerBounds, innerBounds, typeOfPiece, minForcedPaths, useRecommendedInnerBounds);
+    Jigsaw::g_randomGenerator = savedGenerator;
+
+    s_paths.insert(key, path);
+    return path;
+}
+
+QPixmap ShapeCache::pixmap(const QString &filename)
+{
+    auto it = s_pixmaps.constFind(filename);
+    if (it != s_pixmaps.constEnd()) return it.value();
+
+    // 程序退出时在 QApplication 销毁之前释放缓存的图片
+    static bool postRoutineAdded = false;
+    if (!postRoutineAdded) {
+        qAddPostRoutine(ShapeCache::clear);
+        postRoutineAdded = true;
+    }
+
+    QPixmap pixmap(filename);
+    // 内存不足时每次重新加载
+    if (!pixmap.isNull() && MemoryBudget::tier() == MemoryBudget::Tier::FULL) s_pixmaps.insert(filename, pixmap);
+    return pixmap;
+}
+
+QBrush ShapeCache::brush(const QString &filename)
+{
+    return QBrush(pixmap(filename));
+}
+
+void ShapeCache::clear()
+{
+    s_paths.clear();
+    s_pixmaps.clear();
+}
+
+void ShapeCache::releasePixmaps()
+{
+    s_pixmaps.clear();
+}
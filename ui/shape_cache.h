@@ -0,0 +1,49 @@
+#ifndef SHAPE_CACHE_H
+#define SHAPE_CACHE_H
+
+#include "core/jigsaw_types.h"
+#include <QHash>
+#include <QPainterPath>
+#include <QPixmap>
+#include <QBrush>
+#include <QRect>
+#include <QString>
+
+/*
+ * The ShapeCache stores the shapes and backgrounds of the PuzzleButtons, PuzzleLabels and PuzzleSliders used in the
+ * menus. Generating a single jigsaw piece path can take up to 50 attempts, and every button used to load the same
+ * background images from the resources again, so building the menus was slow.
+ *
+ * jigsawPath() returns the same path for the same bounds, type of piece and seed. The path is generated with its own
+ * random generator seeded with the given seed, so the shapes don't depend on the order in which the menus are built
+ * and the random generator of the game isn't touched. Use different seeds if two buttons of the same size should look
+ * different. Custom paths are not cached, because they depend on the CustomPuzzlePath.
+ *
+ * pixmap() and brush() load an image (e.g. ":/backgrounds/back2") only once. While the MemoryBudget is below its
+ * FULL tier, images aren't cached and releasePixmaps() drops the cached ones. Paths are small and always kept.
+ *
+ * The ShapeCache must only be used from the GUI thread.
+ */
+
+class ShapeCache
+{
+public:
+    static QPainterPath jigsawPath(const QRect &outerBounds, const QRect &innerBounds, Jigsaw::TypeOfPiece typeOfPiece,
+                                   int minForcedPaths = 2, bool useRecommendedInnerBounds = false, unsigned int seed = 0);
+    static QPixmap pixmap(const QString &filename);
+    static QBrush brush(const QString &filename);
+
+    static void clear();
+    static void releasePixmaps();
+
+private:
+    ShapeCache() = delete;
+
+    static QString pathKey(const QRect &outerBounds, const QRect &innerBounds, Jigsaw::TypeOfPiece typeOfPiece,
+                           int minForcedPaths, bool useRecommendedInnerBounds, unsigned int seed);
+
+    static QHash<QString, QPainterPath> s_paths;
+    static QHash<QString, QPixmap> s_pixmaps;
+};
+
+#endif // SHAPE_CACHE_H